@@ -6,6 +6,19 @@
 #include "../MyServer/util.h"
 #include "../MyServer/singleton.h"
 #include "../MyServer/thread.h"
+#include "../MyServer/thread_group.h"
+#include "../MyServer/fiber.h"
+#include "../MyServer/scheduler.h"
+#include "../MyServer/timer.h"
+#include "../MyServer/iomanager.h"
+#include "../MyServer/fd_manager.h"
+#include "../MyServer/hook.h"
+#include "../MyServer/queue.h"
+#include "../MyServer/reclaim.h"
+#include "../MyServer/counter.h"
+#include "../MyServer/pool.h"
+#include "../MyServer/allocator.h"
+#include "../MyServer/arena.h"
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "allocator.h"
+#include "thread.h"
+#include <atomic>
+#include <sstream>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <yaml-cpp/yaml.h>
+
+namespace MyServer {
+
+//页堆每次向系统申请的大小
+static const size_t s_chunk_size = 4 * 1024 * 1024;
+
+//空闲对象,链接指针放在对象内存里
+struct FreeObject {
+    FreeObject* next;
+};
+
+//线程缓存和中心列表之间一次转移的对象数,对象越大一批越少
+static inline uint32_t BatchSize(size_t cls) {
+    size_t n = 8192 / SlabAllocator::ClassSize(cls);
+    return n < 2 ? 2 : (n > 64 ? 64 : n);
+}
+
+/**
+ * @brief 页堆,从系统申请大块内存切成span
+ */
+class PageHeap {
+public:
+    void* allocSpan() {
+        FutexMutex::Lock lock(m_mutex);
+        if(m_cur == m_end) {
+            void* p = mmap(nullptr, s_chunk_size, PROT_READ | PROT_WRITE
+                           ,MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(p == MAP_FAILED) {
+                return nullptr;
+            }
+            m_cur = (char*)p;
+            m_end = m_cur + s_chunk_size;
+        }
+        void* span = m_cur;
+        m_cur += SlabAllocator::SPAN_SIZE;
+        m_spanBytes.fetch_add(SlabAllocator::SPAN_SIZE, std::memory_order_relaxed);
+        return span;
+    }
+    uint64_t getSpanBytes() const { return m_spanBytes.load(std::memory_order_relaxed);}
+private:
+    FutexMutex m_mutex;
+    char* m_cur = nullptr;
+    char* m_end = nullptr;
+    std::atomic<uint64_t> m_spanBytes{0};
+};
+
+//每个类别的中心空闲列表
+struct alignas(64) CentralList {
+    FutexMutex mutex;
+    FreeObject* head = nullptr;
+    uint64_t count = 0;
+};
+
+struct ThreadCache;
+
+//全局状态,线程可能在静态对象析构之后退出,所以不释放
+struct SlabGlobal {
+    PageHeap heap;
+    CentralList central[SlabAllocator::CLASS_COUNT];
+    // 所有活着的线程缓存,用于汇总统计
+    Spinlock cachesMutex;
+    std::vector<ThreadCache*> caches;
+    // 已退出线程的统计
+    std::atomic<uint64_t> allocs[SlabAllocator::CLASS_COUNT];
+    std::atomic<uint64_t> frees[SlabAllocator::CLASS_COUNT];
+    std::atomic<uint64_t> largeAllocs{0};
+    std::atomic<uint64_t> largeFrees{0};
+
+    SlabGlobal() {
+        for(size_t i = 0; i < SlabAllocator::CLASS_COUNT; ++i) {
+            allocs[i] = 0;
+            frees[i] = 0;
+        }
+    }
+};
+
+static SlabGlobal& GetGlobal() {
+    static SlabGlobal* s_global = new SlabGlobal;
+    return *s_global;
+}
+
+//从中心列表取最多n个对象,不够时切新的span
+static FreeObject* CentralFetch(size_t cls, uint32_t n, uint32_t& got) {
+    SlabGlobal& g = GetGlobal();
+    CentralList& c = g.central[cls];
+    FutexMutex::Lock lock(c.mutex);
+    if(!c.head) {
+        char* span = (char*)g.heap.allocSpan();
+        if(!span) {
+            got = 0;
+            return nullptr;
+        }
+        size_t size = SlabAllocator::ClassSize(cls);
+        size_t count = SlabAllocator::SPAN_SIZE / size;
+        FreeObject* head = nullptr;
+        for(size_t i = count; i > 0; --i) {
+            FreeObject* o = (FreeObject*)(span + (i - 1) * size);
+            o->next = head;
+            head = o;
+        }
+        c.head = head;
+        c.count += count;
+    }
+    FreeObject* head = c.head;
+    FreeObject* tail = head;
+    got = 1;
+    while(got < n && tail->next) {
+        tail = tail->next;
+        ++got;
+    }
+    c.head = tail->next;
+    c.count -= got;
+    tail->next = nullptr;
+    return head;
+}
+
+//把链表head..tail(n个)还给中心列表
+static void CentralRelease(size_t cls, FreeObject* head, FreeObject* tail, uint32_t n) {
+    CentralList& c = GetGlobal().central[cls];
+    FutexMutex::Lock lock(c.mutex);
+    tail->next = c.head;
+    c.head = head;
+    c.count += n;
+}
+
+//只有所属线程修改,用load加store避免原子读改写,统计时其它线程可以读
+static inline void StatInc(std::atomic<uint64_t>& v) {
+    v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+//线程缓存
+struct ThreadCache {
+    struct List {
+        FreeObject* head = nullptr;
+        uint32_t count = 0;
+    };
+    List lists[SlabAllocator::CLASS_COUNT];
+    std::atomic<uint64_t> allocs[SlabAllocator::CLASS_COUNT];
+    std::atomic<uint64_t> frees[SlabAllocator::CLASS_COUNT];
+
+    ThreadCache() {
+        for(size_t i = 0; i < SlabAllocator::CLASS_COUNT; ++i) {
+            allocs[i] = 0;
+            frees[i] = 0;
+        }
+        SlabGlobal& g = GetGlobal();
+        Spinlock::Lock lock(g.cachesMutex);
+        g.caches.push_back(this);
+    }
+
+    ~ThreadCache() {
+        flush();
+        SlabGlobal& g = GetGlobal();
+        Spinlock::Lock lock(g.cachesMutex);
+        for(size_t i = 0; i < SlabAllocator::CLASS_COUNT; ++i) {
+            g.allocs[i].fetch_add(allocs[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            g.frees[i].fetch_add(frees[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        for(auto it = g.caches.begin(); it != g.caches.end(); ++it) {
+            if(*it == this) {
+                g.caches.erase(it);
+                break;
+            }
+        }
+    }
+
+    //从链表头部取出n个还给中心列表
+    void release(size_t cls, uint32_t n) {
+        List& l = lists[cls];
+        FreeObject* head = l.head;
+        FreeObject* tail = head;
+        for(uint32_t i = 1; i < n; ++i) {
+            tail = tail->next;
+        }
+        l.head = tail->next;
+        l.count -= n;
+        CentralRelease(cls, head, tail, n);
+    }
+
+    void flush() {
+        for(size_t i = 0; i < SlabAllocator::CLASS_COUNT; ++i) {
+            if(lists[i].count) {
+                release(i, lists[i].count);
+            }
+        }
+    }
+};
+
+//线程缓存在第一次使用时创建,线程退出时析构;析构之后再分配释放直接走中心列表
+static thread_local ThreadCache* t_cache = nullptr;
+static thread_local bool t_cache_dead = false;
+
+struct ThreadCacheHolder {
+    ThreadCache cache;
+    ~ThreadCacheHolder() {
+        t_cache = nullptr;
+        t_cache_dead = true;
+    }
+};
+
+static ThreadCache* GetThreadCache() {
+    if(t_cache) {
+        return t_cache;
+    }
+    if(t_cache_dead) {
+        return nullptr;
+    }
+    static thread_local ThreadCacheHolder s_holder;
+    t_cache = &s_holder.cache;
+    return t_cache;
+}
+
+void* SlabAllocator::Allocate(size_t size) {
+    if(size > MAX_SIZE) {
+        GetGlobal().largeAllocs.fetch_add(1, std::memory_order_relaxed);
+        void* p = malloc(size);
+        if(!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+    size_t cls = SizeClass(size);
+    ThreadCache* c = GetThreadCache();
+    if(!c) {
+        //线程缓存已经析构
+        uint32_t got = 0;
+        FreeObject* o = CentralFetch(cls, 1, got);
+        if(!o) {
+            throw std::bad_alloc();
+        }
+        GetGlobal().allocs[cls].fetch_add(1, std::memory_order_relaxed);
+        return o;
+    }
+    ThreadCache::List& l = c->lists[cls];
+    if(!l.head) {
+        uint32_t got = 0;
+        l.head = CentralFetch(cls, BatchSize(cls), got);
+        l.count = got;
+        if(!l.head) {
+            throw std::bad_alloc();
+        }
+    }
+    FreeObject* o = l.head;
+    l.head = o->next;
+    --l.count;
+    StatInc(c->allocs[cls]);
+    return o;
+}
+
+void SlabAllocator::Deallocate(void* p, size_t size) {
+    if(!p) {
+        return;
+    }
+    if(size > MAX_SIZE) {
+        GetGlobal().largeFrees.fetch_add(1, std::memory_order_relaxed);
+        free(p);
+        return;
+    }
+    size_t cls = SizeClass(size);
+    FreeObject* o = (FreeObject*)p;
+    ThreadCache* c = GetThreadCache();
+    if(!c) {
+        GetGlobal().frees[cls].fetch_add(1, std::memory_order_relaxed);
+        CentralRelease(cls, o, o, 1);
+        return;
+    }
+    ThreadCache::List& l = c->lists[cls];
+    o->next = l.head;
+    l.head = o;
+    ++l.count;
+    StatInc(c->frees[cls]);
+    //超过两批时还回一批,保留一批应对接下来的分配
+    uint32_t batch = BatchSize(cls);
+    if(l.count > batch * 2) {
+        c->release(cls, batch);
+    }
+}
+
+void SlabAllocator::FlushThreadCache() {
+    ThreadCache* c = GetThreadCache();
+    if(c) {
+        c->flush();
+    }
+}
+
+SlabStats SlabAllocator::GetStats() {
+    SlabGlobal& g = GetGlobal();
+    SlabStats stats;
+    stats.classes.resize(CLASS_COUNT);
+    for(size_t i = 0; i < CLASS_COUNT; ++i) {
+        SlabStats::Class& c = stats.classes[i];
+        c.size = ClassSize(i);
+        c.allocs = 0;
+        c.frees = 0;
+        FutexMutex::Lock lock(g.central[i].mutex);
+        c.centralFree = g.central[i].count;
+    }
+    {
+        Spinlock::Lock lock(g.cachesMutex);
+        for(size_t i = 0; i < CLASS_COUNT; ++i) {
+            stats.classes[i].allocs = g.allocs[i].load(std::memory_order_relaxed);
+            stats.classes[i].frees = g.frees[i].load(std::memory_order_relaxed);
+        }
+        for(auto tc : g.caches) {
+            for(size_t i = 0; i < CLASS_COUNT; ++i) {
+                stats.classes[i].allocs += tc->allocs[i].load(std::memory_order_relaxed);
+                stats.classes[i].frees += tc->frees[i].load(std::memory_order_relaxed);
+            }
+        }
+        stats.threadCaches = g.caches.size();
+    }
+    stats.spanBytes = g.heap.getSpanBytes();
+    stats.largeAllocs = g.largeAllocs.load(std::memory_order_relaxed);
+    stats.largeFrees = g.largeFrees.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t SlabStats::inUseBytes() const {
+    uint64_t bytes = 0;
+    for(auto& c : classes) {
+        //各线程的计数不是同一时刻读取的,释放可能暂时多于分配
+        if(c.allocs > c.frees) {
+            bytes += (c.allocs - c.frees) * c.size;
+        }
+    }
+    return bytes;
+}
+
+std::string SlabStats::toYamlString() const {
+    YAML::Node node;
+    node["span_bytes"] = spanBytes;
+    node["in_use_bytes"] = inUseBytes();
+    node["large_allocs"] = largeAllocs;
+    node["large_frees"] = largeFrees;
+    node["thread_caches"] = threadCaches;
+    for(auto& c : classes) {
+        if(!c.allocs && !c.centralFree) {
+            continue;
+        }
+        YAML::Node n;
+        n["size"] = c.size;
+        n["allocs"] = c.allocs;
+        n["frees"] = c.frees;
+        n["central_free"] = c.centralFree;
+        node["classes"].push_back(n);
+    }
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+}
@@ -0,0 +1,130 @@
+#ifndef __MYSERVER_ALLOCATOR_H__
+#define __MYSERVER_ALLOCATOR_H__
+
+#include <string>
+#include <vector>
+#include <new>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace MyServer {
+
+/**
+ * @brief 分配统计
+ */
+struct SlabStats {
+    //每个大小类别的统计
+    struct Class {
+        // 对象大小
+        size_t size;
+        // 累计分配次数
+        uint64_t allocs;
+        // 累计释放次数
+        uint64_t frees;
+        // 中心列表中空闲的对象数
+        uint64_t centralFree;
+    };
+    std::vector<Class> classes;
+    // 从系统申请的span总字节数
+    uint64_t spanBytes = 0;
+    // 超过最大类别、直接走malloc的分配次数
+    uint64_t largeAllocs = 0;
+    uint64_t largeFrees = 0;
+    // 当前活着的线程缓存数
+    uint64_t threadCaches = 0;
+
+    //正在使用的小对象字节数(分配减释放)
+    uint64_t inUseBytes() const;
+    std::string toYamlString() const;
+};
+
+/**
+ * @brief 按大小类别的slab分配器,用于框架内部的小对象
+ * @details 不超过MAX_SIZE的请求向上取整到一个大小类别:
+ *          128字节以内按16字节递增,之后每翻一倍分成4档,共28个类别,
+ *          对象至少16字节对齐
+ *          每个线程对每个类别有一个空闲链表,分配释放只操作本线程的链表,不加锁
+ *          链表空时从中心列表整批取,超过两批时整批还回中心列表
+ *          中心列表不够时从页堆切一个SPAN_SIZE的span分成对象;
+ *          页堆每次向系统申请一大块内存,切出的span不再归还
+ *          大于MAX_SIZE的请求直接使用malloc
+ *          释放时必须给出分配时的大小(与STL分配器的接口一致)
+ *          线程退出时本线程缓存的对象还回中心列表
+ */
+class SlabAllocator {
+public:
+    //最大的大小类别
+    static const size_t MAX_SIZE = 4096;
+    //大小类别数
+    static const size_t CLASS_COUNT = 28;
+    //从页堆一次切出的大小
+    static const size_t SPAN_SIZE = 64 * 1024;
+
+    //分配size字节,失败抛出std::bad_alloc
+    static void* Allocate(size_t size);
+    //释放,size必须与分配时相同
+    static void Deallocate(void* p, size_t size);
+
+    //size所属的类别
+    static size_t SizeClass(size_t size) {
+        if(size <= 128) {
+            return size ? (size - 1) / 16 : 0;
+        }
+        size_t lg = 63 - __builtin_clzll(size - 1);
+        return 8 + (lg - 7) * 4 + ((size - 1 - (1ull << lg)) >> (lg - 2));
+    }
+    //类别的对象大小
+    static size_t ClassSize(size_t cls) {
+        if(cls < 8) {
+            return (cls + 1) * 16;
+        }
+        size_t k = cls - 8;
+        size_t lg = 7 + k / 4;
+        return (1ull << lg) + (k % 4 + 1) * (1ull << (lg - 2));
+    }
+
+    //所有线程的统计汇总
+    static SlabStats GetStats();
+    //把本线程缓存的对象全部还回中心列表
+    static void FlushThreadCache();
+};
+
+/**
+ * @brief 使用SlabAllocator的STL分配器
+ * @details 框架内的容器和字符串可以选择使用,如
+ *          std::vector<int, SlabStlAllocator<int> >、SlabString
+ *          无状态,所有实例可以互相释放对方分配的内存
+ */
+template<class T>
+class SlabStlAllocator {
+public:
+    typedef T value_type;
+
+    static_assert(alignof(T) <= 16, "SlabStlAllocator supports alignment up to 16");
+
+    SlabStlAllocator() noexcept {}
+    template<class U>
+    SlabStlAllocator(const SlabStlAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if(n > (size_t)-1 / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return (T*)SlabAllocator::Allocate(n * sizeof(T));
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        SlabAllocator::Deallocate(p, n * sizeof(T));
+    }
+
+    template<class U>
+    bool operator==(const SlabStlAllocator<U>&) const noexcept { return true;}
+    template<class U>
+    bool operator!=(const SlabStlAllocator<U>&) const noexcept { return false;}
+};
+
+//使用SlabAllocator的字符串
+typedef std::basic_string<char, std::char_traits<char>, SlabStlAllocator<char> > SlabString;
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "arena.h"
+#include <vector>
+#include <stdlib.h>
+
+namespace MyServer {
+
+//每个线程最多缓存的块字节数
+static const size_t s_cache_max_bytes = 1024 * 1024;
+
+//块头,数据紧跟在后面
+struct Arena::Block {
+    Block* next;
+    // 整块大小(包括块头)
+    size_t size;
+
+    char* begin() { return (char*)(this + 1);}
+    char* end() { return (char*)this + size;}
+};
+
+//需要析构的对象
+struct Arena::Cleanup {
+    void (*fn)(void*);
+    void* obj;
+    Cleanup* next;
+};
+
+//线程本地的空闲块,只缓存标准大小的块,线程退出时释放
+struct BlockCache {
+    std::vector<void*> blocks;
+    std::vector<size_t> sizes;
+    size_t bytes = 0;
+
+    ~BlockCache() {
+        for(auto p : blocks) {
+            free(p);
+        }
+    }
+
+    void* take(size_t size) {
+        for(size_t i = blocks.size(); i > 0; --i) {
+            if(sizes[i - 1] == size) {
+                void* p = blocks[i - 1];
+                blocks.erase(blocks.begin() + (i - 1));
+                sizes.erase(sizes.begin() + (i - 1));
+                bytes -= size;
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    void put(void* p, size_t size) {
+        if(bytes + size > s_cache_max_bytes) {
+            free(p);
+            return;
+        }
+        blocks.push_back(p);
+        sizes.push_back(size);
+        bytes += size;
+    }
+};
+
+//线程缓存析构之后(如静态Arena在线程退出后析构)块直接释放
+static thread_local bool t_block_cache_dead = false;
+
+struct BlockCacheHolder {
+    BlockCache cache;
+    ~BlockCacheHolder() {
+        t_block_cache_dead = true;
+    }
+};
+
+static BlockCache* GetBlockCache() {
+    if(t_block_cache_dead) {
+        return nullptr;
+    }
+    static thread_local BlockCacheHolder s_holder;
+    return &s_holder.cache;
+}
+
+Arena::Arena(size_t block_size)
+    :m_blockSize(block_size < 256 ? 256 : block_size) {
+}
+
+Arena::~Arena() {
+    runCleanups();
+    releaseAll(nullptr);
+}
+
+void* Arena::allocSlow(size_t size, size_t align) {
+    //malloc返回的块按16字节对齐,更大的对齐要留出余量
+    size_t pad = align > 16 ? align : 0;
+    size_t need = sizeof(Block) + pad + size;
+    if(need < size) {
+        throw std::bad_alloc();
+    }
+    Block* b = nullptr;
+    if(need > m_blockSize / 2) {
+        //大块单独分配,挂在当前块后面,当前块剩余的空间继续使用
+        b = (Block*)malloc(need);
+        if(!b) {
+            throw std::bad_alloc();
+        }
+        b->size = need;
+        if(m_blocks) {
+            b->next = m_blocks->next;
+            m_blocks->next = b;
+        } else {
+            b->next = nullptr;
+            m_blocks = b;
+            m_cur = m_end = b->end();
+        }
+    } else {
+        BlockCache* cache = GetBlockCache();
+        b = cache ? (Block*)cache->take(m_blockSize) : nullptr;
+        if(!b) {
+            b = (Block*)malloc(m_blockSize);
+            if(!b) {
+                throw std::bad_alloc();
+            }
+        }
+        b->size = m_blockSize;
+        b->next = m_blocks;
+        m_blocks = b;
+        m_end = b->end();
+    }
+    ++m_blockCount;
+    m_capacity += b->size;
+    m_allocated += size;
+    char* p = (char*)(((uintptr_t)b->begin() + align - 1) & ~(uintptr_t)(align - 1));
+    if(b == m_blocks && b->size == m_blockSize) {
+        m_cur = p + size;
+    }
+    return p;
+}
+
+void Arena::addCleanup(void (*fn)(void*), void* obj) {
+    Cleanup* c = (Cleanup*)alloc(sizeof(Cleanup), alignof(Cleanup));
+    c->fn = fn;
+    c->obj = obj;
+    c->next = m_cleanups;
+    m_cleanups = c;
+}
+
+void Arena::runCleanups() {
+    //析构函数里可能还会用arena分配,先把链表摘下来
+    while(m_cleanups) {
+        Cleanup* c = m_cleanups;
+        m_cleanups = nullptr;
+        for(; c; c = c->next) {
+            c->fn(c->obj);
+        }
+    }
+}
+
+void Arena::releaseAll(Block* keep) {
+    BlockCache* cache = GetBlockCache();
+    Block* b = m_blocks;
+    while(b) {
+        Block* next = b->next;
+        if(b == keep) {
+            //保留的块
+        } else if(cache && b->size == m_blockSize) {
+            cache->put(b, b->size);
+        } else {
+            free(b);
+        }
+        b = next;
+    }
+    m_allocated = 0;
+    if(keep) {
+        keep->next = nullptr;
+        m_blocks = keep;
+        m_cur = keep->begin();
+        m_end = keep->end();
+        m_capacity = keep->size;
+        m_blockCount = 1;
+    } else {
+        m_blocks = nullptr;
+        m_cur = m_end = nullptr;
+        m_capacity = 0;
+        m_blockCount = 0;
+    }
+}
+
+void Arena::reset() {
+    runCleanups();
+    //保留一个标准块,只用到一个块的请求reset时不需要再取块
+    Block* keep = nullptr;
+    for(Block* b = m_blocks; b; b = b->next) {
+        if(b->size == m_blockSize) {
+            keep = b;
+            break;
+        }
+    }
+    releaseAll(keep);
+}
+
+bool Arena::contains(const void* p) const {
+    for(Block* b = m_blocks; b; b = b->next) {
+        if((const char*)p >= b->begin() && (const char*)p < b->end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,152 @@
+#ifndef __MYSERVER_ARENA_H__
+#define __MYSERVER_ARENA_H__
+
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace MyServer {
+
+/**
+ * @brief 单调递增的内存区,用于一次请求内的临时对象
+ * @details 内存按块链接,分配只是在当前块上移动指针,释放单个对象什么都不做,
+ *          reset或析构时一次性归还所有块
+ *          标准大小的块归还到线程本地的缓存中,下一次请求直接复用,不经过malloc;
+ *          超过块大小一半的请求单独分配一块,不进入缓存
+ *          是std::pmr::memory_resource,可以直接给std::pmr的容器使用;
+ *          也可以通过ArenaAllocator给普通的STL容器和std::allocate_shared使用
+ *          只能在一个线程中使用
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+    typedef std::shared_ptr<Arena> ptr;
+    //默认块大小
+    static const size_t DEFAULT_BLOCK_SIZE = 8192;
+
+    /**
+     * @param[in] block_size 标准块大小(包括块头)
+     */
+    Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    //分配size字节,按align对齐,失败抛出std::bad_alloc
+    void* alloc(size_t size, size_t align = alignof(std::max_align_t)) {
+        char* p = (char*)(((uintptr_t)m_cur + align - 1) & ~(uintptr_t)(align - 1));
+        if(p + size <= m_end && p >= m_cur) {
+            m_cur = p + size;
+            m_allocated += size;
+            return p;
+        }
+        return allocSlow(size, align);
+    }
+
+    /**
+     * @brief 在arena中构造对象
+     * @details 析构函数不平凡的对象在reset或arena析构时按构造的逆序析构
+     */
+    template<class T, class... Args>
+    T* create(Args&&... args) {
+        void* p = alloc(sizeof(T), alignof(T));
+        T* obj = new(p) T(std::forward<Args>(args)...);
+        if(!std::is_trivially_destructible<T>::value) {
+            addCleanup([](void* o) { ((T*)o)->~T();}, obj);
+        }
+        return obj;
+    }
+
+    /**
+     * @brief 释放所有对象
+     * @details 之前分配的内存全部失效;保留一个标准块供下次使用,
+     *          其余的块归还到线程缓存
+     */
+    void reset();
+
+    //分配出去的字节数
+    size_t getAllocated() const { return m_allocated;}
+    //持有的块的总字节数
+    size_t getCapacity() const { return m_capacity;}
+    //持有的块数
+    size_t getBlockCount() const { return m_blockCount;}
+    //p是否在本arena的块里
+    bool contains(const void* p) const;
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return alloc(bytes, alignment);
+    }
+    //单个对象不释放,reset时一起归还
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+private:
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    struct Block;
+    struct Cleanup;
+
+    void* allocSlow(size_t size, size_t align);
+    void addCleanup(void (*fn)(void*), void* obj);
+    //依次析构create构造的对象
+    void runCleanups();
+    //除keep以外的块归还到线程缓存或释放
+    void releaseAll(Block* keep);
+private:
+    // 标准块大小
+    size_t m_blockSize;
+    // 当前块中未使用的部分
+    char* m_cur = nullptr;
+    char* m_end = nullptr;
+    // 所有块,最新的在前
+    Block* m_blocks = nullptr;
+    // 需要析构的对象,最新的在前
+    Cleanup* m_cleanups = nullptr;
+    size_t m_allocated = 0;
+    size_t m_capacity = 0;
+    size_t m_blockCount = 0;
+};
+
+/**
+ * @brief 在Arena上分配的STL分配器
+ * @details deallocate什么都不做,内存随arena一起释放;arena必须比容器活得久
+ *          用于std::vector<T, ArenaAllocator<T> >、std::allocate_shared等
+ *          不需要改变容器类型时也可以直接用std::pmr容器加Arena
+ */
+template<class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator(Arena* arena) noexcept
+        :m_arena(arena) {
+    }
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& oth) noexcept
+        :m_arena(oth.getArena()) {
+    }
+
+    T* allocate(size_t n) {
+        if(n > (size_t)-1 / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return (T*)m_arena->alloc(n * sizeof(T), alignof(T));
+    }
+    void deallocate(T*, size_t) noexcept {}
+
+    Arena* getArena() const { return m_arena;}
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U>& oth) const noexcept { return m_arena == oth.getArena();}
+    template<class U>
+    bool operator!=(const ArenaAllocator<U>& oth) const noexcept { return m_arena != oth.getArena();}
+private:
+    Arena* m_arena;
+};
+
+}
+
+#endif
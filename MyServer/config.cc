@@ -1,14 +1,268 @@
 #include "config.h"
+#include "config_snapshot.h"
 
 namespace MyServer
 {
 
+    alignas(64) std::atomic<uint64_t> ConfigVarBase::s_epoch{1};
+
+    //当前线程正在进行的配置事务
+    static thread_local ConfigTransaction *t_config_txn = nullptr;
+
+    static ConfigVar<uint32_t>::ptr g_listener_slow_threshold =
+        Config::Lookup("config.listener.slow_threshold", (uint32_t)100, "config listener slow threshold ms");
+
+    //监听回调的分发器,同步模式在提交线程执行,异步模式交给后台线程按批次顺序执行
+    class ListenerDispatcher
+    {
+    public:
+        typedef Mutex MutexType;
+        typedef std::vector<ConfigTransaction::Notify> Batch;
+
+        ~ListenerDispatcher()
+        {
+            Thread::ptr thread;
+            {
+                MutexType::Lock lock(m_mutex);
+                m_stop = true;
+                thread = m_thread;
+            }
+            if (thread)
+            {
+                m_semaphore.notify();
+                thread->join();
+            }
+        }
+
+        void submit(Batch &batch)
+        {
+            if (!m_async)
+            {
+                run(batch);
+                return;
+            }
+            {
+                MutexType::Lock lock(m_mutex);
+                if (!m_thread)
+                {
+                    m_thread.reset(new Thread(std::bind(&ListenerDispatcher::loop, this), "config_listener"));
+                }
+                m_queue.push_back(Item());
+                m_queue.back().batch.swap(batch);
+            }
+            m_semaphore.notify();
+        }
+
+        void flush()
+        {
+            Semaphore done;
+            {
+                MutexType::Lock lock(m_mutex);
+                if (!m_thread)
+                {
+                    return;
+                }
+                m_queue.push_back(Item());
+                m_queue.back().done = &done;
+            }
+            m_semaphore.notify();
+            done.wait();
+        }
+
+        std::vector<Config::ListenerStat> getStats()
+        {
+            MutexType::Lock lock(m_mutex);
+            return m_stats;
+        }
+
+        void setAsync(bool v) { m_async = v; }
+        bool isAsync() const { return m_async; }
+
+    private:
+        struct Item
+        {
+            Batch batch;
+            Semaphore *done = nullptr;
+        };
+
+        void loop()
+        {
+            while (true)
+            {
+                m_semaphore.wait();
+                Item item;
+                {
+                    MutexType::Lock lock(m_mutex);
+                    if (m_queue.empty())
+                    {
+                        if (m_stop)
+                        {
+                            return;
+                        }
+                        continue;
+                    }
+                    item.batch.swap(m_queue.front().batch);
+                    item.done = m_queue.front().done;
+                    m_queue.pop_front();
+                }
+                run(item.batch);
+                if (item.done)
+                {
+                    item.done->notify();
+                }
+            }
+        }
+
+        //逐个执行回调并记录耗时,单个回调异常不影响同一批次的其它回调
+        void run(Batch &batch)
+        {
+            if (batch.empty())
+            {
+                return;
+            }
+            uint64_t slow_us = g_listener_slow_threshold ? g_listener_slow_threshold->getValue() * 1000ul : 0;
+            std::vector<Config::ListenerStat> stats;
+            stats.reserve(batch.size());
+            for (auto &i : batch)
+            {
+                uint64_t begin = GetCurrentUS();
+                try
+                {
+                    i.cb();
+                }
+                catch (std::exception &e)
+                {
+                    MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "config listener exception name=" << i.name
+                                                            << " key=" << i.key << " " << e.what();
+                }
+                Config::ListenerStat stat;
+                stat.name = i.name;
+                stat.key = i.key;
+                stat.elapse_us = GetCurrentUS() - begin;
+                if (slow_us && stat.elapse_us >= slow_us)
+                {
+                    MYSERVER_LOG_WARN(MYSERVER_LOG_ROOT()) << "slow config listener name=" << i.name
+                                                           << " key=" << i.key << " elapse=" << stat.elapse_us << "us";
+                }
+                stats.push_back(stat);
+            }
+            MutexType::Lock lock(m_mutex);
+            m_stats.swap(stats);
+        }
+
+    private:
+        MutexType m_mutex;
+        Semaphore m_semaphore;
+        std::atomic<bool> m_async{false};
+        bool m_stop = false;
+        Thread::ptr m_thread;
+        std::list<Item> m_queue;
+        //最近一批回调的耗时
+        std::vector<Config::ListenerStat> m_stats;
+    };
+
+    static ListenerDispatcher &GetDispatcher()
+    {
+        static ListenerDispatcher s_dispatcher;
+        return s_dispatcher;
+    }
+
+    ConfigTransaction::ConfigTransaction()
+        : m_prev(t_config_txn)
+    {
+        t_config_txn = this;
+    }
+
+    ConfigTransaction::~ConfigTransaction()
+    {
+        if (m_active)
+        {
+            t_config_txn = m_prev;
+        }
+    }
+
+    ConfigTransaction *ConfigTransaction::GetThis()
+    {
+        return t_config_txn;
+    }
+
+    void ConfigTransaction::addCommit(commit_cb cb)
+    {
+        m_commits.push_back(cb);
+    }
+
+    void ConfigTransaction::addNotify(const std::string &name, uint64_t key, std::function<void()> cb)
+    {
+        Notify n;
+        n.name = name;
+        n.key = key;
+        n.cb = cb;
+        m_notifies.push_back(n);
+    }
+
+    void ConfigTransaction::commit()
+    {
+        if (!m_active)
+        {
+            return;
+        }
+        m_active = false;
+        t_config_txn = m_prev;
+        //先写入全部新值,再统一通知
+        for (auto &i : m_commits)
+        {
+            i(*this);
+        }
+        m_commits.clear();
+        GetDispatcher().submit(m_notifies);
+        m_notifies.clear();
+    }
+
+    void Config::SetListenerAsync(bool v)
+    {
+        GetDispatcher().setAsync(v);
+    }
+
+    bool Config::IsListenerAsync()
+    {
+        return GetDispatcher().isAsync();
+    }
+
+    void Config::FlushListeners()
+    {
+        GetDispatcher().flush();
+    }
+
+    std::vector<Config::ListenerStat> Config::GetListenerStats()
+    {
+        return GetDispatcher().getStats();
+    }
+
     ConfigVarBase::ptr Config::LookupBase(const std::string &name)
     {
+        RWMutexType::ReadLock lock(GetMutex());
         auto it = GetDatas().find(name);
         return it == GetDatas().end() ? nullptr : it->second;
     }
 
+    void Config::Visit(std::function<void(ConfigVarBase::ptr)> cb)
+    {
+        //回调在锁外执行,回调里可以再Lookup
+        std::vector<ConfigVarBase::ptr> vars;
+        {
+            RWMutexType::ReadLock lock(GetMutex());
+            vars.reserve(GetDatas().size());
+            for (auto &i : GetDatas())
+            {
+                vars.push_back(i.second);
+            }
+        }
+        for (auto &i : vars)
+        {
+            cb(i);
+        }
+    }
+
     //Config::ConfigVarMap Config::GetDatas();
 
     //"A.B", 10
@@ -19,7 +273,7 @@ namespace MyServer
     //生成list容器，如果node是map类型进入map后返回
     static void ListALLMember(const std::string &prefix, const YAML::Node &node, std::list<std::pair<std::string, const YAML::Node>> &output)
     {
-        if (prefix.find_first_not_of("abcdefghijklmnopqrstuvwxyz._012345678") != std::string::npos)
+        if (prefix.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos)
         {
             MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "Config invalid name: " << prefix << " : " << node;
             return;
@@ -34,12 +288,19 @@ namespace MyServer
         }
     }
 
+    void Config::ListAllMember(const YAML::Node &root, std::list<std::pair<std::string, const YAML::Node>> &output)
+    {
+        ListALLMember("", root, output);
+    }
+
     //加载yaml里面的数据
     void Config::LoadFromYaml(const YAML::Node &root)
     {
         std::list<std::pair<std::string, const YAML::Node>> all_node;
         ListALLMember("", root, all_node);
 
+        //一次加载的所有参数一起提交,监听回调作为一批分发
+        ConfigTransaction txn;
         for (auto &i : all_node)
         {
             std::string key = i.first;
@@ -65,6 +326,23 @@ namespace MyServer
                 }
             }
         }
+        txn.commit();
+    }
+
+    void Config::LoadFromFile(const std::string &yaml_file, const std::string &snapshot_file)
+    {
+        if (!snapshot_file.empty())
+        {
+            ConfigSnapshot snapshot;
+            if (snapshot.open(snapshot_file) && snapshot.isFresh(yaml_file))
+            {
+                snapshot.apply();
+                return;
+            }
+            MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "config snapshot " << snapshot_file
+                                                   << " is stale or invalid, fallback to yaml " << yaml_file;
+        }
+        LoadFromYaml(YAML::LoadFile(yaml_file));
     }
 
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <boost/lexical_cast.hpp>
 #include "log.h"
+#include "thread.h"
 #include <vector>
 #include <list>
 #include <map>
@@ -13,6 +14,11 @@
 #include <unordered_map>
 #include <yaml-cpp/yaml.h>
 #include <functional>
+#include <type_traits>
+#include <string.h>
+#include <limits>
+#include <typeinfo>
+#include "util.h"
 
 namespace MyServer {
 
@@ -33,9 +39,32 @@ public:
     virtual bool fromString(const std::string& val) = 0;
     virtual std::string getTypeName() const = 0;
 
+    /**
+     * @brief 将YAML String 转成参数类型的二进制表示(不修改参数值)
+     * @details 供配置快照使用,只有定长的基础类型支持,其它类型返回false
+     */
+    virtual bool encodeBinary(const std::string& val, std::string& out) { return false; }
+    /**
+     * @brief 从encodeBinary生成的二进制数据设置参数值
+     */
+    virtual bool decodeBinary(const char* data, size_t len) { return false; }
+
+    /**
+     * @brief 全局配置版本号,任意参数值变化后递增
+     * @details 供ConfigVarCache判断本地副本是否过期,只读不写
+     */
+    static uint64_t GetEpoch() { return s_epoch.load(std::memory_order_acquire); }
+
+protected:
+    //参数值写入之后调用
+    static void BumpEpoch() { s_epoch.fetch_add(1, std::memory_order_release); }
+
 protected:
     std::string m_name;
     std::string m_description;
+private:
+    //独占一个cache line,避免和其它数据伪共享
+    alignas(64) static std::atomic<uint64_t> s_epoch;
 
 };
 
@@ -49,6 +78,116 @@ public:
     }
 };
 
+//数值类型的分类,按分类分派到对应的转换函数: 0 float, 1 其它浮点数, 2 有符号整数, 3 无符号整数
+template <class T>
+struct NumberKind : std::integral_constant<int, std::is_same<T, float>::value ? 0
+        : std::is_floating_point<T>::value ? 1 : std::is_signed<T>::value ? 2 : 3> {
+};
+
+template <class T>
+bool ParseNumber(const char* begin, const char* end, T& v, std::integral_constant<int, 0>) {
+    return ParseFloat(begin, end, v);
+}
+
+template <class T>
+bool ParseNumber(const char* begin, const char* end, T& v, std::integral_constant<int, 1>) {
+    double d;
+    if(!ParseDouble(begin, end, d)) {
+        return false;
+    }
+    v = d;
+    return true;
+}
+
+template <class T>
+bool ParseNumber(const char* begin, const char* end, T& v, std::integral_constant<int, 2>) {
+    int64_t i;
+    if(!ParseInt64(begin, end, i) || i < std::numeric_limits<T>::min()
+            || i > std::numeric_limits<T>::max()) {
+        return false;
+    }
+    v = i;
+    return true;
+}
+
+template <class T>
+bool ParseNumber(const char* begin, const char* end, T& v, std::integral_constant<int, 3>) {
+    uint64_t u;
+    if(!ParseUint64(begin, end, u) || u > std::numeric_limits<T>::max()) {
+        return false;
+    }
+    v = u;
+    return true;
+}
+
+//字符串转成数值,格式错误或超出T的范围时与boost::lexical_cast一样抛出bad_lexical_cast
+template <class T>
+T StringToNumber(const std::string& v) {
+    T rt;
+    if(!ParseNumber(v.c_str(), v.c_str() + v.size(), rt, NumberKind<T>())) {
+        throw boost::bad_lexical_cast(typeid(std::string), typeid(T));
+    }
+    return rt;
+}
+
+template <class T>
+size_t FormatNumber(T v, char* buf, std::integral_constant<int, 0>) {
+    return FloatToChars(v, buf);
+}
+
+template <class T>
+size_t FormatNumber(T v, char* buf, std::integral_constant<int, 1>) {
+    return DoubleToChars(v, buf);
+}
+
+template <class T>
+size_t FormatNumber(T v, char* buf, std::integral_constant<int, 2>) {
+    return IntToChars(v, buf);
+}
+
+template <class T>
+size_t FormatNumber(T v, char* buf, std::integral_constant<int, 3>) {
+    return UintToChars(v, buf);
+}
+
+//数值转成字符串,浮点数输出能原样解析回来的最短形式
+template <class T>
+std::string NumberToString(T v) {
+    char buf[32];
+    size_t len = FormatNumber(v, buf, NumberKind<T>());
+    return std::string(buf, len);
+}
+
+//整数和浮点数不经过boost::lexical_cast和iostream
+//char类型在boost::lexical_cast中按字符转换,保持原样
+#define XX(type) \
+template <> \
+class LexicalCast<std::string, type> { \
+public: \
+    type operator()(const std::string& v) { \
+        return StringToNumber<type>(v); \
+    } \
+}; \
+template <> \
+class LexicalCast<type, std::string> { \
+public: \
+    std::string operator()(const type& v) { \
+        return NumberToString<type>(v); \
+    } \
+};
+
+XX(short)
+XX(unsigned short)
+XX(int)
+XX(unsigned int)
+XX(long)
+XX(unsigned long)
+XX(long long)
+XX(unsigned long long)
+XX(float)
+XX(double)
+#undef XX
+
 template <class T>
 class LexicalCast<std::string, std::vector<T> > {
 public:
@@ -232,6 +371,85 @@ public:
     }
 };
 
+//配置快照的二进制编码,默认不支持
+template <class T, class Enable = void>
+class ConfigBinary {
+public:
+    static const bool supported = false;
+};
+
+//算术类型直接按内存布局编码,加载快照时跳过LexicalCast
+template <class T>
+class ConfigBinary<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+public:
+    static const bool supported = true;
+
+    static void encode(const T& v, std::string& out) {
+        out.assign(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    static bool decode(const char* data, size_t len, T& v) {
+        if(len != sizeof(T)) {
+            return false;
+        }
+        memcpy(&v, data, sizeof(T));
+        return true;
+    }
+};
+
+/**
+ * @brief 配置事务
+ * @details 事务存在期间,当前线程的ConfigVar::setValue只记录新值,不立即生效
+ *          commit时先把所有新值一起写入,再把监听回调作为一批统一通知,
+ *          监听者不会看到只更新了一半的配置
+ *          未commit的事务析构时丢弃所有变更
+ */
+class ConfigTransaction {
+public:
+    //提交阶段写入新值,并把需要通知的回调加入事务
+    typedef std::function<void (ConfigTransaction& txn)> commit_cb;
+
+    ConfigTransaction();
+    ~ConfigTransaction();
+
+    //获取当前线程正在进行的事务
+    static ConfigTransaction* GetThis();
+
+    void addCommit(commit_cb cb);
+
+    /**
+     * @brief 添加一个变更通知
+     * @param[in] name 配置参数名称
+     * @param[in] key 监听者的键值
+     */
+    void addNotify(const std::string& name, uint64_t key, std::function<void()> cb);
+
+    /**
+     * @brief 提交事务
+     * @details 按顺序写入所有新值后批量分发监听回调,
+     *          Config::SetListenerAsync(true)时在后台线程分发
+     */
+    void commit();
+
+private:
+    ConfigTransaction(const ConfigTransaction&) = delete;
+    ConfigTransaction& operator=(const ConfigTransaction&) = delete;
+
+public:
+    //待分发的监听回调
+    struct Notify {
+        std::string name;
+        uint64_t key;
+        std::function<void()> cb;
+    };
+
+private:
+    ConfigTransaction* m_prev;
+    bool m_active = true;
+    std::vector<commit_cb> m_commits;
+    std::vector<Notify> m_notifies;
+};
+
 //Fromstr T operator()(const std::string&)
 //Tostr std::string operator()(const T&)
 //将常用类型转换成string
@@ -239,6 +457,8 @@ public:
 template <class T, class Fromstr = LexicalCast<std::string, T>, class Tostr = LexicalCast<T, std::string> >
 class ConfigVar : public ConfigVarBase {
 public:
+    //每个参数一把小锁,参数数量可能很多,不用按线程分槽的BRMutex
+    typedef PolicyRWMutex<RWMutex> RWMutexType;
     typedef std::shared_ptr<ConfigVar> ptr;
     //配置变更事件
     typedef std::function<void (const T& old_value, const T& new_value)> on_change_cb;
@@ -253,6 +473,7 @@ public:
         std::string toString() override {
             try {
                 //return boost::lexical_cast<std::string>(m_val);
+                RWMutexType::ReadLock lock(m_mutex);
                 return Tostr()(m_val);
             } catch (std::exception& e) {
                 MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "ConfigVar::toString exception"
@@ -262,13 +483,14 @@ public:
         }
         /**
          * @brief 从YAML String 转成参数的值
-         * @exception 当转换失败抛出异常
+         * @return 转换失败返回false,参数值不变
          */
         bool fromString(const std::string& val) override {
              try {
                 //m_val = boost::lexical_cast<T>(val);
                 //将从Yaml中导出的参数值导入
                 setValue(Fromstr()(val));
+                return true;
             } catch (std::exception& e) {
                 MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "ConfigVar::toString exception"
                     << e.what() << "convert: string to" << typeid(m_val).name()  << " - " << val;
@@ -276,41 +498,163 @@ public:
             return false;
         }
 
-        const T getValue() const { return m_val; }
+        bool encodeBinary(const std::string& val, std::string& out) override {
+            return encodeBinaryImpl(val, out, std::integral_constant<bool, ConfigBinary<T>::supported>());
+        }
+
+        bool decodeBinary(const char* data, size_t len) override {
+            return decodeBinaryImpl(data, len, std::integral_constant<bool, ConfigBinary<T>::supported>());
+        }
 
-        //如果参数的值有发生变化,则通知对应的注册回调函数
+        const T getValue() const {
+            RWMutexType::ReadLock lock(m_mutex);
+            return m_val;
+        }
+
+        //如果参数的值有发生变化,写入新值后通知对应的注册回调函数
+        //当前线程存在配置事务时只记录新值,由事务统一提交
         void setValue(const T& v) { 
-            if(v == m_val) {
+            ConfigTransaction* txn = ConfigTransaction::GetThis();
+            if(txn) {
+                txn->addCommit([this, v](ConfigTransaction& t) {
+                    commitValue(v, t);
+                });
                 return;
             }
-            for(auto& i : m_cbs) {
-                i.second(m_val, v);
+            //在写锁内比较并替换,并发的setValue各自拿到连续的旧值和新值
+            std::shared_ptr<const T> old_value;
+            std::vector<on_change_cb> cbs;
+            {
+                RWMutexType::WriteLock lock(m_mutex);
+                if(v == m_val) {
+                    return;
+                }
+                old_value.reset(new T(m_val));
+                m_val = v;
+                for(auto& i : m_cbs) {
+                    cbs.push_back(i.second);
+                }
+            }
+            BumpEpoch();
+            //回调在锁外执行,回调里可以访问本参数
+            for(auto& cb : cbs) {
+                cb(*old_value, v);
             }
-            m_val = v;
         }
         std::string getTypeName() const override { return typeid(T).name();}
         //增加监听，前面键值后面函数调用
         void addListener(uint64_t key, on_change_cb cb) {
+            RWMutexType::WriteLock lock(m_mutex);
             m_cbs[key] = cb;
         }
 
         void delListener(uint64_t key) {
+            RWMutexType::WriteLock lock(m_mutex);
             m_cbs.erase(key);
         }
         on_change_cb getListener(uint64_t key) {
+            RWMutexType::ReadLock lock(m_mutex);
             auto it = m_cbs.find(key);
             return it == m_cbs.end() ? nullptr : it->second;
         }
 
         void clearListener() {
+            RWMutexType::WriteLock lock(m_mutex);
             m_cbs.clear();
         }
 private:
+        //事务提交时写入新值,回调放入事务的通知批次
+        void commitValue(const T& v, ConfigTransaction& txn) {
+            std::shared_ptr<const T> old_value;
+            std::shared_ptr<const T> new_value(new T(v));
+            std::vector<std::pair<uint64_t, on_change_cb> > cbs;
+            {
+                RWMutexType::WriteLock lock(m_mutex);
+                if(v == m_val) {
+                    return;
+                }
+                old_value.reset(new T(m_val));
+                m_val = v;
+                cbs.assign(m_cbs.begin(), m_cbs.end());
+            }
+            BumpEpoch();
+            for(auto& i : cbs) {
+                on_change_cb cb = i.second;
+                txn.addNotify(m_name, i.first, [cb, old_value, new_value]() {
+                    cb(*old_value, *new_value);
+                });
+            }
+        }
+
+        bool encodeBinaryImpl(const std::string& val, std::string& out, std::true_type) {
+            try {
+                ConfigBinary<T>::encode(Fromstr()(val), out);
+                return true;
+            } catch (std::exception& e) {
+                MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "ConfigVar::encodeBinary exception"
+                    << e.what() << " convert: string to" << typeid(m_val).name() << " - " << val;
+            }
+            return false;
+        }
+
+        bool encodeBinaryImpl(const std::string& val, std::string& out, std::false_type) {
+            return false;
+        }
+
+        bool decodeBinaryImpl(const char* data, size_t len, std::true_type) {
+            T v;
+            if(!ConfigBinary<T>::decode(data, len, v)) {
+                return false;
+            }
+            setValue(v);
+            return true;
+        }
+
+        bool decodeBinaryImpl(const char* data, size_t len, std::false_type) {
+            return false;
+        }
+private:
+    mutable RWMutexType m_mutex;
     T m_val;
     //变更回调函数组，
     std::map<uint64_t, on_change_cb> m_cbs;
 
 };
+/**
+ * @brief ConfigVar的线程局部缓存
+ * @details 需要声明成thread_local使用,例如
+ *          static thread_local ConfigVarCache<int> s_timeout(g_timeout);
+ *          读取时只比较一次全局版本号,没有变化直接返回本地副本,
+ *          热路径上不加锁也不写任何共享的cache line
+ */
+template <class T, class Fromstr = LexicalCast<std::string, T>, class Tostr = LexicalCast<T, std::string> >
+class ConfigVarCache {
+public:
+    typedef ConfigVar<T, Fromstr, Tostr> VarType;
+
+    ConfigVarCache(typename VarType::ptr var)
+        :m_var(var)
+        ,m_epoch(ConfigVarBase::GetEpoch())
+        ,m_val(var->getValue()) {
+    }
+
+    //先读版本号再读值,值更新后版本号才递增,不会把旧值当成新版本缓存
+    const T& getValue() {
+        uint64_t epoch = ConfigVarBase::GetEpoch();
+        if(epoch != m_epoch) {
+            m_val = m_var->getValue();
+            m_epoch = epoch;
+        }
+        return m_val;
+    }
+
+    const typename VarType::ptr& getVar() const { return m_var; }
+private:
+    typename VarType::ptr m_var;
+    uint64_t m_epoch;
+    T m_val;
+};
+
 /**
  * @brief ConfigVar的管理类
  * @details 提供便捷的方法创建/访问ConfigVar
@@ -318,6 +662,15 @@ private:
 class Config {
 public:
     typedef std::map<std::string, ConfigVarBase::ptr> ConfigVarMap;
+    //参数表注册后几乎只读,读锁不争用同一个cache line
+    typedef PolicyRWMutex<BRMutex> RWMutexType;
+
+    //监听回调的耗时统计
+    struct ListenerStat {
+        std::string name;       //配置参数名称
+        uint64_t key;           //监听者的键值
+        uint64_t elapse_us;     //回调耗时(微秒)
+    };
     /**
      * @brief 获取/创建对应参数名的配置参数
      * @param[in] name 配置参数名称
@@ -331,28 +684,45 @@ public:
     //查找配置
     template<class T>
     static typename ConfigVar<T>::ptr Lookup(const std::string& name, const T& default_value, const std::string& description = "") {
-        auto it = GetDatas().find(name);
-        if(it != GetDatas().end()) {
-            auto tmp = std::dynamic_pointer_cast<ConfigVar<T> > (it->second);
-            if(tmp) {
-                MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "Lookup name=" << "exists";
-                return tmp;
-            } else {
-                MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "Lookup name=" << "exists but type not" << typeid(T).name() << " real_type=" << it->second->getTypeName();
-                return nullptr;
-            }
+        //日志在锁外输出
+        ConfigVarBase::ptr exists = LookupBase(name);
+        if(exists) {
+            return CastVar<T>(exists);
         }
-        if(name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._012345678") != std::string::npos) {
+        if(name.find_first_not_of("abcdefghijklmnopqrstuvwxyz._0123456789") != std::string::npos) {
             MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "Lookup name invalid" << name;
             throw std::invalid_argument(name);
         }
-        typename ConfigVar<T>::ptr v(new ConfigVar<T>(name, default_value, description));
-        GetDatas()[name] = v;
+        {
+            RWMutexType::WriteLock lock(GetMutex());
+            //加写锁前可能已被其它线程创建
+            auto it = GetDatas().find(name);
+            if(it == GetDatas().end()) {
+                typename ConfigVar<T>::ptr v(new ConfigVar<T>(name, default_value, description));
+                GetDatas()[name] = v;
+                return v;
+            }
+            exists = it->second;
+        }
+        return CastVar<T>(exists);
+    }
+
+    /**
+     * @brief 获取/创建配置参数,参数名已存在但类型不匹配时抛出异常
+     * @exception 类型不匹配或参数名非法时抛出 std::invalid_argument
+     */
+    template<class T>
+    static typename ConfigVar<T>::ptr LookupChecked(const std::string& name, const T& default_value, const std::string& description = "") {
+        auto v = Lookup(name, default_value, description);
+        if(!v) {
+            throw std::invalid_argument("config " + name + " exists but type not " + typeid(T).name());
+        }
         return v;
     }
 
     template<class T>
     static typename ConfigVar<T>::ptr Lookup(const std::string& name) {
+        RWMutexType::ReadLock lock(GetMutex());
         auto it = GetDatas().find(name);
         if(it == GetDatas().end()) {
             return nullptr;
@@ -362,16 +732,133 @@ public:
 
     static void LoadFromYaml(const YAML::Node& root);
 
+    /**
+     * @brief 从配置文件加载配置
+     * @param[in] yaml_file YAML配置文件
+     * @param[in] snapshot_file 由config_compile生成的二进制快照,为空则直接解析YAML
+     * @details 快照与yaml_file的hash一致时直接使用快照,否则回退到解析YAML
+     */
+    static void LoadFromFile(const std::string& yaml_file, const std::string& snapshot_file = "");
+
+    /**
+     * @brief 设置监听回调是否在后台线程批量分发
+     * @details 后台分发时reload线程不会被监听回调阻塞,批次之间保持顺序
+     */
+    static void SetListenerAsync(bool v);
+    static bool IsListenerAsync();
+
+    /**
+     * @brief 等待已提交的监听回调全部执行完
+     */
+    static void FlushListeners();
+
+    /**
+     * @brief 获取最近一批监听回调的耗时统计
+     */
+    static std::vector<ListenerStat> GetListenerStats();
+
+    /**
+     * @brief 将YAML展开成 "a.b.c" -> node 的列表,父节点在子节点之前
+     */
+    static void ListAllMember(const YAML::Node& root
+                              ,std::list<std::pair<std::string, const YAML::Node> >& output);
+
 //不能返回纯虚函数的类，但是可以返回他的智能指针
     static ConfigVarBase::ptr LookupBase(const std::string& name);
+
+    /**
+     * @brief 遍历所有已注册的配置参数(按参数名排序)
+     */
+    static void Visit(std::function<void(ConfigVarBase::ptr)> cb);
 private:
+    //已存在的参数转换成ConfigVar<T>,类型不匹配返回nullptr
+    template<class T>
+    static typename ConfigVar<T>::ptr CastVar(const ConfigVarBase::ptr& var) {
+        auto tmp = std::dynamic_pointer_cast<ConfigVar<T> >(var);
+        if(tmp) {
+            MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "Lookup name=" << var->getName() << " exists";
+        } else {
+            MYSERVER_LOG_ERROR(MYSERVER_LOG_ROOT()) << "Lookup name=" << var->getName() << " exists but type not "
+                << typeid(T).name() << " real_type=" << var->getTypeName();
+        }
+        return tmp;
+    }
+
 //成员函数会调用静态成员变量，所以用函数封装
     static ConfigVarMap& GetDatas() {
             static ConfigVarMap m_datas;
             return m_datas;
         }
+    static RWMutexType& GetMutex() {
+        static RWMutexType s_mutex;
+        return s_mutex;
+    }
 };
 
+//编译期校验配置参数名,规则与Lookup一致: [a-z0-9._]
+constexpr bool IsValidConfigChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '_';
+}
+
+constexpr bool IsValidConfigNameImpl(const char* name) {
+    return *name == 0 ? true : (IsValidConfigChar(*name) && IsValidConfigNameImpl(name + 1));
 }
 
+constexpr bool IsValidConfigName(const char* name) {
+    return *name != 0 && IsValidConfigNameImpl(name);
+}
+
+}
+
+/**
+ * @brief 声明一组强类型的配置参数
+ * @details FIELDS是形如 XX(类型, 成员名, "参数名", 默认值, "描述") 的列表宏,
+ *          生成名为Class的结构体:
+ *              每个参数对应一个成员变量和 成员名_var() 访问器(直接持有ConfigVar,不查map)
+ *              load() 一次性把所有参数值读到结构体
+ *              Get() 返回已经load好的结构体
+ *              Register() 注册全部参数,定义处的静态变量会在main之前调用
+ *          参数名在编译期校验,同名参数类型不一致时Register抛出std::invalid_argument
+ *          类型或默认值中带逗号时需要加括号,如 (std::vector<int>{1, 2}),类型可以先typedef
+ * @code
+ * #define SERVER_CONFIG_FIELDS(XX) \
+ *     XX(int, port, "server.port", 8080, "server port") \
+ *     XX(std::string, name, "server.name", "myserver", "server name")
+ * MYSERVER_CONFIG_SCHEMA(ServerConfig, SERVER_CONFIG_FIELDS)
+ *
+ * ServerConfig conf = ServerConfig::Get();
+ * @endcode
+ */
+#define MYSERVER_CONFIG_SCHEMA(Class, FIELDS) \
+    struct Class { \
+        FIELDS(MYSERVER_CONFIG_FIELD_DECLARE) \
+        void load() { \
+            FIELDS(MYSERVER_CONFIG_FIELD_LOAD) \
+        } \
+        static Class Get() { \
+            Class c; \
+            c.load(); \
+            return c; \
+        } \
+        static bool Register() { \
+            FIELDS(MYSERVER_CONFIG_FIELD_REGISTER) \
+            return true; \
+        } \
+    }; \
+    static bool __attribute__((unused)) s_##Class##_schema_registered = Class::Register();
+
+#define MYSERVER_CONFIG_FIELD_DECLARE(type, name, key, def, desc) \
+    static_assert(MyServer::IsValidConfigName(key), "invalid config name: " key); \
+    type name = def; \
+    static const MyServer::ConfigVar<type>::ptr& name##_var() { \
+        static MyServer::ConfigVar<type>::ptr s_var = MyServer::Config::LookupChecked<type>(key, def, desc); \
+        return s_var; \
+    }
+
+#define MYSERVER_CONFIG_FIELD_LOAD(type, name, key, def, desc) \
+    name = name##_var()->getValue();
+
+#define MYSERVER_CONFIG_FIELD_REGISTER(type, name, key, def, desc) \
+    name##_var();
+
 #endif
\ No newline at end of file
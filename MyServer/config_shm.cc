@@ -0,0 +1,162 @@
+#include "config_shm.h"
+#include "config_snapshot.h"
+#include "log.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <string.h>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+static const char s_magic[8] = {'M', 'Y', 'S', 'H', 'M', 0, 0, 0};
+
+ConfigShm::ConfigShm(const std::string& name, bool writer)
+    :m_name(name)
+    ,m_writer(writer) {
+}
+
+ConfigShm::~ConfigShm() {
+    if(m_region) {
+        munmap(m_region, m_mapSize);
+    }
+}
+
+ConfigShm::ptr ConfigShm::Create(const std::string& name, size_t capacity) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if(fd < 0) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigShm::Create shm_open " << name << " fail, errno=" << errno;
+        return nullptr;
+    }
+    size_t size = sizeof(Region) + capacity * 2;
+    if(ftruncate(fd, size)) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigShm::Create ftruncate " << name << " fail, errno=" << errno;
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigShm::Create mmap " << name << " fail, errno=" << errno;
+        return nullptr;
+    }
+
+    ConfigShm::ptr shm(new ConfigShm(name, true));
+    shm->m_region = (Region*)addr;
+    shm->m_mapSize = size;
+
+    Region* r = shm->m_region;
+    r->capacity = capacity;
+    r->size[0] = r->size[1] = 0;
+    r->state.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    //magic最后写,Attach看到magic时其它字段已经初始化
+    memcpy(r->magic, s_magic, sizeof(s_magic));
+    return shm;
+}
+
+ConfigShm::ptr ConfigShm::Attach(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigShm::Attach shm_open " << name << " fail, errno=" << errno;
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) || (size_t)st.st_size < sizeof(Region)) {
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigShm::Attach mmap " << name << " fail, errno=" << errno;
+        return nullptr;
+    }
+
+    ConfigShm::ptr shm(new ConfigShm(name, false));
+    shm->m_region = (Region*)addr;
+    shm->m_mapSize = st.st_size;
+    Region* r = shm->m_region;
+    if(memcmp(r->magic, s_magic, sizeof(s_magic))
+            || sizeof(Region) + r->capacity * 2 > (size_t)st.st_size) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigShm::Attach " << name << " invalid region";
+        return nullptr;
+    }
+    return shm;
+}
+
+void ConfigShm::Unlink(const std::string& name) {
+    shm_unlink(name.c_str());
+}
+
+char* ConfigShm::buffer(uint32_t idx) const {
+    return (char*)(m_region + 1) + idx * m_region->capacity;
+}
+
+uint64_t ConfigShm::getVersion() const {
+    return m_region->state.load(std::memory_order_acquire) >> 2;
+}
+
+bool ConfigShm::publish() {
+    if(!m_writer) {
+        return false;
+    }
+    std::string image = ConfigSnapshot::Dump();
+    if(image.size() > m_region->capacity) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigShm::publish " << m_name << " snapshot size="
+            << image.size() << " > capacity=" << m_region->capacity;
+        return false;
+    }
+
+    uint64_t st = m_region->state.load(std::memory_order_relaxed);
+    uint64_t seq = st >> 1;
+    uint32_t active = st & 1;
+    uint32_t idx = 1 - active;
+
+    //序号变为奇数,开始写非活跃缓冲区
+    m_region->state.store(((seq + 1) << 1) | active, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(buffer(idx), image.c_str(), image.size());
+    m_region->size[idx] = image.size();
+    //写完后切换活跃缓冲区,序号变回偶数
+    m_region->state.store(((seq + 2) << 1) | idx, std::memory_order_release);
+    return true;
+}
+
+bool ConfigShm::sync() {
+    std::string image;
+    uint64_t version = 0;
+    while(true) {
+        uint64_t st1 = m_region->state.load(std::memory_order_acquire);
+        uint64_t seq1 = st1 >> 1;
+        version = seq1 >> 1;
+        if(version == 0 || version == m_syncVersion) {
+            return false;
+        }
+        uint32_t idx = st1 & 1;
+        uint64_t size = m_region->size[idx];
+        if(size <= m_region->capacity) {
+            image.assign(buffer(idx), size);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t seq2 = m_region->state.load(std::memory_order_relaxed) >> 1;
+        //发布者下一次写这个缓冲区时序号会超过(seq1 | 1) + 1
+        if(seq2 <= (seq1 | 1) + 1 && size <= m_region->capacity) {
+            break;
+        }
+        sched_yield();
+    }
+
+    ConfigSnapshot snapshot;
+    if(!snapshot.load(image)) {
+        return false;
+    }
+    snapshot.apply();
+    m_syncVersion = version;
+    return true;
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef __MYSERVER_CONFIG_SHM_H__
+#define __MYSERVER_CONFIG_SHM_H__
+
+#include <memory>
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+namespace MyServer {
+
+/**
+ * @brief 多进程共享的配置区
+ * @details 一个进程(发布者)解析配置后把所有已注册参数的值以ConfigSnapshot格式
+ *          发布到POSIX共享内存,其它进程(worker)只读映射后同步到本进程的ConfigVar,
+ *          一次reload整机只解析一次YAML
+ *          共享区是双缓冲: 发布者总是写非活跃的缓冲区,写完再切换,
+ *          状态字 = (序号 << 1) | 活跃缓冲区下标,序号为奇数表示正在写,
+ *          读者拷贝活跃缓冲区后检查序号,期间被覆盖则重试(seqlock)
+ *          只支持一个发布者
+ */
+class ConfigShm {
+public:
+    typedef std::shared_ptr<ConfigShm> ptr;
+
+    struct Region {
+        char magic[8];                      //"MYSHM\0\0\0"
+        uint64_t capacity;                  //单个缓冲区大小
+        std::atomic<uint64_t> state;        //(序号 << 1) | 活跃缓冲区
+        uint64_t size[2];                   //缓冲区中快照的大小
+        char padding[24];
+        //之后是两个capacity大小的缓冲区
+    };
+
+    ~ConfigShm();
+
+    /**
+     * @brief 发布者创建共享配置区(已存在则重建)
+     * @param[in] name shm_open的名称,如 "/myserver_config"
+     * @param[in] capacity 单个缓冲区大小,需要能放下全部配置
+     */
+    static ConfigShm::ptr Create(const std::string& name, size_t capacity = 4 * 1024 * 1024);
+
+    /**
+     * @brief worker只读映射已存在的共享配置区
+     */
+    static ConfigShm::ptr Attach(const std::string& name);
+
+    /**
+     * @brief 删除共享配置区的名称,已映射的进程不受影响
+     */
+    static void Unlink(const std::string& name);
+
+    /**
+     * @brief 发布当前进程所有已注册参数的值
+     * @return 快照超过capacity或者只读映射时返回false
+     */
+    bool publish();
+
+    /**
+     * @brief 发布版本有变化时同步到本进程的ConfigVar
+     * @details 同步走配置事务,监听回调按批次分发
+     * @return 有新版本并且已生效返回true
+     */
+    bool sync();
+
+    //最近一次发布完成的版本号,0表示还没有发布过
+    uint64_t getVersion() const;
+
+    const std::string& getName() const { return m_name; }
+    bool isWriter() const { return m_writer; }
+private:
+    ConfigShm(const std::string& name, bool writer);
+    ConfigShm(const ConfigShm&) = delete;
+    ConfigShm& operator=(const ConfigShm&) = delete;
+
+    char* buffer(uint32_t idx) const;
+private:
+    std::string m_name;
+    bool m_writer;
+    Region* m_region = nullptr;
+    size_t m_mapSize = 0;
+    //本进程最近同步的版本
+    uint64_t m_syncVersion = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,385 @@
+#include "config_snapshot.h"
+#include "config.h"
+#include "log.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+static const char s_magic[8] = {'M', 'Y', 'S', 'C', 'F', 'G', 0, 0};
+
+static bool ReadFile(const std::string& file, std::string& content) {
+    std::ifstream ifs(file, std::ios::binary);
+    if(!ifs) {
+        return false;
+    }
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+uint64_t ConfigSnapshot::Hash(const char* data, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string ConfigSnapshot::Build(const std::vector<std::pair<std::string, std::string> >& items
+                                  ,uint64_t source_hash) {
+    std::vector<Entry> entries;
+    std::string blob;
+    auto append = [&blob](const std::string& str, uint32_t& off, uint32_t& len) {
+        off = blob.size();
+        len = str.size();
+        blob.append(str);
+    };
+
+    for(auto& i : items) {
+        std::string type;
+        std::string binary;
+        ConfigVarBase::ptr var = Config::LookupBase(i.first);
+        if(var) {
+            type = var->getTypeName();
+            if(!var->encodeBinary(i.second, binary)) {
+                binary.clear();
+            }
+        }
+
+        Entry e;
+        append(i.first, e.key_off, e.key_len);
+        append(type, e.type_off, e.type_len);
+        append(i.second, e.value_off, e.value_len);
+        append(binary, e.binary_off, e.binary_len);
+        entries.push_back(e);
+    }
+
+    std::vector<uint32_t> index(entries.size());
+    for(size_t i = 0; i < index.size(); ++i) {
+        index[i] = i;
+    }
+    std::stable_sort(index.begin(), index.end(), [&items](uint32_t a, uint32_t b) {
+        return items[a].first < items[b].first;
+    });
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, s_magic, sizeof(h.magic));
+    h.version = VERSION;
+    h.count = entries.size();
+    h.source_hash = source_hash;
+    h.entry_offset = sizeof(Header);
+    h.index_offset = h.entry_offset + entries.size() * sizeof(Entry);
+    h.data_offset = h.index_offset + index.size() * sizeof(uint32_t);
+    h.file_size = h.data_offset + blob.size();
+
+    std::string out;
+    out.reserve(h.file_size);
+    out.append((const char*)&h, sizeof(h));
+    if(!entries.empty()) {
+        out.append((const char*)&entries[0], entries.size() * sizeof(Entry));
+        out.append((const char*)&index[0], index.size() * sizeof(uint32_t));
+    }
+    out.append(blob);
+    return out;
+}
+
+bool ConfigSnapshot::Compile(const std::string& yaml_file, const std::string& snapshot_file) {
+    std::string content;
+    if(!ReadFile(yaml_file, content)) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::Compile open " << yaml_file << " fail";
+        return false;
+    }
+
+    std::list<std::pair<std::string, const YAML::Node> > all_node;
+    try {
+        Config::ListAllMember(YAML::Load(content), all_node);
+    } catch (std::exception& e) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::Compile parse " << yaml_file
+            << " exception " << e.what();
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string> > items;
+    for(auto& i : all_node) {
+        std::string key = i.first;
+        if(key.empty()) {
+            continue;
+        }
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+        if(i.second.IsScalar()) {
+            items.push_back(std::make_pair(key, i.second.Scalar()));
+        } else {
+            std::stringstream ss;
+            ss << i.second;
+            items.push_back(std::make_pair(key, ss.str()));
+        }
+    }
+    std::string out = Build(items, Hash(content.c_str(), content.size()));
+
+    std::string tmp = snapshot_file + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if(!ofs || !ofs.write(out.c_str(), out.size())) {
+            MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::Compile write " << tmp << " fail";
+            return false;
+        }
+    }
+    if(rename(tmp.c_str(), snapshot_file.c_str())) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::Compile rename " << tmp
+            << " to " << snapshot_file << " fail, errno=" << errno;
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+//schema中的类型名 -> 注册对应类型的参数
+typedef std::function<void(const std::string&)> SchemaRegister;
+
+template <class T>
+static SchemaRegister MakeSchemaRegister() {
+    return [](const std::string& name) {
+        Config::Lookup(name, T(), "schema");
+    };
+}
+
+int ConfigSnapshot::RegisterSchema(const std::string& schema_file) {
+    static const std::map<std::string, SchemaRegister> s_types = {
+#define XX(name, type) \
+        {#name, MakeSchemaRegister<type>()},
+        XX(int16, int16_t)
+        XX(int32, int32_t)
+        XX(int64, int64_t)
+        XX(uint16, uint16_t)
+        XX(uint32, uint32_t)
+        XX(uint64, uint64_t)
+        XX(float, float)
+        XX(double, double)
+#undef XX
+    };
+
+    std::list<std::pair<std::string, const YAML::Node> > all_node;
+    try {
+        Config::ListAllMember(YAML::LoadFile(schema_file), all_node);
+    } catch (std::exception& e) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::RegisterSchema parse " << schema_file
+            << " exception " << e.what();
+        return -1;
+    }
+    int count = 0;
+    for(auto& i : all_node) {
+        if(i.first.empty() || !i.second.IsScalar()) {
+            continue;
+        }
+        std::string key = i.first;
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        auto it = s_types.find(i.second.Scalar());
+        if(it == s_types.end()) {
+            MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::RegisterSchema " << schema_file
+                << " unknown type " << i.second.Scalar() << " for " << key;
+            return -1;
+        }
+        if(Config::LookupBase(key)) {
+            continue;
+        }
+        it->second(key);
+        ++count;
+    }
+    return count;
+}
+
+std::string ConfigSnapshot::Dump() {
+    std::vector<std::pair<std::string, std::string> > items;
+    Config::Visit([&items](ConfigVarBase::ptr var) {
+        items.push_back(std::make_pair(var->getName(), var->toString()));
+    });
+    return Build(items, 0);
+}
+
+ConfigSnapshot::ConfigSnapshot() {
+}
+
+ConfigSnapshot::~ConfigSnapshot() {
+    close();
+}
+
+bool ConfigSnapshot::open(const std::string& snapshot_file) {
+    close();
+    int fd = ::open(snapshot_file.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) || (size_t)st.st_size < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(addr == MAP_FAILED) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::open mmap " << snapshot_file
+            << " fail, errno=" << errno;
+        return false;
+    }
+    m_base = (char*)addr;
+    m_size = st.st_size;
+    m_mapped = true;
+    if(!validate()) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::open " << snapshot_file << " invalid format";
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ConfigSnapshot::load(const std::string& image) {
+    close();
+    if(image.size() < sizeof(Header)) {
+        return false;
+    }
+    m_buffer = image;
+    m_base = &m_buffer[0];
+    m_size = m_buffer.size();
+    if(!validate()) {
+        MYSERVER_LOG_ERROR(g_logger) << "ConfigSnapshot::load invalid format, size=" << image.size();
+        close();
+        return false;
+    }
+    return true;
+}
+
+//校验格式,任何越界都视为无效快照
+bool ConfigSnapshot::validate() const {
+    const Header* h = header();
+    bool ok = memcmp(h->magic, s_magic, sizeof(s_magic)) == 0
+        && h->version == VERSION
+        && h->file_size == m_size
+        && h->entry_offset == sizeof(Header)
+        && h->index_offset == h->entry_offset + (uint64_t)h->count * sizeof(Entry)
+        && h->data_offset == h->index_offset + (uint64_t)h->count * sizeof(uint32_t)
+        && h->data_offset <= m_size;
+    if(ok) {
+        uint64_t data_size = m_size - h->data_offset;
+        const Entry* e = entries();
+        const uint32_t* index = (const uint32_t*)(m_base + h->index_offset);
+        for(uint32_t i = 0; ok && i < h->count; ++i) {
+            ok = (uint64_t)e[i].key_off + e[i].key_len <= data_size
+                && (uint64_t)e[i].type_off + e[i].type_len <= data_size
+                && (uint64_t)e[i].value_off + e[i].value_len <= data_size
+                && (uint64_t)e[i].binary_off + e[i].binary_len <= data_size
+                && index[i] < h->count;
+        }
+    }
+    return ok;
+}
+
+void ConfigSnapshot::close() {
+    if(m_base && m_mapped) {
+        munmap(m_base, m_size);
+    }
+    m_base = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+}
+
+bool ConfigSnapshot::isFresh(const std::string& yaml_file) const {
+    if(!m_base) {
+        return false;
+    }
+    std::string content;
+    if(!ReadFile(yaml_file, content)) {
+        return false;
+    }
+    return Hash(content.c_str(), content.size()) == header()->source_hash;
+}
+
+uint64_t ConfigSnapshot::getSourceHash() const {
+    return m_base ? header()->source_hash : 0;
+}
+
+uint32_t ConfigSnapshot::size() const {
+    return m_base ? header()->count : 0;
+}
+
+uint32_t ConfigSnapshot::getBinaryCount() const {
+    uint32_t count = 0;
+    const Entry* e = m_base ? entries() : nullptr;
+    for(uint32_t i = 0; i < size(); ++i) {
+        if(e[i].binary_len) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+const ConfigSnapshot::Entry* ConfigSnapshot::entries() const {
+    return (const Entry*)(m_base + header()->entry_offset);
+}
+
+const char* ConfigSnapshot::data() const {
+    return m_base + header()->data_offset;
+}
+
+bool ConfigSnapshot::find(const std::string& key, std::string& value) const {
+    if(!m_base) {
+        return false;
+    }
+    const Entry* e = entries();
+    const char* d = data();
+    const uint32_t* index = (const uint32_t*)(m_base + header()->index_offset);
+    const uint32_t* end = index + header()->count;
+    auto it = std::lower_bound(index, end, key, [e, d](uint32_t i, const std::string& k) {
+        return k.compare(0, std::string::npos, d + e[i].key_off, e[i].key_len) > 0;
+    });
+    if(it == end || key.compare(0, std::string::npos, d + e[*it].key_off, e[*it].key_len) != 0) {
+        return false;
+    }
+    value.assign(d + e[*it].value_off, e[*it].value_len);
+    return true;
+}
+
+size_t ConfigSnapshot::apply() const {
+    if(!m_base) {
+        return 0;
+    }
+    size_t applied = 0;
+    //与LoadFromYaml一样整体提交
+    ConfigTransaction txn;
+    const Entry* e = entries();
+    const char* d = data();
+    for(uint32_t i = 0; i < header()->count; ++i) {
+        ConfigVarBase::ptr var = Config::LookupBase(std::string(d + e[i].key_off, e[i].key_len));
+        if(!var) {
+            continue;
+        }
+        //类型一致才能直接使用二进制值,否则走字符串转换
+        if(e[i].binary_len
+                && var->getTypeName().compare(0, std::string::npos, d + e[i].type_off, e[i].type_len) == 0
+                && var->decodeBinary(d + e[i].binary_off, e[i].binary_len)) {
+            ++applied;
+            continue;
+        }
+        if(var->fromString(std::string(d + e[i].value_off, e[i].value_len))) {
+            ++applied;
+        }
+    }
+    txn.commit();
+    return applied;
+}
+
+}
@@ -0,0 +1,141 @@
+#ifndef __MYSERVER_CONFIG_SNAPSHOT_H__
+#define __MYSERVER_CONFIG_SNAPSHOT_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace MyServer {
+
+/**
+ * @brief 预编译的二进制配置快照
+ * @details 由YAML配置文件编译生成,可以直接mmap加载,跳过yaml-cpp解析
+ *          文件布局: Header | Entry[count] | 按key排序的索引uint32[count] | 数据区
+ *          Entry按YAML展开顺序保存(父节点在前),与LoadFromYaml的生效顺序一致
+ *          已注册的基础类型参数额外保存二进制值,加载时不需要LexicalCast
+ */
+class ConfigSnapshot {
+public:
+    typedef std::shared_ptr<ConfigSnapshot> ptr;
+
+    static const uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[8];          //"MYSCFG\0\0"
+        uint32_t version;       //格式版本
+        uint32_t count;         //Entry数量
+        uint64_t source_hash;   //源YAML文件内容的hash
+        uint64_t file_size;     //快照文件大小
+        uint32_t entry_offset;  //Entry数组偏移
+        uint32_t index_offset;  //排序索引偏移
+        uint32_t data_offset;   //数据区偏移
+        uint32_t reserved;
+    };
+
+    //所有offset都相对数据区起始位置
+    struct Entry {
+        uint32_t key_off;
+        uint32_t key_len;
+        uint32_t type_off;      //编译时已注册参数的类型名,未注册为空
+        uint32_t type_len;
+        uint32_t value_off;     //与LoadFromYaml传给fromString的字符串一致
+        uint32_t value_len;
+        uint32_t binary_off;    //encodeBinary的结果,不支持为空
+        uint32_t binary_len;
+    };
+
+    ConfigSnapshot();
+    ~ConfigSnapshot();
+
+    /**
+     * @brief 将YAML配置文件编译成二进制快照
+     * @details 先写临时文件再rename,保证加载方不会读到写了一半的快照
+     * @return 成功返回true
+     */
+    static bool Compile(const std::string& yaml_file, const std::string& snapshot_file);
+
+    /**
+     * @brief 按schema文件注册基础类型的参数,使Compile能为它们保存二进制值
+     * @details 编译工具不链接业务代码时使用,schema是参数名到类型名的YAML映射,
+     *          可以嵌套也可以直接写点分的参数名,如
+     *              server:
+     *                port: int32
+     *                ratio: double
+     *          支持int16..int64、uint16..uint64、float、double;
+     *          类型名与业务进程中ConfigVar的类型一致,加载快照时才会使用二进制值
+     *          已注册的参数跳过
+     * @return 新注册的参数数量,文件无法解析或类型未知时返回-1
+     */
+    static int RegisterSchema(const std::string& schema_file);
+
+    /**
+     * @brief 把当前所有已注册参数的值序列化成快照,source_hash为0
+     * @details 用于把已经解析好的配置发布给其它进程,见ConfigShm
+     */
+    static std::string Dump();
+
+    /**
+     * @brief 计算数据的hash(FNV-1a 64)
+     */
+    static uint64_t Hash(const char* data, size_t len);
+
+    /**
+     * @brief mmap打开快照文件并校验格式
+     */
+    bool open(const std::string& snapshot_file);
+    /**
+     * @brief 从内存中的快照数据打开(会拷贝一份)
+     */
+    bool load(const std::string& image);
+    void close();
+
+    bool isOpen() const { return m_base != nullptr; }
+
+    /**
+     * @brief 快照是否与源YAML文件一致
+     */
+    bool isFresh(const std::string& yaml_file) const;
+
+    uint64_t getSourceHash() const;
+    uint32_t size() const;
+    //保存了二进制值的配置项数量
+    uint32_t getBinaryCount() const;
+
+    /**
+     * @brief 通过排序索引二分查找配置项的值
+     * @param[out] value 与fromString接受的格式一致
+     */
+    bool find(const std::string& key, std::string& value) const;
+
+    /**
+     * @brief 将快照中的配置项设置到已注册的ConfigVar
+     * @return 生效的配置项数量
+     */
+    size_t apply() const;
+
+private:
+    ConfigSnapshot(const ConfigSnapshot&) = delete;
+    ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+
+    //items: 参数名 -> fromString接受的字符串
+    static std::string Build(const std::vector<std::pair<std::string, std::string> >& items
+                             ,uint64_t source_hash);
+
+    bool validate() const;
+    const Header* header() const { return (const Header*)m_base; }
+    const Entry* entries() const;
+    const char* data() const;
+
+private:
+    char* m_base = nullptr;
+    size_t m_size = 0;
+    //m_base是否是mmap出来的
+    bool m_mapped = false;
+    //load()时保存数据
+    std::string m_buffer;
+};
+
+}
+
+#endif
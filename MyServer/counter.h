@@ -0,0 +1,126 @@
+#ifndef __MYSERVER_COUNTER_H__
+#define __MYSERVER_COUNTER_H__
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include "util.h"
+
+namespace MyServer {
+
+/**
+ * @brief 按线程分片的数据
+ * @details 每个分片独占cache line,线程通过GetThreadSlot()取自己的分片,
+ *          不同线程修改各自的分片,不会在核之间来回传递同一个cache line
+ *          线程数超过SLOTS时多个线程共享一个分片,分片里的数据要能承受并发修改
+ *          (如ShardedCounter用relaxed原子操作)
+ *          SLOTS必须是2的幂
+ */
+template<class T, uint32_t SLOTS = 64>
+class PerCpu {
+public:
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "PerCpu SLOTS must be power of 2");
+
+    PerCpu() {}
+
+    //当前线程的分片
+    T& local() {
+        return m_slots[GetThreadSlot() & (SLOTS - 1)].value;
+    }
+    //第i个分片
+    T& get(uint32_t i) {
+        return m_slots[i].value;
+    }
+    const T& get(uint32_t i) const {
+        return m_slots[i].value;
+    }
+    //分片数
+    static constexpr uint32_t size() { return SLOTS;}
+
+    //遍历所有分片
+    template<class Cb>
+    void foreach(Cb cb) {
+        for(uint32_t i = 0; i < SLOTS; ++i) {
+            cb(m_slots[i].value);
+        }
+    }
+    template<class Cb>
+    void foreach(Cb cb) const {
+        for(uint32_t i = 0; i < SLOTS; ++i) {
+            cb(m_slots[i].value);
+        }
+    }
+private:
+    PerCpu(const PerCpu&) = delete;
+    PerCpu& operator=(const PerCpu&) = delete;
+
+    struct alignas(64) Slot {
+        T value{};
+    };
+private:
+    Slot m_slots[SLOTS];
+};
+
+/**
+ * @brief 分片计数器,用于请求数、字节数这类写多读少的统计
+ * @details 增加只对本线程的分片做一次relaxed原子加,不加锁,
+ *          没有其它线程共享分片时不会有cache line争用
+ *          get汇总所有分片,代价与分片数成正比;并发修改时读到的是某个近似时刻的和
+ */
+template<class T = int64_t, uint32_t SLOTS = 64>
+class ShardedCounter {
+public:
+    ShardedCounter() {
+        reset();
+    }
+
+    //增加v
+    void add(T v = 1) {
+        m_shards.local().fetch_add(v, std::memory_order_relaxed);
+    }
+    //减少v
+    void sub(T v = 1) {
+        m_shards.local().fetch_sub(v, std::memory_order_relaxed);
+    }
+    ShardedCounter& operator++() {
+        add(1);
+        return *this;
+    }
+    ShardedCounter& operator+=(T v) {
+        add(v);
+        return *this;
+    }
+
+    //所有分片的和
+    T get() const {
+        T sum = 0;
+        m_shards.foreach([&sum](const std::atomic<T>& v) {
+            sum += v.load(std::memory_order_relaxed);
+        });
+        return sum;
+    }
+    operator T() const {
+        return get();
+    }
+
+    //清零,与并发的add同时调用时可能丢掉部分增量
+    void reset() {
+        m_shards.foreach([](std::atomic<T>& v) {
+            v.store(0, std::memory_order_relaxed);
+        });
+    }
+    //读取总和并清零,适合周期性上报增量
+    T exchange() {
+        T sum = 0;
+        m_shards.foreach([&sum](std::atomic<T>& v) {
+            sum += v.exchange(0, std::memory_order_relaxed);
+        });
+        return sum;
+    }
+private:
+    PerCpu<std::atomic<T>, SLOTS> m_shards;
+};
+
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "fd_manager.h"
+#include "hook.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace MyServer {
+
+FdCtx::FdCtx(int fd)
+    :m_isInit(false)
+    ,m_isSocket(false)
+    ,m_sysNonblock(false)
+    ,m_userNonblock(false)
+    ,m_isClosed(false)
+    ,m_fd(fd)
+    ,m_recvTimeout(~0ull)
+    ,m_sendTimeout(~0ull) {
+    init();
+}
+
+FdCtx::~FdCtx() {
+}
+
+bool FdCtx::init() {
+    if(m_isInit) {
+        return true;
+    }
+    struct stat fd_stat;
+    if(fstat(m_fd, &fd_stat) == -1) {
+        m_isInit = false;
+        m_isSocket = false;
+    } else {
+        m_isInit = true;
+        m_isSocket = S_ISSOCK(fd_stat.st_mode);
+    }
+
+    m_userNonblock = false;
+    if(m_isSocket) {
+        //使用原始的fcntl,不影响用户看到的标志
+        //创建时已经是非阻塞的(SOCK_NONBLOCK)按用户设置处理
+        int flags = fcntl_f(m_fd, F_GETFL, 0);
+        if(flags & O_NONBLOCK) {
+            m_userNonblock = true;
+        } else {
+            fcntl_f(m_fd, F_SETFL, flags | O_NONBLOCK);
+        }
+        m_sysNonblock = true;
+    } else {
+        m_sysNonblock = false;
+    }
+    m_isClosed = false;
+    return m_isInit;
+}
+
+void FdCtx::setTimeout(int type, uint64_t v) {
+    if(type == SO_RCVTIMEO) {
+        m_recvTimeout = v;
+    } else {
+        m_sendTimeout = v;
+    }
+}
+
+uint64_t FdCtx::getTimeout(int type) const {
+    if(type == SO_RCVTIMEO) {
+        return m_recvTimeout;
+    }
+    return m_sendTimeout;
+}
+
+FdManager::FdManager() {
+    m_datas.resize(64);
+}
+
+FdCtx::ptr FdManager::get(int fd, bool auto_create) {
+    if(fd < 0) {
+        return nullptr;
+    }
+    {
+        RWMutexType::ReadLock lock(m_mutex);
+        if((int)m_datas.size() > fd) {
+            if(m_datas[fd] || !auto_create) {
+                return m_datas[fd];
+            }
+        } else if(!auto_create) {
+            return nullptr;
+        }
+    }
+
+    RWMutexType::WriteLock lock(m_mutex);
+    if((int)m_datas.size() <= fd) {
+        m_datas.resize(fd * 1.5 + 1);
+    }
+    if(!m_datas[fd]) {
+        m_datas[fd].reset(new FdCtx(fd));
+    }
+    return m_datas[fd];
+}
+
+void FdManager::del(int fd) {
+    RWMutexType::WriteLock lock(m_mutex);
+    if((int)m_datas.size() <= fd || fd < 0) {
+        return;
+    }
+    m_datas[fd].reset();
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef __MYSERVER_FD_MANAGER_H__
+#define __MYSERVER_FD_MANAGER_H__
+
+#include <memory>
+#include <vector>
+#include "thread.h"
+#include "singleton.h"
+
+namespace MyServer {
+
+/**
+ * @brief 文件句柄上下文
+ * @details 记录fd是否是socket、用户是否主动设置了非阻塞以及读写超时
+ *          socket在hook开启时由系统层设置为非阻塞,用户看到的仍然是阻塞语义
+ */
+class FdCtx : public std::enable_shared_from_this<FdCtx> {
+public:
+    typedef std::shared_ptr<FdCtx> ptr;
+
+    FdCtx(int fd);
+    ~FdCtx();
+
+    bool isInit() const { return m_isInit;}
+    bool isSocket() const { return m_isSocket;}
+    bool isClose() const { return m_isClosed;}
+
+    //用户主动设置的非阻塞
+    void setUserNonblock(bool v) { m_userNonblock = v;}
+    bool getUserNonblock() const { return m_userNonblock;}
+
+    //hook设置的非阻塞
+    void setSysNonblock(bool v) { m_sysNonblock = v;}
+    bool getSysNonblock() const { return m_sysNonblock;}
+
+    /**
+     * @brief 设置超时
+     * @param[in] type SO_RCVTIMEO或SO_SNDTIMEO
+     * @param[in] v 毫秒,~0ull表示不超时
+     */
+    void setTimeout(int type, uint64_t v);
+    uint64_t getTimeout(int type) const;
+private:
+    bool init();
+private:
+    bool m_isInit: 1;
+    bool m_isSocket: 1;
+    bool m_sysNonblock: 1;
+    bool m_userNonblock: 1;
+    bool m_isClosed: 1;
+    int m_fd;
+    uint64_t m_recvTimeout;
+    uint64_t m_sendTimeout;
+};
+
+/**
+ * @brief 文件句柄管理
+ * @details 按fd下标保存FdCtx,只有hook创建或接收的socket才会登记
+ */
+class FdManager {
+public:
+    typedef RWMutex RWMutexType;
+
+    FdManager();
+
+    /**
+     * @brief 获取fd的上下文
+     * @param[in] auto_create 不存在时是否创建
+     * @return 不存在且auto_create为false时返回nullptr
+     */
+    FdCtx::ptr get(int fd, bool auto_create = false);
+
+    //fd关闭时删除
+    void del(int fd);
+private:
+    RWMutexType m_mutex;
+    std::vector<FdCtx::ptr> m_datas;
+};
+
+typedef Singleton<FdManager> FdMgr;
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+#include "fiber.h"
+#include "fiber_stack.h"
+#include "config.h"
+#include "log.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <sched.h>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+static std::atomic<uint64_t> s_fiber_id{0};
+static std::atomic<uint64_t> s_fiber_count{0};
+
+//当前线程正在执行的协程
+static thread_local Fiber* t_fiber = nullptr;
+//当前线程的主协程
+static thread_local Fiber::ptr t_thread_fiber = nullptr;
+
+static ConfigVar<uint32_t>::ptr g_fiber_stack_size =
+    Config::Lookup<uint32_t>("fiber.stack_size", 128 * 1024, "fiber stack size");
+
+using StackAllocator = FiberStackPool;
+
+#if MYSERVER_FIBER_ASM
+/**
+ * 保存callee-saved寄存器和mxcsr/x87控制字到当前栈,把栈指针存到*from_sp,
+ * 切换到to_sp并恢复,ret返回到目标协程上次切换出去的位置
+ * 新协程的栈由initContext构造,ret直接进入Fiber::MainFunc
+ */
+extern "C" void myserver_fiber_switch(void** from_sp, void* to_sp);
+
+__asm__(
+    ".text\n"
+    ".globl myserver_fiber_switch\n"
+    ".hidden myserver_fiber_switch\n"
+    ".type myserver_fiber_switch,@function\n"
+    ".p2align 4\n"
+    "myserver_fiber_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size myserver_fiber_switch, .-myserver_fiber_switch\n"
+);
+#endif
+
+Fiber::Fiber() {
+    m_state = EXEC;
+    m_running = true;
+    SetThis(this);
+    ++s_fiber_count;
+}
+
+Fiber::Fiber(std::function<void()> cb, size_t stacksize)
+    :m_id(++s_fiber_id)
+    ,m_cb(cb) {
+    ++s_fiber_count;
+    static thread_local ConfigVarCache<uint32_t> s_stack_size(g_fiber_stack_size);
+    m_stacksize = stacksize ? stacksize : s_stack_size.getValue();
+    m_stack = StackAllocator::Alloc(m_stacksize);
+    if(!m_stack) {
+        throw std::bad_alloc();
+    }
+    initContext();
+}
+
+Fiber::~Fiber() {
+    --s_fiber_count;
+    if(m_stack) {
+        assert(m_state == INIT || m_state == TERM || m_state == EXCEPT);
+        StackAllocator::Dealloc(m_stack, m_stacksize);
+    } else {
+        //主协程
+        assert(!m_cb);
+        assert(m_state == EXEC);
+        if(t_fiber == this) {
+            SetThis(nullptr);
+        }
+    }
+}
+
+void Fiber::initContext() {
+#if MYSERVER_FIBER_ASM
+    //按myserver_fiber_switch恢复的顺序构造初始栈,ret后rsp % 16 == 8,与call进入函数时一致
+    uintptr_t top = ((uintptr_t)m_stack + m_stacksize) & ~(uintptr_t)15;
+    void** sp = (void**)top;
+    *--sp = nullptr;                    //MainFunc的返回地址,MainFunc不会返回
+    *--sp = (void*)&Fiber::MainFunc;    //ret的目标
+    for(int i = 0; i < 6; ++i) {
+        *--sp = nullptr;                //rbp rbx r12 r13 r14 r15
+    }
+    //mxcsr和x87控制字的默认值
+    *--sp = (void*)(0x1F80ull | (0x037Full << 32));
+    m_sp = sp;
+#else
+    if(getcontext(&m_ctx)) {
+        assert(false);
+    }
+    m_ctx.uc_link = nullptr;
+    m_ctx.uc_stack.ss_sp = m_stack;
+    m_ctx.uc_stack.ss_size = m_stacksize;
+    makecontext(&m_ctx, &Fiber::MainFunc, 0);
+#endif
+}
+
+void Fiber::reset(std::function<void()> cb) {
+    assert(m_stack);
+    assert(m_state == INIT || m_state == TERM || m_state == EXCEPT);
+    m_cb = cb;
+    initContext();
+    m_state = INIT;
+}
+
+void Fiber::Switch(Fiber* from, Fiber* to) {
+#if MYSERVER_FIBER_ASM
+    myserver_fiber_switch(&from->m_sp, to->m_sp);
+#else
+    if(swapcontext(&from->m_ctx, &to->m_ctx)) {
+        assert(false);
+    }
+#endif
+}
+
+void Fiber::resume() {
+    //协程刚在其它线程yield时,等那个线程切换出来再切进去
+    while(m_running.exchange(true, std::memory_order_acquire)) {
+        sched_yield();
+    }
+    assert(m_state == INIT || m_state == HOLD);
+    //主协程由t_thread_fiber持有,这里不需要增加引用计数
+    m_caller = t_fiber ? t_fiber : GetThis().get();
+    m_state = EXEC;
+    SetThis(this);
+    Switch(m_caller, this);
+    //协程已经yield或结束,上下文保存完毕
+    m_running.store(false, std::memory_order_release);
+}
+
+void Fiber::yield() {
+    assert(t_fiber == this);
+    assert(m_caller);
+    Fiber* caller = m_caller;
+    m_caller = nullptr;
+    if(m_state == EXEC) {
+        m_state = HOLD;
+    }
+    SetThis(caller);
+    Switch(this, caller);
+}
+
+void Fiber::SetThis(Fiber* f) {
+    t_fiber = f;
+}
+
+Fiber::ptr Fiber::GetThis() {
+    if(t_fiber) {
+        return t_fiber->shared_from_this();
+    }
+    Fiber::ptr main_fiber(new Fiber);
+    assert(t_fiber == main_fiber.get());
+    t_thread_fiber = main_fiber;
+    return t_fiber->shared_from_this();
+}
+
+void Fiber::Yield() {
+    assert(t_fiber && t_fiber != t_thread_fiber.get());
+    t_fiber->yield();
+}
+
+uint64_t Fiber::TotalFibers() {
+    return s_fiber_count;
+}
+
+uint64_t Fiber::GetFiberId() {
+    if(t_fiber) {
+        return t_fiber->getId();
+    }
+    return 0;
+}
+
+void Fiber::MainFunc() {
+    //这里不持有shared_ptr,否则最后一次yield之后引用永远不会释放
+    Fiber* cur = t_fiber;
+    assert(cur);
+    try {
+        cur->m_cb();
+        cur->m_cb = nullptr;
+        cur->m_state = TERM;
+    } catch (std::exception& ex) {
+        cur->m_cb = nullptr;
+        cur->m_state = EXCEPT;
+        MYSERVER_LOG_ERROR(g_logger) << "Fiber Except: " << ex.what()
+            << " fiber_id=" << cur->getId();
+    } catch (...) {
+        cur->m_cb = nullptr;
+        cur->m_state = EXCEPT;
+        MYSERVER_LOG_ERROR(g_logger) << "Fiber Except"
+            << " fiber_id=" << cur->getId();
+    }
+    cur->yield();
+    //结束的协程不会再被resume
+    abort();
+}
+
+}
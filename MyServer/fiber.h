@@ -0,0 +1,116 @@
+#ifndef __MYSERVER_FIBER_H__
+#define __MYSERVER_FIBER_H__
+
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <stdint.h>
+
+//x86_64使用手写的上下文切换,只保存callee-saved寄存器,不走sigprocmask系统调用
+//其它平台或者定义了MYSERVER_FIBER_UCONTEXT时使用ucontext
+#if defined(__x86_64__) && !defined(MYSERVER_FIBER_UCONTEXT)
+#define MYSERVER_FIBER_ASM 1
+#else
+#define MYSERVER_FIBER_ASM 0
+#include <ucontext.h>
+#endif
+
+namespace MyServer {
+
+/**
+ * @brief 有栈协程
+ * @details 每个线程第一次调用GetThis()时创建主协程(使用线程栈)
+ *          resume()从当前协程切换到目标协程,并记录当前协程为调用方,
+ *          yield()切换回调用方,所以协程可以嵌套resume
+ *          协程可以在一个线程yield,在另一个线程resume
+ */
+class Fiber : public std::enable_shared_from_this<Fiber> {
+public:
+    typedef std::shared_ptr<Fiber> ptr;
+
+    enum State {
+        //创建或reset后还没有执行
+        INIT,
+        //yield挂起
+        HOLD,
+        //正在执行
+        EXEC,
+        //执行结束
+        TERM,
+        //执行时抛出异常
+        EXCEPT
+    };
+
+    /**
+     * @param[in] cb 协程执行的函数
+     * @param[in] stacksize 栈大小,0表示使用配置fiber.stack_size
+     */
+    Fiber(std::function<void()> cb, size_t stacksize = 0);
+    ~Fiber();
+
+    /**
+     * @brief 复用协程的栈执行新的函数
+     * @pre 状态为INIT, TERM, EXCEPT
+     */
+    void reset(std::function<void()> cb);
+
+    /**
+     * @brief 切换到该协程执行,直到它yield或结束
+     * @pre 状态为INIT, HOLD
+     * @details 其它线程还没有从该协程切换出来时会等待切换完成
+     */
+    void resume();
+
+    /**
+     * @brief 切换回调用resume的协程,状态变为HOLD(执行结束时为TERM/EXCEPT)
+     * @pre 必须是当前正在执行的协程
+     */
+    void yield();
+
+    uint64_t getId() const { return m_id;}
+    State getState() const { return m_state;}
+    //执行结束(TERM或EXCEPT)
+    bool isFinished() const { return m_state == TERM || m_state == EXCEPT;}
+
+public:
+    //设置当前线程正在执行的协程
+    static void SetThis(Fiber* f);
+    //返回当前线程正在执行的协程,没有则创建主协程
+    static Fiber::ptr GetThis();
+    //当前协程yield回调用方
+    static void Yield();
+    //协程总数
+    static uint64_t TotalFibers();
+    //当前协程的id,不在协程中返回0
+    static uint64_t GetFiberId();
+private:
+    //主协程
+    Fiber();
+    Fiber(const Fiber&) = delete;
+    Fiber& operator=(const Fiber&) = delete;
+
+    void initContext();
+    //从from切换到to
+    static void Switch(Fiber* from, Fiber* to);
+    static void MainFunc();
+private:
+    uint64_t m_id = 0;
+    uint32_t m_stacksize = 0;
+    State m_state = INIT;
+    void* m_stack = nullptr;
+#if MYSERVER_FIBER_ASM
+    //切换出去时保存的栈指针
+    void* m_sp = nullptr;
+#else
+    ucontext_t m_ctx;
+#endif
+    //resume该协程的协程
+    Fiber* m_caller = nullptr;
+    //从resume到切换回调用方期间为true,防止其它线程在切换完成前resume
+    std::atomic<bool> m_running{false};
+    std::function<void()> m_cb;
+};
+
+}
+
+#endif
@@ -0,0 +1,187 @@
+#include "fiber_stack.h"
+#include "config.h"
+#include "log.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+static ConfigVar<bool>::ptr g_fiber_stack_guard =
+    Config::Lookup<bool>("fiber.stack_guard", true, "fiber stack guard page");
+
+static ConfigVar<uint32_t>::ptr g_stack_pool_high_water =
+    Config::Lookup<uint32_t>("fiber.stack_pool.high_water", 32, "fiber stack pool committed stacks per thread");
+
+static ConfigVar<uint32_t>::ptr g_stack_pool_max_cached =
+    Config::Lookup<uint32_t>("fiber.stack_pool.max_cached", 1024, "fiber stack pool max cached stacks per thread");
+
+static std::atomic<uint64_t> s_total_stacks{0};
+
+static size_t PageSize() {
+    static size_t s_page_size = sysconf(_SC_PAGESIZE);
+    return s_page_size;
+}
+
+static size_t RoundSize(size_t size) {
+    size_t page = PageSize();
+    return (size + page - 1) & ~(page - 1);
+}
+
+//栈下面多映射一页作为guard页,vp是guard页之上的地址
+static void* MapStack(size_t size, bool guard) {
+    size_t page = PageSize();
+    void* base = mmap(nullptr, size + page, PROT_READ | PROT_WRITE
+                      ,MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if(base == MAP_FAILED) {
+        MYSERVER_LOG_ERROR(g_logger) << "FiberStackPool mmap size=" << size
+            << " fail, errno=" << errno;
+        return nullptr;
+    }
+    if(guard && mprotect(base, page, PROT_NONE)) {
+        //一般是超过了vm.max_map_count,没有guard页也可以正常使用
+        static bool s_warned = false;
+        if(!s_warned) {
+            s_warned = true;
+            MYSERVER_LOG_WARN(g_logger) << "FiberStackPool mprotect guard page fail, errno=" << errno
+                << ", stacks=" << s_total_stacks;
+        }
+    }
+    ++s_total_stacks;
+    return (char*)base + page;
+}
+
+static void UnmapStack(void* vp, size_t size) {
+    size_t page = PageSize();
+    munmap((char*)vp - page, size + page);
+    --s_total_stacks;
+}
+
+//线程退出时StackCache已经析构,之后释放的栈直接munmap
+static thread_local bool t_cache_destroyed = false;
+
+namespace {
+
+//当前线程的空闲栈,按大小分桶,一般只有fiber.stack_size一种大小
+struct StackCache {
+    struct Bucket {
+        size_t size;
+        //保留物理内存的栈,后进先出,最近用过的栈cache更热
+        std::vector<void*> hot;
+        //已经madvise过的栈
+        std::vector<void*> cold;
+    };
+
+    StackCache()
+        :guard(g_fiber_stack_guard)
+        ,highWater(g_stack_pool_high_water)
+        ,maxCached(g_stack_pool_max_cached) {
+    }
+
+    ~StackCache() {
+        trim();
+        t_cache_destroyed = true;
+    }
+
+    Bucket& get(size_t size) {
+        for(auto& i : buckets) {
+            if(i.size == size) {
+                return i;
+            }
+        }
+        buckets.push_back(Bucket());
+        buckets.back().size = size;
+        return buckets.back();
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for(auto& i : buckets) {
+            n += i.hot.size() + i.cold.size();
+        }
+        return n;
+    }
+
+    void trim() {
+        for(auto& i : buckets) {
+            for(auto s : i.hot) {
+                UnmapStack(s, i.size);
+            }
+            for(auto s : i.cold) {
+                UnmapStack(s, i.size);
+            }
+            i.hot.clear();
+            i.cold.clear();
+        }
+    }
+
+    std::vector<Bucket> buckets;
+    //配置的线程局部缓存,和StackCache一起析构
+    ConfigVarCache<bool> guard;
+    ConfigVarCache<uint32_t> highWater;
+    ConfigVarCache<uint32_t> maxCached;
+};
+
+}
+
+static thread_local StackCache t_cache;
+
+void* FiberStackPool::Alloc(size_t size) {
+    size = RoundSize(size);
+    if(t_cache_destroyed) {
+        return MapStack(size, g_fiber_stack_guard->getValue());
+    }
+    StackCache::Bucket& b = t_cache.get(size);
+    if(!b.hot.empty()) {
+        void* vp = b.hot.back();
+        b.hot.pop_back();
+        return vp;
+    }
+    if(!b.cold.empty()) {
+        void* vp = b.cold.back();
+        b.cold.pop_back();
+        return vp;
+    }
+    return MapStack(size, t_cache.guard.getValue());
+}
+
+void FiberStackPool::Dealloc(void* vp, size_t size) {
+    if(!vp) {
+        return;
+    }
+    size = RoundSize(size);
+    if(t_cache_destroyed) {
+        UnmapStack(vp, size);
+        return;
+    }
+    StackCache::Bucket& b = t_cache.get(size);
+    if(b.hot.size() < t_cache.highWater.getValue()) {
+        b.hot.push_back(vp);
+        return;
+    }
+    if(b.hot.size() + b.cold.size() < t_cache.maxCached.getValue()) {
+        //映射保留,物理页还给系统,再次使用时按需缺页
+        madvise(vp, size, MADV_DONTNEED);
+        b.cold.push_back(vp);
+        return;
+    }
+    UnmapStack(vp, size);
+}
+
+uint64_t FiberStackPool::TotalStacks() {
+    return s_total_stacks;
+}
+
+size_t FiberStackPool::CachedStacks() {
+    return t_cache_destroyed ? 0 : t_cache.count();
+}
+
+void FiberStackPool::Trim() {
+    if(!t_cache_destroyed) {
+        t_cache.trim();
+    }
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef __MYSERVER_FIBER_STACK_H__
+#define __MYSERVER_FIBER_STACK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace MyServer {
+
+/**
+ * @brief 协程栈分配器
+ * @details 栈用mmap(MAP_NORESERVE)分配,只有真正用到的页才占用物理内存,
+ *          最低地址处有一个PROT_NONE的guard页,栈溢出时直接SIGSEGV而不是踩坏其它内存
+ *          释放的栈放进当前线程的空闲链表,下次同样大小的分配直接复用,不需要系统调用
+ *          每个线程缓存超过fiber.stack_pool.high_water个栈后,再缓存的栈先用
+ *          madvise(MADV_DONTNEED)归还物理内存;超过fiber.stack_pool.max_cached个则munmap
+ *          注意: 每个带guard页的栈占两个VMA,大量协程时需要调大vm.max_map_count
+ *          或者关闭fiber.stack_guard
+ */
+class FiberStackPool {
+public:
+    /**
+     * @brief 分配栈
+     * @param[in] size 栈大小,向上取整到页大小
+     * @return 栈的最低可用地址,失败返回nullptr
+     */
+    static void* Alloc(size_t size);
+
+    /**
+     * @brief 释放栈,size必须和Alloc时一致
+     */
+    static void Dealloc(void* vp, size_t size);
+
+    //所有线程mmap出来还没有munmap的栈数量
+    static uint64_t TotalStacks();
+    //当前线程缓存的空闲栈数量
+    static size_t CachedStacks();
+    //munmap当前线程缓存的所有空闲栈
+    static void Trim();
+};
+
+}
+
+#endif
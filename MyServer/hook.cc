@@ -0,0 +1,530 @@
+#include "hook.h"
+#include "fd_manager.h"
+#include "iomanager.h"
+#include "fiber.h"
+#include "config.h"
+#include "log.h"
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <errno.h>
+#include <sched.h>
+#include <atomic>
+#include <sys/ioctl.h>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+static ConfigVar<int>::ptr g_tcp_connect_timeout =
+    Config::Lookup<int>("tcp.connect.timeout", 5000, "tcp connect timeout");
+
+static thread_local bool t_hook_enable = false;
+
+#define HOOK_FUN(XX) \
+    XX(sleep) \
+    XX(usleep) \
+    XX(nanosleep) \
+    XX(socket) \
+    XX(connect) \
+    XX(accept) \
+    XX(read) \
+    XX(readv) \
+    XX(recv) \
+    XX(recvfrom) \
+    XX(recvmsg) \
+    XX(write) \
+    XX(writev) \
+    XX(send) \
+    XX(sendto) \
+    XX(sendmsg) \
+    XX(close) \
+    XX(fcntl) \
+    XX(ioctl) \
+    XX(getsockopt) \
+    XX(setsockopt)
+
+static void hook_init() {
+    static bool is_inited = false;
+    if(is_inited) {
+        return;
+    }
+    is_inited = true;
+#define XX(name) name ## _f = (name ## _fun)dlsym(RTLD_NEXT, #name);
+    HOOK_FUN(XX);
+#undef XX
+}
+
+struct _HookIniter {
+    _HookIniter() {
+        hook_init();
+    }
+};
+
+static _HookIniter s_hook_initer;
+
+bool is_hook_enable() {
+    return t_hook_enable;
+}
+
+void set_hook_enable(bool flag) {
+    t_hook_enable = flag;
+}
+
+//在IOManager的子协程中才能让出,主协程(idle等)里只能阻塞
+static IOManager* YieldableIOManager() {
+    IOManager* iom = IOManager::GetThis();
+    if(iom && Fiber::GetFiberId() != 0) {
+        return iom;
+    }
+    return nullptr;
+}
+
+//超时毫秒转换为poll的参数
+static int PollTimeout(uint64_t timeout_ms) {
+    if(timeout_ms == ~0ull) {
+        return -1;
+    }
+    return timeout_ms > (uint64_t)INT_MAX ? INT_MAX : (int)timeout_ms;
+}
+
+namespace {
+
+//等待状态: 0等待中,超时回调取消成功后为ETIMEDOUT
+//超时回调和被唤醒的协程在不同线程,用原子变量交接
+static const int s_wait_firing = -1;  //超时回调正在取消事件
+static const int s_wait_done = -2;    //协程已被事件唤醒,之后的超时回调不再处理
+
+struct timer_info {
+    std::atomic<int> cancelled{0};
+};
+
+}
+
+/**
+ * @brief 等待fd就绪
+ * @details 在协程中向IOManager注册事件后让出,超时由条件定时器取消事件;
+ *          不能让出时阻塞在poll上
+ * @return 就绪返回0,超时或出错返回-1并设置errno
+ */
+static int WaitFdReady(int fd, IOManager::Event event, uint64_t timeout_ms, const char* hook_fun_name) {
+    IOManager* iom = YieldableIOManager();
+    if(!iom) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = event == IOManager::READ ? POLLIN : POLLOUT;
+        pfd.revents = 0;
+        int rt = 0;
+        do {
+            rt = poll(&pfd, 1, PollTimeout(timeout_ms));
+        } while(rt == -1 && errno == EINTR);
+        if(rt == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        return rt > 0 ? 0 : -1;
+    }
+
+    std::shared_ptr<timer_info> tinfo(new timer_info);
+    std::weak_ptr<timer_info> winfo(tinfo);
+    Timer::ptr timer;
+    if(timeout_ms != ~0ull) {
+        timer = iom->addConditionTimer(timeout_ms, [winfo, fd, iom, event]() {
+            std::shared_ptr<timer_info> t = winfo.lock();
+            int expected = 0;
+            if(!t || !t->cancelled.compare_exchange_strong(expected, s_wait_firing)) {
+                return;
+            }
+            //事件已经触发时取消失败,协程按就绪处理,不报告超时
+            bool removed = iom->cancelEvent(fd, event);
+            t->cancelled.store(removed ? ETIMEDOUT : 0);
+        }, winfo);
+    }
+
+    if(iom->addEvent(fd, event)) {
+        MYSERVER_LOG_ERROR(g_logger) << hook_fun_name << " addEvent("
+            << fd << ", " << event << ") fail";
+        if(timer) {
+            timer->cancel();
+        }
+        return -1;
+    }
+    Fiber::Yield();
+    if(timer) {
+        timer->cancel();
+    }
+    int state = 0;
+    while(!tinfo->cancelled.compare_exchange_weak(state, s_wait_done)) {
+        if(state == ETIMEDOUT) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        //超时回调在cancelEvent和写入结果之间,等它写完
+        if(state == s_wait_firing) {
+            sched_yield();
+        }
+        state = 0;
+    }
+    return 0;
+}
+
+//在协程中用定时器唤醒代替阻塞
+static void SleepFor(IOManager* iom, uint64_t ms) {
+    Fiber::ptr fiber = Fiber::GetThis();
+    iom->addTimer(ms, [iom, fiber]() {
+        iom->schedule(fiber);
+    });
+    Fiber::Yield();
+}
+
+}
+
+/**
+ * @brief 读写的公共流程
+ * @param[in] event 返回EAGAIN时等待的事件
+ * @param[in] timeout_so 超时类型SO_RCVTIMEO或SO_SNDTIMEO
+ */
+template<typename OriginFun, typename... Args>
+static ssize_t do_io(int fd, OriginFun fun, const char* hook_fun_name
+                     ,MyServer::IOManager::Event event, int timeout_so, Args&&... args) {
+    if(!MyServer::t_hook_enable) {
+        return fun(fd, std::forward<Args>(args)...);
+    }
+    MyServer::FdCtx::ptr ctx = MyServer::FdMgr::GetInstance()->get(fd);
+    if(!ctx) {
+        return fun(fd, std::forward<Args>(args)...);
+    }
+    if(ctx->isClose()) {
+        errno = EBADF;
+        return -1;
+    }
+    if(!ctx->isSocket() || ctx->getUserNonblock()) {
+        return fun(fd, std::forward<Args>(args)...);
+    }
+
+    uint64_t to = ctx->getTimeout(timeout_so);
+    while(true) {
+        ssize_t n = fun(fd, args...);
+        while(n == -1 && errno == EINTR) {
+            n = fun(fd, args...);
+        }
+        if(n != -1 || errno != EAGAIN) {
+            return n;
+        }
+        if(MyServer::WaitFdReady(fd, event, to, hook_fun_name)) {
+            return -1;
+        }
+    }
+}
+
+extern "C" {
+#define XX(name) name ## _fun name ## _f = nullptr;
+    HOOK_FUN(XX);
+#undef XX
+
+unsigned int sleep(unsigned int seconds) {
+    MyServer::IOManager* iom = MyServer::t_hook_enable ? MyServer::YieldableIOManager() : nullptr;
+    if(!iom) {
+        return sleep_f(seconds);
+    }
+    MyServer::SleepFor(iom, seconds * 1000ull);
+    return 0;
+}
+
+int usleep(useconds_t usec) {
+    MyServer::IOManager* iom = MyServer::t_hook_enable ? MyServer::YieldableIOManager() : nullptr;
+    if(!iom) {
+        return usleep_f(usec);
+    }
+    //不足1毫秒的部分向上取整,避免变成0毫秒的定时器
+    MyServer::SleepFor(iom, (usec + 999ull) / 1000);
+    return 0;
+}
+
+int nanosleep(const struct timespec* req, struct timespec* rem) {
+    MyServer::IOManager* iom = MyServer::t_hook_enable ? MyServer::YieldableIOManager() : nullptr;
+    if(!iom) {
+        return nanosleep_f(req, rem);
+    }
+    MyServer::SleepFor(iom, req->tv_sec * 1000ull + (req->tv_nsec + 999999ull) / 1000000);
+    if(rem) {
+        rem->tv_sec = 0;
+        rem->tv_nsec = 0;
+    }
+    return 0;
+}
+
+int socket(int domain, int type, int protocol) {
+    if(!MyServer::t_hook_enable) {
+        return socket_f(domain, type, protocol);
+    }
+    int fd = socket_f(domain, type, protocol);
+    if(fd == -1) {
+        return fd;
+    }
+    MyServer::FdMgr::GetInstance()->get(fd, true);
+    return fd;
+}
+
+int connect_with_timeout(int fd, const struct sockaddr* addr, socklen_t addrlen, uint64_t timeout_ms) {
+    if(!MyServer::t_hook_enable) {
+        return connect_f(fd, addr, addrlen);
+    }
+    MyServer::FdCtx::ptr ctx = MyServer::FdMgr::GetInstance()->get(fd);
+    if(!ctx) {
+        return connect_f(fd, addr, addrlen);
+    }
+    if(ctx->isClose()) {
+        errno = EBADF;
+        return -1;
+    }
+    if(!ctx->isSocket() || ctx->getUserNonblock()) {
+        return connect_f(fd, addr, addrlen);
+    }
+
+    int n = connect_f(fd, addr, addrlen);
+    if(n == 0) {
+        return 0;
+    } else if(n != -1 || errno != EINPROGRESS) {
+        return n;
+    }
+    if(MyServer::WaitFdReady(fd, MyServer::IOManager::WRITE, timeout_ms, "connect")) {
+        return -1;
+    }
+
+    int error = 0;
+    socklen_t len = sizeof(int);
+    if(-1 == getsockopt_f(fd, SOL_SOCKET, SO_ERROR, &error, &len)) {
+        return -1;
+    }
+    if(!error) {
+        return 0;
+    }
+    errno = error;
+    return -1;
+}
+
+int connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen) {
+    static thread_local MyServer::ConfigVarCache<int> s_timeout(MyServer::g_tcp_connect_timeout);
+    int timeout = s_timeout.getValue();
+    return connect_with_timeout(sockfd, addr, addrlen, timeout > 0 ? (uint64_t)timeout : ~0ull);
+}
+
+int accept(int s, struct sockaddr* addr, socklen_t* addrlen) {
+    int fd = do_io(s, accept_f, "accept", MyServer::IOManager::READ, SO_RCVTIMEO, addr, addrlen);
+    if(fd >= 0 && MyServer::t_hook_enable) {
+        MyServer::FdMgr::GetInstance()->get(fd, true);
+    }
+    return fd;
+}
+
+ssize_t read(int fd, void* buf, size_t count) {
+    return do_io(fd, read_f, "read", MyServer::IOManager::READ, SO_RCVTIMEO, buf, count);
+}
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt) {
+    return do_io(fd, readv_f, "readv", MyServer::IOManager::READ, SO_RCVTIMEO, iov, iovcnt);
+}
+
+ssize_t recv(int sockfd, void* buf, size_t len, int flags) {
+    return do_io(sockfd, recv_f, "recv", MyServer::IOManager::READ, SO_RCVTIMEO, buf, len, flags);
+}
+
+ssize_t recvfrom(int sockfd, void* buf, size_t len, int flags, struct sockaddr* src_addr, socklen_t* addrlen) {
+    return do_io(sockfd, recvfrom_f, "recvfrom", MyServer::IOManager::READ, SO_RCVTIMEO
+                 ,buf, len, flags, src_addr, addrlen);
+}
+
+ssize_t recvmsg(int sockfd, struct msghdr* msg, int flags) {
+    return do_io(sockfd, recvmsg_f, "recvmsg", MyServer::IOManager::READ, SO_RCVTIMEO, msg, flags);
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+    return do_io(fd, write_f, "write", MyServer::IOManager::WRITE, SO_SNDTIMEO, buf, count);
+}
+
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
+    return do_io(fd, writev_f, "writev", MyServer::IOManager::WRITE, SO_SNDTIMEO, iov, iovcnt);
+}
+
+ssize_t send(int s, const void* msg, size_t len, int flags) {
+    return do_io(s, send_f, "send", MyServer::IOManager::WRITE, SO_SNDTIMEO, msg, len, flags);
+}
+
+ssize_t sendto(int s, const void* msg, size_t len, int flags, const struct sockaddr* to, socklen_t tolen) {
+    return do_io(s, sendto_f, "sendto", MyServer::IOManager::WRITE, SO_SNDTIMEO, msg, len, flags, to, tolen);
+}
+
+ssize_t sendmsg(int s, const struct msghdr* msg, int flags) {
+    return do_io(s, sendmsg_f, "sendmsg", MyServer::IOManager::WRITE, SO_SNDTIMEO, msg, flags);
+}
+
+int close(int fd) {
+    //fd号会被复用,无论是否开启hook都要删除上下文
+    MyServer::FdCtx::ptr ctx = MyServer::FdMgr::GetInstance()->get(fd);
+    if(ctx) {
+        MyServer::IOManager* iom = MyServer::IOManager::GetThis();
+        if(iom) {
+            iom->cancelAll(fd);
+        }
+        MyServer::FdMgr::GetInstance()->del(fd);
+    }
+    return close_f(fd);
+}
+
+int fcntl(int fd, int cmd, ... /* arg */ ) {
+    va_list va;
+    va_start(va, cmd);
+    switch(cmd) {
+        case F_SETFL:
+            {
+                int arg = va_arg(va, int);
+                va_end(va);
+                MyServer::FdCtx::ptr ctx = MyServer::FdMgr::GetInstance()->get(fd);
+                if(!ctx || ctx->isClose() || !ctx->isSocket()) {
+                    return fcntl_f(fd, cmd, arg);
+                }
+                //记录用户的设置,系统层保持hook需要的非阻塞
+                ctx->setUserNonblock(arg & O_NONBLOCK);
+                if(ctx->getSysNonblock()) {
+                    arg |= O_NONBLOCK;
+                } else {
+                    arg &= ~O_NONBLOCK;
+                }
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+        case F_GETFL:
+            {
+                va_end(va);
+                int arg = fcntl_f(fd, cmd);
+                MyServer::FdCtx::ptr ctx = MyServer::FdMgr::GetInstance()->get(fd);
+                if(arg == -1 || !ctx || ctx->isClose() || !ctx->isSocket()) {
+                    return arg;
+                }
+                if(ctx->getUserNonblock()) {
+                    return arg | O_NONBLOCK;
+                } else {
+                    return arg & ~O_NONBLOCK;
+                }
+            }
+            break;
+        case F_DUPFD:
+        case F_DUPFD_CLOEXEC:
+        case F_SETFD:
+        case F_SETOWN:
+        case F_SETSIG:
+        case F_SETLEASE:
+        case F_NOTIFY:
+#ifdef F_SETPIPE_SZ
+        case F_SETPIPE_SZ:
+#endif
+#ifdef F_ADD_SEALS
+        case F_ADD_SEALS:
+#endif
+            {
+                int arg = va_arg(va, int);
+                va_end(va);
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+        case F_GETFD:
+        case F_GETOWN:
+        case F_GETSIG:
+        case F_GETLEASE:
+#ifdef F_GETPIPE_SZ
+        case F_GETPIPE_SZ:
+#endif
+#ifdef F_GET_SEALS
+        case F_GET_SEALS:
+#endif
+            {
+                va_end(va);
+                return fcntl_f(fd, cmd);
+            }
+            break;
+        case F_SETLK:
+        case F_SETLKW:
+        case F_GETLK:
+#ifdef F_OFD_GETLK
+        case F_OFD_GETLK:
+        case F_OFD_SETLK:
+        case F_OFD_SETLKW:
+#endif
+            {
+                struct flock* arg = va_arg(va, struct flock*);
+                va_end(va);
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+        case F_GETOWN_EX:
+        case F_SETOWN_EX:
+            {
+                struct f_owner_ex* arg = va_arg(va, struct f_owner_ex*);
+                va_end(va);
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+#ifdef F_GET_RW_HINT
+        case F_GET_RW_HINT:
+        case F_SET_RW_HINT:
+        case F_GET_FILE_RW_HINT:
+        case F_SET_FILE_RW_HINT:
+            {
+                uint64_t* arg = va_arg(va, uint64_t*);
+                va_end(va);
+                return fcntl_f(fd, cmd, arg);
+            }
+            break;
+#endif
+        default:
+            {
+                //不认识的命令不读取参数,调用方没有传参时va_arg是未定义行为
+                va_end(va);
+                return fcntl_f(fd, cmd);
+            }
+    }
+}
+
+int ioctl(int d, unsigned long int request, ...) {
+    va_list va;
+    va_start(va, request);
+    void* arg = va_arg(va, void*);
+    va_end(va);
+
+    if(FIONBIO == request) {
+        MyServer::FdCtx::ptr ctx = MyServer::FdMgr::GetInstance()->get(d);
+        if(ctx && !ctx->isClose() && ctx->isSocket()) {
+            ctx->setUserNonblock(!!*(int*)arg);
+            //系统层已经是非阻塞,不需要改动
+            if(ctx->getSysNonblock()) {
+                return 0;
+            }
+        }
+    }
+    return ioctl_f(d, request, arg);
+}
+
+int getsockopt(int sockfd, int level, int optname, void* optval, socklen_t* optlen) {
+    return getsockopt_f(sockfd, level, optname, optval, optlen);
+}
+
+int setsockopt(int sockfd, int level, int optname, const void* optval, socklen_t optlen) {
+    if(!MyServer::t_hook_enable) {
+        return setsockopt_f(sockfd, level, optname, optval, optlen);
+    }
+    if(level == SOL_SOCKET && (optname == SO_RCVTIMEO || optname == SO_SNDTIMEO)) {
+        MyServer::FdCtx::ptr ctx = MyServer::FdMgr::GetInstance()->get(sockfd);
+        if(ctx) {
+            //0表示不超时
+            const timeval* v = (const timeval*)optval;
+            uint64_t ms = v->tv_sec * 1000ull + v->tv_usec / 1000;
+            ctx->setTimeout(optname, ms ? ms : ~0ull);
+        }
+    }
+    return setsockopt_f(sockfd, level, optname, optval, optlen);
+}
+
+}
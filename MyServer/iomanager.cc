@@ -0,0 +1,386 @@
+#include "iomanager.h"
+#include "log.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdexcept>
+#include <limits.h>
+#include <algorithm>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+//一次epoll_wait最多返回的事件数
+static const int s_max_events = 256;
+
+IOManager::FdContext::EventContext& IOManager::FdContext::getContext(Event event) {
+    switch(event) {
+        case READ:
+            return read;
+        case WRITE:
+            return write;
+        default:
+            throw std::invalid_argument("getContext invalid event");
+    }
+}
+
+void IOManager::FdContext::resetContext(EventContext& ctx) {
+    ctx.scheduler = nullptr;
+    ctx.fiber.reset();
+    ctx.cb = nullptr;
+}
+
+void IOManager::FdContext::triggerEvent(Event event) {
+    events = (Event)(events & ~event);
+    EventContext& ctx = getContext(event);
+    Scheduler* scheduler = ctx.scheduler;
+    if(ctx.cb) {
+        std::function<void()> cb;
+        cb.swap(ctx.cb);
+        resetContext(ctx);
+        scheduler->schedule(std::move(cb));
+    } else {
+        Fiber::ptr fiber;
+        fiber.swap(ctx.fiber);
+        resetContext(ctx);
+        scheduler->schedule(std::move(fiber));
+    }
+}
+
+IOManager::IOManager(size_t threads, const std::string& name)
+    :Scheduler(threads, name.empty() ? "iomanager" : name) {
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(m_epfd < 0) {
+        MYSERVER_LOG_ERROR(g_logger) << "epoll_create1 fail, errno=" << errno
+            << " errstr=" << strerror(errno);
+        throw std::logic_error("epoll_create1 error");
+    }
+    m_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(m_eventfd < 0) {
+        MYSERVER_LOG_ERROR(g_logger) << "eventfd fail, errno=" << errno
+            << " errstr=" << strerror(errno);
+        throw std::logic_error("eventfd error");
+    }
+
+    //data.ptr为空表示eventfd
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = nullptr;
+    if(epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_eventfd, &event)) {
+        MYSERVER_LOG_ERROR(g_logger) << "epoll_ctl add eventfd fail, errno=" << errno
+            << " errstr=" << strerror(errno);
+        throw std::logic_error("epoll_ctl error");
+    }
+
+    contextResize(64);
+    start();
+}
+
+IOManager::~IOManager() {
+    stop();
+    close(m_epfd);
+    close(m_eventfd);
+    for(size_t i = 0; i < m_fdContexts.size(); ++i) {
+        delete m_fdContexts[i];
+    }
+}
+
+void IOManager::contextResize(size_t size) {
+    size_t old = m_fdContexts.size();
+    m_fdContexts.resize(size);
+    for(size_t i = old; i < size; ++i) {
+        m_fdContexts[i] = new FdContext;
+        m_fdContexts[i]->fd = i;
+    }
+}
+
+IOManager::FdContext* IOManager::getFdContext(int fd, bool auto_create) {
+    if(fd < 0) {
+        return nullptr;
+    }
+    {
+        RWMutexType::ReadLock lock(m_mutex);
+        if((int)m_fdContexts.size() > fd) {
+            return m_fdContexts[fd];
+        }
+        if(!auto_create) {
+            return nullptr;
+        }
+    }
+    RWMutexType::WriteLock lock(m_mutex);
+    if((int)m_fdContexts.size() <= fd) {
+        contextResize(fd * 1.5 + 1);
+    }
+    return m_fdContexts[fd];
+}
+
+int IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
+    FdContext* fd_ctx = getFdContext(fd, true);
+    if(!fd_ctx) {
+        return -1;
+    }
+
+    FdContext::MutexType::Lock lock(fd_ctx->mutex);
+    if(fd_ctx->events & event) {
+        MYSERVER_LOG_ERROR(g_logger) << "addEvent assert fd=" << fd
+            << " event=" << event << " fd_ctx.events=" << fd_ctx->events;
+        return -1;
+    }
+
+    int op = fd_ctx->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    epoll_event epevent;
+    memset(&epevent, 0, sizeof(epevent));
+    epevent.events = EPOLLET | fd_ctx->events | event;
+    epevent.data.ptr = fd_ctx;
+    if(epoll_ctl(m_epfd, op, fd, &epevent)) {
+        MYSERVER_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << op << ", " << fd << ", " << epevent.events << "): "
+            << errno << " (" << strerror(errno) << ")";
+        return -1;
+    }
+
+    ++m_pendingEventCount;
+    fd_ctx->events = (Event)(fd_ctx->events | event);
+    FdContext::EventContext& event_ctx = fd_ctx->getContext(event);
+    event_ctx.scheduler = Scheduler::GetThis() ? Scheduler::GetThis() : this;
+    if(cb) {
+        event_ctx.cb.swap(cb);
+    } else {
+        event_ctx.fiber = Fiber::GetThis();
+    }
+    return 0;
+}
+
+bool IOManager::delEvent(int fd, Event event) {
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if(!fd_ctx) {
+        return false;
+    }
+
+    FdContext::MutexType::Lock lock(fd_ctx->mutex);
+    if(!(fd_ctx->events & event)) {
+        return false;
+    }
+
+    Event new_events = (Event)(fd_ctx->events & ~event);
+    int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    epoll_event epevent;
+    memset(&epevent, 0, sizeof(epevent));
+    epevent.events = EPOLLET | new_events;
+    epevent.data.ptr = fd_ctx;
+    if(epoll_ctl(m_epfd, op, fd, &epevent)) {
+        MYSERVER_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << op << ", " << fd << ", " << epevent.events << "): "
+            << errno << " (" << strerror(errno) << ")";
+        return false;
+    }
+
+    fd_ctx->events = new_events;
+    fd_ctx->resetContext(fd_ctx->getContext(event));
+    eventDone();
+    return true;
+}
+
+bool IOManager::cancelEvent(int fd, Event event) {
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if(!fd_ctx) {
+        return false;
+    }
+
+    FdContext::MutexType::Lock lock(fd_ctx->mutex);
+    if(!(fd_ctx->events & event)) {
+        return false;
+    }
+
+    Event new_events = (Event)(fd_ctx->events & ~event);
+    int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    epoll_event epevent;
+    memset(&epevent, 0, sizeof(epevent));
+    epevent.events = EPOLLET | new_events;
+    epevent.data.ptr = fd_ctx;
+    if(epoll_ctl(m_epfd, op, fd, &epevent)) {
+        MYSERVER_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << op << ", " << fd << ", " << epevent.events << "): "
+            << errno << " (" << strerror(errno) << ")";
+        return false;
+    }
+
+    fd_ctx->triggerEvent(event);
+    eventDone();
+    return true;
+}
+
+bool IOManager::cancelAll(int fd) {
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if(!fd_ctx) {
+        return false;
+    }
+
+    FdContext::MutexType::Lock lock(fd_ctx->mutex);
+    if(!fd_ctx->events) {
+        return false;
+    }
+
+    epoll_event epevent;
+    memset(&epevent, 0, sizeof(epevent));
+    epevent.data.ptr = fd_ctx;
+    if(epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, &epevent)) {
+        MYSERVER_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+            << EPOLL_CTL_DEL << ", " << fd << "): "
+            << errno << " (" << strerror(errno) << ")";
+        return false;
+    }
+
+    if(fd_ctx->events & READ) {
+        fd_ctx->triggerEvent(READ);
+        eventDone();
+    }
+    if(fd_ctx->events & WRITE) {
+        fd_ctx->triggerEvent(WRITE);
+        eventDone();
+    }
+    return true;
+}
+
+IOManager* IOManager::GetThis() {
+    return dynamic_cast<IOManager*>(Scheduler::GetThis());
+}
+
+void IOManager::eventDone() {
+    if(--m_pendingEventCount == 0 && isStopping()) {
+        tickleAll();
+    }
+}
+
+void IOManager::tickleEpoll() {
+    if(m_tickled.exchange(true)) {
+        return;
+    }
+    uint64_t one = 1;
+    if(write(m_eventfd, &one, sizeof(one)) != sizeof(one)) {
+        MYSERVER_LOG_ERROR(g_logger) << "write eventfd fail, errno=" << errno;
+    }
+}
+
+void IOManager::tickle(int thread) {
+    if(wakeWorker(thread)) {
+        return;
+    }
+    //没有阻塞在信号量上的worker,看epoll_wait上的worker是否满足
+    int poller = m_pollerIndex.load();
+    if(poller >= 0 && (thread < 0 || thread == poller)) {
+        tickleEpoll();
+    }
+}
+
+void IOManager::tickleAll() {
+    Scheduler::tickleAll();
+    tickleEpoll();
+}
+
+bool IOManager::stopping() {
+    return m_pendingEventCount == 0 && !hasTimer() && Scheduler::stopping();
+}
+
+void IOManager::onTimerInsertedAtFront() {
+    //没有worker在epoll_wait时,下一个进入的worker会重新计算超时
+    if(m_pollerIndex.load() >= 0) {
+        tickleEpoll();
+    }
+}
+
+void IOManager::idle() {
+    //已经有worker在epoll_wait,作为follower阻塞在信号量上
+    bool expected = false;
+    if(!m_polling.compare_exchange_strong(expected, true)) {
+        parkWorker();
+        return;
+    }
+
+    m_pollerIndex = GetWorkerIndex();
+    ++m_idleCount;
+    epoll_event events[s_max_events];
+    int rt = 0;
+    //先登记空闲再检查,与提交任务时的检查配对,见Scheduler::parkWorker
+    if(!hasTask() && !stopping()) {
+        uint64_t next_timeout = getNextTimer();
+        int timeout = next_timeout == ~0ull ? -1 : (int)std::min(next_timeout, (uint64_t)INT_MAX);
+        do {
+            rt = epoll_wait(m_epfd, events, s_max_events, timeout);
+        } while(rt < 0 && errno == EINTR);
+        if(rt < 0) {
+            MYSERVER_LOG_ERROR(g_logger) << "epoll_wait(" << m_epfd << ") fail, errno=" << errno
+                << " errstr=" << strerror(errno);
+        }
+    }
+    --m_idleCount;
+    m_pollerIndex = -1;
+    //先交出epoll_wait,提交回调时被唤醒的follower可以接替
+    m_polling = false;
+
+    std::vector<std::function<void()> > cbs;
+    listExpiredCb(cbs);
+    if(!cbs.empty()) {
+        schedule(cbs.begin(), cbs.end());
+    }
+
+    for(int i = 0; i < rt; ++i) {
+        epoll_event& event = events[i];
+        if(event.data.ptr == nullptr) {
+            //先读空eventfd再清标记;反过来的话,两步之间的tickle写入会被读掉,
+            //m_tickled却一直为true,之后的tickle都不会再写eventfd
+            uint64_t dummy;
+            while(read(m_eventfd, &dummy, sizeof(dummy)) > 0);
+            m_tickled = false;
+            continue;
+        }
+
+        FdContext* fd_ctx = (FdContext*)event.data.ptr;
+        FdContext::MutexType::Lock lock(fd_ctx->mutex);
+        //出错或对端关闭时,把关注的读写事件都触发
+        if(event.events & (EPOLLERR | EPOLLHUP)) {
+            event.events |= (EPOLLIN | EPOLLOUT) & fd_ctx->events;
+        }
+        int real_events = NONE;
+        if(event.events & EPOLLIN) {
+            real_events |= READ;
+        }
+        if(event.events & EPOLLOUT) {
+            real_events |= WRITE;
+        }
+        real_events &= fd_ctx->events;
+        if(real_events == NONE) {
+            continue;
+        }
+
+        int left_events = (fd_ctx->events & ~real_events);
+        int op = left_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+        event.events = EPOLLET | left_events;
+        if(epoll_ctl(m_epfd, op, fd_ctx->fd, &event)) {
+            MYSERVER_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+                << op << ", " << fd_ctx->fd << ", " << event.events << "): "
+                << errno << " (" << strerror(errno) << ")";
+            continue;
+        }
+
+        if(real_events & READ) {
+            fd_ctx->triggerEvent(READ);
+            eventDone();
+        }
+        if(real_events & WRITE) {
+            fd_ctx->triggerEvent(WRITE);
+            eventDone();
+        }
+    }
+
+    //取消最后一个定时器不会唤醒其它worker,这里检查一次
+    if(stopping()) {
+        tickleAll();
+    }
+}
+
+}
@@ -0,0 +1,122 @@
+#ifndef __MYSERVER_IOMANAGER_H__
+#define __MYSERVER_IOMANAGER_H__
+
+#include "scheduler.h"
+#include "timer.h"
+#include <vector>
+
+namespace MyServer {
+
+/**
+ * @brief 基于epoll的IO事件调度器
+ * @details fd以边缘触发方式注册,事件触发一次后自动取消对该事件的关注,
+ *          需要继续等待时重新addEvent
+ *          fd的上下文保存在按fd下标的数组中,查找是O(1)
+ *          同一时间只有一个空闲的worker阻塞在epoll_wait上(leader),
+ *          其它空闲worker阻塞在各自的信号量上(follower);leader拿到事件后
+ *          交出epoll_wait,把回调提交给调度器,由被唤醒的follower接替等待
+ *          跨线程唤醒epoll_wait使用eventfd
+ *          epoll_wait的超时取下一个定时器的到期时间,到期的定时器回调提交给调度器
+ *          stop会等待所有事件和定时器完成,循环定时器需要先cancel
+ */
+class IOManager : public Scheduler, public TimerManager {
+public:
+    typedef std::shared_ptr<IOManager> ptr;
+    typedef RWMutex RWMutexType;
+
+    //与EPOLLIN/EPOLLOUT的值相同
+    enum Event {
+        NONE    = 0x0,
+        READ    = 0x1,
+        WRITE   = 0x4,
+    };
+
+    /**
+     * @param[in] threads worker数量
+     * @param[in] name 调度器名称
+     * @details 构造后立即启动
+     */
+    IOManager(size_t threads = 1, const std::string& name = "");
+    ~IOManager();
+
+    /**
+     * @brief 关注fd上的事件
+     * @param[in] cb 事件触发时执行的回调,为空时事件触发后重新调度当前协程
+     * @return 成功返回0,事件已经在关注中或epoll_ctl失败返回-1
+     */
+    int addEvent(int fd, Event event, std::function<void()> cb = nullptr);
+
+    /**
+     * @brief 取消关注,不触发回调
+     */
+    bool delEvent(int fd, Event event);
+
+    /**
+     * @brief 取消关注,并且触发一次回调
+     */
+    bool cancelEvent(int fd, Event event);
+
+    /**
+     * @brief 取消fd上所有的事件,并且触发回调
+     */
+    bool cancelAll(int fd);
+
+    //等待中的事件数
+    size_t getPendingEventCount() const { return m_pendingEventCount;}
+
+    //当前线程所属的IOManager
+    static IOManager* GetThis();
+protected:
+    void tickle(int thread) override;
+    void tickleAll() override;
+    void idle() override;
+    bool stopping() override;
+    void onTimerInsertedAtFront() override;
+
+    //扩充fd上下文数组
+    void contextResize(size_t size);
+private:
+    struct FdContext {
+        typedef Mutex MutexType;
+        struct EventContext {
+            //执行回调的调度器
+            Scheduler* scheduler = nullptr;
+            Fiber::ptr fiber;
+            std::function<void()> cb;
+        };
+
+        EventContext& getContext(Event event);
+        void resetContext(EventContext& ctx);
+        //提交事件的回调,并取消对该事件的关注
+        void triggerEvent(Event event);
+
+        EventContext read;
+        EventContext write;
+        int fd = 0;
+        //关注的事件
+        Event events = NONE;
+        MutexType mutex;
+    };
+
+    //返回fd的上下文,auto_create为false且不存在时返回nullptr
+    FdContext* getFdContext(int fd, bool auto_create);
+    //唤醒阻塞在epoll_wait上的worker
+    void tickleEpoll();
+    //事件数减一,stop过程中最后一个事件完成时唤醒所有worker
+    void eventDone();
+private:
+    int m_epfd = 0;
+    int m_eventfd = 0;
+    //是否有worker阻塞在epoll_wait上,以及它的下标
+    std::atomic<bool> m_polling{false};
+    std::atomic<int> m_pollerIndex{-1};
+    //已经写过eventfd还没有被读掉,避免重复写
+    std::atomic<bool> m_tickled{false};
+    std::atomic<size_t> m_pendingEventCount{0};
+    RWMutexType m_mutex;
+    std::vector<FdContext*> m_fdContexts;
+};
+
+}
+
+#endif
@@ -97,6 +97,17 @@ LogFormatter::ptr LogAppender::getFormatter() {
     return m_formatter;
 }
 
+//整数直接转成文本写入,不经过ostream的数值格式化和locale
+static inline void WriteUint(std::ostream& os, uint64_t v) {
+	char buf[20];
+	os.write(buf, UintToChars(v, buf));
+}
+
+static inline void WriteInt(std::ostream& os, int64_t v) {
+	char buf[20];
+	os.write(buf, IntToChars(v, buf));
+}
+
 class MessageFormatItem : public LogFormatter::FormatItem {
 public:
 	MessageFormatItem(const std::string& str = "") {}
@@ -120,7 +131,7 @@ class ElapseFormatItem : public LogFormatter::FormatItem {
 public:
 	ElapseFormatItem(const std::string& str = "") {}
 	void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override {
-		os << event->getElapse();
+		WriteUint(os, event->getElapse());
 	
 	}
 };
@@ -139,7 +150,7 @@ class ThreadIdFormatItem : public LogFormatter::FormatItem {
 public:
 	ThreadIdFormatItem(const std::string& str = "") {}
 	void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override {
-		os << event->getThreadId();
+		WriteUint(os, event->getThreadId());
 	
 	}
 };
@@ -159,7 +170,7 @@ class FiberIdFormatItem : public LogFormatter::FormatItem {
 public:
 	FiberIdFormatItem(const std::string& str = "") {}
 	void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override {
-		os << event->getFiberId();
+		WriteUint(os, event->getFiberId());
 	
 	}
 };
@@ -198,7 +209,7 @@ class LineFormatItem : public LogFormatter::FormatItem {
 public:
 	LineFormatItem(const std::string& str = "") {}
 	void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) override {
-		os << event->getLine();
+		WriteInt(os, event->getLine());
 	
 	}
 };
@@ -223,7 +234,7 @@ public:
 };
 
 LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char* file, int32_t line, uint32_t elapse, uint32_t thread_id, uint32_t fiber_id, uint64_t time)
-: m_logger(logger), m_level(level), m_file(file), m_line(line), m_elapse(elapse), m_threadId(thread_id), m_fiberId(fiber_id), m_time(time){
+: m_file(file), m_line(line), m_elapse(elapse), m_threadId(thread_id), m_fiberId(fiber_id), m_time(time), m_logger(logger), m_level(level){
 
 }
 
@@ -427,7 +438,6 @@ std::string LogFormatter::format(std::shared_ptr<Logger> logger, LogLevel::Level
 void LogFormatter::init() {
 	//str,format,type
 	std::vector<std::tuple<std::string, std::string, int > > vec;
-	size_t last_pos = 0;
 	std::string nstr;
 	//这里执行的操作是在输入的pattern里面，找到%xxx{xxx}
 	for(size_t i = 0; i < m_pattern.size(); ++i) {
@@ -541,9 +551,17 @@ LoggerManager::LoggerManager() {
 
 
 Logger::ptr LoggerManager::getLogger(const std::string& name) {
-	MutexType::Lock lock(m_mutex);
+	{
+		RWMutexType::ReadLock lock(m_mutex);
+		auto it = m_loggers.find(name);
+		//查找之前的logger,没有的话返回新的
+		if(it != m_loggers.end()) {
+			return it->second;
+		}
+	}
+	RWMutexType::WriteLock lock(m_mutex);
+	//加写锁期间可能已经被其它线程创建
 	auto it = m_loggers.find(name);
-	//查找之前的logger,没有的话返回新的
 	if(it != m_loggers.end()) {
 		return it->second;
 	}
@@ -767,7 +785,7 @@ struct LogIniter {
 static LogIniter __log_init;
 
 std::string LoggerManager::toYamlString() {
-    MutexType::Lock lock(m_mutex);
+    RWMutexType::ReadLock lock(m_mutex);
     YAML::Node node;
     for(auto& i : m_loggers) {
         node.push_back(YAML::Load(i.second->toYamlString()));
@@ -158,7 +158,7 @@ class LogAppender{
 friend class Logger;
 public:
 	typedef std::shared_ptr<LogAppender> ptr;
-	typedef Spinlock MutexType;
+	typedef PolicyMutex<FutexMutex> MutexType;
 	virtual ~LogAppender() {}
 //这里使用的是std::shared_ptr<Logger> logger而不是Logger::ptr为了确定LogAppender里面的logger被调用的次数
 	virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level Level, LogEvent::ptr event) = 0;
@@ -186,7 +186,7 @@ class Logger : public std::enable_shared_from_this<Logger>{ //类的成员寒暑
 friend class LoggerManager;
 public:
 	typedef std::shared_ptr<Logger> ptr;
-	typedef Spinlock MutexType;
+	typedef PolicyMutex<FutexMutex> MutexType;
 
 	Logger(const std::string& name = "root");
 	//生成日志器
@@ -254,7 +254,8 @@ private:
 //管理所有的logger,需要就调用
 class LoggerManager {
 public:
-	typedef Spinlock MutexType;
+	//查找远多于创建
+	typedef PolicyRWMutex<BRMutex> RWMutexType;
 	LoggerManager();
 	Logger::ptr getLogger(const std::string& name);
 
@@ -263,7 +264,7 @@ public:
 
 	std::string toYamlString();
 private:
-	MutexType m_mutex;
+	RWMutexType m_mutex;
 	std::map<std::string, Logger::ptr> m_loggers;
 	Logger::ptr m_root;
 };
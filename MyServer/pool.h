@@ -0,0 +1,181 @@
+#ifndef __MYSERVER_POOL_H__
+#define __MYSERVER_POOL_H__
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include "thread.h"
+
+namespace MyServer {
+
+/**
+ * @brief 对象池
+ * @details 对象用完后不析构,执行reset回调后放回池中,下次直接复用
+ *          每个线程(按GetThreadSlot()分槽)有自己的空闲列表,取放只访问自己的槽,
+ *          槽锁只在线程数超过SLOTS共享槽时才会有竞争
+ *          空闲列表最多2个弹匣(magazine)的对象,放满时把一个弹匣整批交给全局仓库,
+ *          取空时从仓库整批取一个弹匣,跨线程释放的对象也只在批量转移时加全局锁
+ *          仓库最多保存maxDepot个弹匣,超出的对象直接delete
+ *          get返回带自定义删除器的unique_ptr,析构时对象回到池中;
+ *          池必须比从它取出的对象活得久
+ */
+template<class T, uint32_t SLOTS = 64>
+class ObjectPool /*: Noncopyable*/ {
+public:
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "ObjectPool SLOTS must be power of 2");
+
+    //归还时把对象恢复到可复用的状态
+    typedef std::function<void(T&)> ResetCb;
+    //池中没有对象时创建新对象
+    typedef std::function<T*()> CreateCb;
+
+    //把对象还给池的删除器
+    struct Deleter {
+        Deleter(ObjectPool* p = nullptr)
+            :pool(p) {
+        }
+        void operator()(T* p) const {
+            pool->release(p);
+        }
+        ObjectPool* pool;
+    };
+    typedef std::unique_ptr<T, Deleter> UniquePtr;
+
+    /**
+     * @param[in] magazine 一个弹匣的对象数,也是与仓库之间一次转移的数量
+     * @param[in] max_depot 仓库最多保存的弹匣数
+     * @param[in] reset 归还时执行,为空不执行
+     * @param[in] create 创建对象,为空时用new T()
+     */
+    ObjectPool(size_t magazine = 64, size_t max_depot = 64
+               ,ResetCb reset = nullptr, CreateCb create = nullptr)
+        :m_magazine(magazine ? magazine : 1)
+        ,m_maxDepot(max_depot)
+        ,m_reset(reset)
+        ,m_create(create) {
+    }
+
+    ~ObjectPool() {
+        for(uint32_t i = 0; i < SLOTS; ++i) {
+            for(auto p : m_caches[i].objs) {
+                delete p;
+            }
+        }
+        for(auto& m : m_depot) {
+            for(auto p : m) {
+                delete p;
+            }
+        }
+    }
+
+    //取一个对象,离开作用域时自动归还
+    UniquePtr get() {
+        return UniquePtr(acquire(), Deleter(this));
+    }
+
+    //取一个对象,用完必须调用release
+    T* acquire() {
+        Cache& c = local();
+        CASLock::Lock lock(c.mutex);
+        if(c.objs.empty()) {
+            refill(c);
+            if(c.objs.empty()) {
+                lock.unlock();
+                m_created.fetch_add(1, std::memory_order_relaxed);
+                return m_create ? m_create() : new T();
+            }
+        }
+        T* p = c.objs.back();
+        c.objs.pop_back();
+        return p;
+    }
+
+    //归还对象,可以在任意线程调用
+    void release(T* p) {
+        if(!p) {
+            return;
+        }
+        if(m_reset) {
+            m_reset(*p);
+        }
+        Cache& c = local();
+        CASLock::Lock lock(c.mutex);
+        if(c.objs.size() >= m_magazine * 2) {
+            flush(c);
+        }
+        c.objs.push_back(p);
+    }
+
+    //共创建过的对象数
+    uint64_t getCreatedCount() const { return m_created.load(std::memory_order_relaxed);}
+    //仓库中的弹匣数
+    size_t getDepotSize() {
+        FutexMutex::Lock lock(m_depotMutex);
+        return m_depot.size();
+    }
+private:
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    struct alignas(64) Cache {
+        CASLock mutex;
+        std::vector<T*> objs;
+    };
+
+    Cache& local() {
+        return m_caches[GetThreadSlot() & (SLOTS - 1)];
+    }
+
+    //从仓库取一个弹匣,调用时持有c的锁
+    void refill(Cache& c) {
+        if(m_depotSize.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        FutexMutex::Lock lock(m_depotMutex);
+        if(m_depot.empty()) {
+            return;
+        }
+        c.objs.swap(m_depot.back());
+        m_depot.pop_back();
+        m_depotSize.store(m_depot.size(), std::memory_order_relaxed);
+    }
+
+    //把一个弹匣的对象交给仓库,仓库满时释放,调用时持有c的锁
+    void flush(Cache& c) {
+        std::vector<T*> m(c.objs.end() - m_magazine, c.objs.end());
+        c.objs.resize(c.objs.size() - m_magazine);
+        {
+            FutexMutex::Lock lock(m_depotMutex);
+            if(m_depot.size() < m_maxDepot) {
+                m_depot.push_back(std::move(m));
+                m_depotSize.store(m_depot.size(), std::memory_order_relaxed);
+                return;
+            }
+        }
+        for(auto p : m) {
+            delete p;
+        }
+    }
+private:
+    // 一个弹匣的对象数
+    size_t m_magazine;
+    // 仓库最多保存的弹匣数
+    size_t m_maxDepot;
+    ResetCb m_reset;
+    CreateCb m_create;
+    // 每个线程槽的空闲列表
+    Cache m_caches[SLOTS];
+    // 全局仓库,保存装满的弹匣
+    FutexMutex m_depotMutex;
+    std::vector<std::vector<T*> > m_depot;
+    // 仓库为空时不加锁
+    std::atomic<size_t> m_depotSize{0};
+    std::atomic<uint64_t> m_created{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef __MYSERVER_QUEUE_H__
+#define __MYSERVER_QUEUE_H__
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdint.h>
+#include <stddef.h>
+#include "thread.h"
+
+namespace MyServer {
+
+//向上取整到2的幂,最小为2
+static inline size_t QueueCapacity(size_t size) {
+    size_t cap = 2;
+    while(cap < size) {
+        cap <<= 1;
+    }
+    return cap;
+}
+
+/**
+ * @brief 有界无锁环形队列(Vyukov)
+ * @details 每个槽带一个序号,生产者看到序号等于入队位置说明槽可写,
+ *          消费者看到序号等于出队位置+1说明槽可读,读写完成后推进序号
+ *          入队位置和出队位置各自独占cache line,生产者和消费者之间只在槽上交互
+ *          MultiConsumer为false时只能有一个消费者,出队不需要CAS
+ *          批量操作一次CAS占用连续的多个槽,摊薄原子操作的开销
+ *          容量向上取整到2的幂
+ */
+template<class T, bool MultiConsumer = true>
+class RingQueue {
+public:
+    typedef T value_type;
+
+    RingQueue(size_t size)
+        :m_mask(QueueCapacity(size) - 1)
+        ,m_cells(new Cell[m_mask + 1]) {
+        for(size_t i = 0; i <= m_mask; ++i) {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~RingQueue() {
+        T tmp;
+        while(tryPop(tmp));
+    }
+
+    //入队,满时返回false,v保持不变
+    template<class U>
+    bool tryPush(U&& v) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if(dif == 0) {
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(dif < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->data()) T(std::forward<U>(v));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //出队,空时返回false
+    bool tryPop(T& v) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(dif == 0) {
+                if(!MultiConsumer) {
+                    m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+                    break;
+                }
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(dif < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        popCell(cell, pos, v);
+        return true;
+    }
+
+    /**
+     * @brief 批量入队
+     * @param[in] first 元素的起始迭代器,入队的元素被移走
+     * @return 实际入队的数量,队列满时可能小于n
+     */
+    template<class InputIterator>
+    size_t tryPushBatch(InputIterator first, size_t n) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t k = 0;
+        while(true) {
+            //从pos开始数出连续可写的槽
+            k = 0;
+            while(k < n && m_cells[(pos + k) & m_mask].seq.load(std::memory_order_acquire) == pos + k) {
+                ++k;
+            }
+            if(k == 0) {
+                intptr_t dif = (intptr_t)m_cells[pos & m_mask].seq.load(std::memory_order_acquire) - (intptr_t)pos;
+                if(dif < 0 || n == 0) {
+                    return 0;
+                }
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if(m_enqueuePos.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for(size_t i = 0; i < k; ++i, ++first) {
+            Cell* cell = &m_cells[(pos + i) & m_mask];
+            new (cell->data()) T(std::move(*first));
+            cell->seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return k;
+    }
+
+    /**
+     * @brief 批量出队
+     * @param[out] out 输出迭代器
+     * @return 实际出队的数量,最多max个
+     */
+    template<class OutputIterator>
+    size_t tryPopBatch(OutputIterator out, size_t max) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        size_t k = 0;
+        while(true) {
+            k = 0;
+            while(k < max && m_cells[(pos + k) & m_mask].seq.load(std::memory_order_acquire) == pos + k + 1) {
+                ++k;
+            }
+            if(k == 0) {
+                intptr_t dif = (intptr_t)m_cells[pos & m_mask].seq.load(std::memory_order_acquire)
+                               - (intptr_t)(pos + 1);
+                if(dif < 0 || max == 0) {
+                    return 0;
+                }
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if(!MultiConsumer) {
+                m_dequeuePos.store(pos + k, std::memory_order_relaxed);
+                break;
+            }
+            if(m_dequeuePos.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for(size_t i = 0; i < k; ++i, ++out) {
+            T v;
+            popCell(&m_cells[(pos + i) & m_mask], pos + i, v);
+            *out = std::move(v);
+        }
+        return k;
+    }
+
+    //近似的元素数量
+    size_t sizeApprox() const {
+        size_t e = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t d = m_dequeuePos.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+    size_t capacity() const { return m_mask + 1;}
+private:
+    RingQueue(const RingQueue&) = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* data() { return reinterpret_cast<T*>(&storage);}
+    };
+
+    //取出元素,槽留给下一圈的生产者
+    void popCell(Cell* cell, size_t pos, T& v) {
+        T* p = cell->data();
+        v = std::move(*p);
+        p->~T();
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+    }
+private:
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    // 入队位置
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    // 出队位置
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+};
+
+//多生产者多消费者
+template<class T>
+using MPMCQueue = RingQueue<T, true>;
+
+//多生产者单消费者
+template<class T>
+using MPSCQueue = RingQueue<T, false>;
+
+/**
+ * @brief 单生产者单消费者有界队列
+ * @details 生产者只写尾、消费者只写头,各自缓存对方位置的旧值,
+ *          只有缓存显示满或空时才去读对方的cache line
+ */
+template<class T>
+class SPSCQueue {
+public:
+    typedef T value_type;
+
+    SPSCQueue(size_t size)
+        :m_mask(QueueCapacity(size) - 1)
+        ,m_slots(new Slot[m_mask + 1]) {
+    }
+
+    ~SPSCQueue() {
+        T tmp;
+        while(tryPop(tmp));
+    }
+
+    template<class U>
+    bool tryPush(U&& v) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail - m_cachedHead > m_mask) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if(tail - m_cachedHead > m_mask) {
+                return false;
+            }
+        }
+        new (m_slots[tail & m_mask].data()) T(std::forward<U>(v));
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& v) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if(head == m_cachedTail) {
+                return false;
+            }
+        }
+        T* p = m_slots[head & m_mask].data();
+        v = std::move(*p);
+        p->~T();
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //批量入队,只发布一次尾位置
+    template<class InputIterator>
+    size_t tryPushBatch(InputIterator first, size_t n) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t free = m_mask + 1 - (tail - m_cachedHead);
+        if(free < n) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            free = m_mask + 1 - (tail - m_cachedHead);
+        }
+        size_t k = n < free ? n : free;
+        for(size_t i = 0; i < k; ++i, ++first) {
+            new (m_slots[(tail + i) & m_mask].data()) T(std::move(*first));
+        }
+        if(k) {
+            m_tail.store(tail + k, std::memory_order_release);
+        }
+        return k;
+    }
+
+    //批量出队,只发布一次头位置
+    template<class OutputIterator>
+    size_t tryPopBatch(OutputIterator out, size_t max) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t avail = m_cachedTail - head;
+        if(avail < max) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            avail = m_cachedTail - head;
+        }
+        size_t k = max < avail ? max : avail;
+        for(size_t i = 0; i < k; ++i, ++out) {
+            T* p = m_slots[(head + i) & m_mask].data();
+            *out = std::move(*p);
+            p->~T();
+        }
+        if(k) {
+            m_head.store(head + k, std::memory_order_release);
+        }
+        return k;
+    }
+
+    size_t sizeApprox() const {
+        return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_relaxed);
+    }
+    size_t capacity() const { return m_mask + 1;}
+private:
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    struct Slot {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* data() { return reinterpret_cast<T*>(&storage);}
+    };
+private:
+    const size_t m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+    // 消费者写
+    alignas(64) std::atomic<size_t> m_head{0};
+    // 消费者缓存的尾位置
+    size_t m_cachedTail = 0;
+    // 生产者写
+    alignas(64) std::atomic<size_t> m_tail{0};
+    // 生产者缓存的头位置
+    size_t m_cachedHead = 0;
+};
+
+/**
+ * @brief 阻塞队列,包装上面的无锁队列
+ * @details 队列满或空时先短暂自旋,仍然不行再在EventCount上等待,
+ *          队列不满不空时push/pop与无锁队列相同,只多一次等待者数量的读取
+ */
+template<class Queue>
+class BlockingQueue {
+public:
+    typedef typename Queue::value_type value_type;
+
+    BlockingQueue(size_t size)
+        :m_queue(size) {
+    }
+
+    //入队,满时等待
+    template<class U>
+    void push(U&& v) {
+        for(int i = 0; !m_queue.tryPush(std::forward<U>(v)); ++i) {
+            if(i < SPIN) {
+                CpuRelax();
+                continue;
+            }
+            uint32_t key = m_notFull.prepareWait();
+            if(m_queue.tryPush(std::forward<U>(v))) {
+                m_notFull.cancelWait();
+                break;
+            }
+            m_notFull.wait(key);
+        }
+        m_notEmpty.notify();
+    }
+
+    //出队,空时等待
+    void pop(value_type& v) {
+        for(int i = 0; !m_queue.tryPop(v); ++i) {
+            if(i < SPIN) {
+                CpuRelax();
+                continue;
+            }
+            uint32_t key = m_notEmpty.prepareWait();
+            if(m_queue.tryPop(v)) {
+                m_notEmpty.cancelWait();
+                break;
+            }
+            m_notEmpty.wait(key);
+        }
+        m_notFull.notify();
+    }
+
+    template<class U>
+    bool tryPush(U&& v) {
+        if(m_queue.tryPush(std::forward<U>(v))) {
+            m_notEmpty.notify();
+            return true;
+        }
+        return false;
+    }
+
+    bool tryPop(value_type& v) {
+        if(m_queue.tryPop(v)) {
+            m_notFull.notify();
+            return true;
+        }
+        return false;
+    }
+
+    //批量入队,满时等待直到全部入队
+    template<class InputIterator>
+    void pushBatch(InputIterator first, size_t n) {
+        while(n) {
+            size_t k = m_queue.tryPushBatch(first, n);
+            if(k) {
+                std::advance(first, k);
+                n -= k;
+                m_notEmpty.notify();
+                continue;
+            }
+            uint32_t key = m_notFull.prepareWait();
+            k = m_queue.tryPushBatch(first, n);
+            if(k) {
+                m_notFull.cancelWait();
+                std::advance(first, k);
+                n -= k;
+                m_notEmpty.notify();
+                continue;
+            }
+            m_notFull.wait(key);
+        }
+    }
+
+    //批量出队,空时等待,返回出队的数量(至少1个)
+    template<class OutputIterator>
+    size_t popBatch(OutputIterator out, size_t max) {
+        size_t k = 0;
+        for(int i = 0; !(k = m_queue.tryPopBatch(out, max)); ++i) {
+            if(i < SPIN) {
+                CpuRelax();
+                continue;
+            }
+            uint32_t key = m_notEmpty.prepareWait();
+            k = m_queue.tryPopBatch(out, max);
+            if(k) {
+                m_notEmpty.cancelWait();
+                break;
+            }
+            m_notEmpty.wait(key);
+        }
+        m_notFull.notify();
+        return k;
+    }
+
+    size_t sizeApprox() const { return m_queue.sizeApprox();}
+    size_t capacity() const { return m_queue.capacity();}
+private:
+    //等待前的自旋次数
+    static const int SPIN = 64;
+private:
+    Queue m_queue;
+    EventCount m_notEmpty;
+    EventCount m_notFull;
+};
+
+}
+
+#endif
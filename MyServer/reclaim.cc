@@ -0,0 +1,345 @@
+#include "reclaim.h"
+#include "thread.h"
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#include <sched.h>
+
+namespace MyServer {
+
+//待释放的对象
+struct Retired {
+    void* ptr;
+    ReclaimDeleter deleter;
+    // Retire时的全局纪元,风险指针不使用
+    uint64_t epoch;
+};
+
+//已退出线程留下的待释放对象,由其它线程释放
+struct OrphanList {
+    FutexMutex mutex;
+    std::vector<Retired> items;
+    // 没有对象时不加锁
+    std::atomic<size_t> size{0};
+
+    void add(std::vector<Retired>& v) {
+        if(v.empty()) {
+            return;
+        }
+        FutexMutex::Lock lock(mutex);
+        items.insert(items.end(), v.begin(), v.end());
+        size.store(items.size(), std::memory_order_relaxed);
+        v.clear();
+    }
+};
+
+//线程退出可能晚于静态对象析构,孤儿列表不释放
+static OrphanList& GetEpochOrphans() {
+    static OrphanList* s_list = new OrphanList;
+    return *s_list;
+}
+
+static OrphanList& GetHazardOrphans() {
+    static OrphanList* s_list = new OrphanList;
+    return *s_list;
+}
+
+//调用删除函数,删除函数里可能再Retire,所以先从列表中取出再释放
+static void FreeRetired(std::vector<Retired>& v) {
+    for(auto& i : v) {
+        i.deleter(i.ptr);
+    }
+    v.clear();
+}
+
+//攒够多少个待释放对象尝试回收一次
+static const size_t s_reclaim_batch = 64;
+
+//每个线程一个的纪元槽位
+struct alignas(64) EpochRecord {
+    // 纪元<<1 | 1表示在临界区中,0表示不在
+    std::atomic<uint64_t> state{0};
+    std::atomic<bool> used{true};
+    EpochRecord* next = nullptr;
+};
+
+// 所有槽位,只增不减,线程退出后槽位留给之后的线程
+static std::atomic<EpochRecord*> s_epoch_records{nullptr};
+static std::atomic<uint64_t> s_epoch{1};
+
+struct EpochLocal {
+    EpochRecord* rec = nullptr;
+    uint32_t nesting = 0;
+    // 按纪元递增排列
+    std::vector<Retired> retired;
+    size_t nextCollect = s_reclaim_batch;
+
+    EpochRecord* get() {
+        if(!rec) {
+            rec = acquire();
+        }
+        return rec;
+    }
+
+    static EpochRecord* acquire() {
+        for(EpochRecord* r = s_epoch_records.load(std::memory_order_acquire); r; r = r->next) {
+            bool used = false;
+            if(!r->used.load(std::memory_order_relaxed)
+                    && r->used.compare_exchange_strong(used, true, std::memory_order_acquire)) {
+                return r;
+            }
+        }
+        EpochRecord* r = new EpochRecord;
+        r->next = s_epoch_records.load(std::memory_order_relaxed);
+        while(!s_epoch_records.compare_exchange_weak(r->next, r, std::memory_order_release
+                                                     ,std::memory_order_relaxed));
+        return r;
+    }
+
+    ~EpochLocal() {
+        if(rec) {
+            rec->state.store(0, std::memory_order_release);
+            rec->used.store(false, std::memory_order_release);
+        }
+        GetEpochOrphans().add(retired);
+    }
+};
+
+static thread_local EpochLocal t_epoch;
+
+void Epoch::Enter() {
+    EpochLocal& l = t_epoch;
+    if(l.nesting++ == 0) {
+        EpochRecord* r = l.get();
+        r->state.store((s_epoch.load(std::memory_order_relaxed) << 1) | 1
+                       ,std::memory_order_relaxed);
+        //与TryAdvance中的屏障配对,推进纪元的线程要么看到我们在临界区中,
+        //要么我们之后读到的都是摘下对象之后的值
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void Epoch::Leave() {
+    EpochLocal& l = t_epoch;
+    assert(l.nesting > 0);
+    if(--l.nesting == 0) {
+        l.rec->state.store(0, std::memory_order_release);
+    }
+}
+
+bool Epoch::TryAdvance() {
+    uint64_t e = s_epoch.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for(EpochRecord* r = s_epoch_records.load(std::memory_order_acquire); r; r = r->next) {
+        uint64_t s = r->state.load(std::memory_order_relaxed);
+        if((s & 1) && (s >> 1) != e) {
+            return false;
+        }
+    }
+    //读者离开临界区之前的访问先于之后的释放
+    std::atomic_thread_fence(std::memory_order_acquire);
+    //失败说明其它线程已经推进
+    s_epoch.compare_exchange_strong(e, e + 1, std::memory_order_release
+                                    ,std::memory_order_relaxed);
+    return true;
+}
+
+//取出纪元不超过e-2的对象
+static void TakeExpired(std::vector<Retired>& from, std::vector<Retired>& to
+                        ,uint64_t e, bool sorted) {
+    size_t k = 0;
+    for(size_t i = 0; i < from.size(); ++i) {
+        if(from[i].epoch + 2 <= e) {
+            to.push_back(from[i]);
+        } else if(sorted) {
+            k = from.size() - i;
+            std::copy(from.begin() + i, from.end(), from.begin());
+            break;
+        } else {
+            from[k++] = from[i];
+        }
+    }
+    from.resize(k);
+}
+
+//释放本线程和孤儿列表中已经可以释放的对象,wait为false时孤儿列表加锁失败就跳过
+static void EpochCollect(EpochLocal& l, bool wait) {
+    uint64_t e = s_epoch.load(std::memory_order_acquire);
+    std::vector<Retired> expired;
+    TakeExpired(l.retired, expired, e, true);
+    OrphanList& orphans = GetEpochOrphans();
+    if(orphans.size.load(std::memory_order_relaxed)) {
+        if(wait) {
+            orphans.mutex.lock();
+        }
+        if(wait || orphans.mutex.tryLock()) {
+            TakeExpired(orphans.items, expired, e, false);
+            orphans.size.store(orphans.items.size(), std::memory_order_relaxed);
+            orphans.mutex.unlock();
+        }
+    }
+    l.nextCollect = l.retired.size() + s_reclaim_batch;
+    FreeRetired(expired);
+}
+
+void Epoch::Retire(void* p, ReclaimDeleter deleter) {
+    EpochLocal& l = t_epoch;
+    l.retired.push_back(Retired{p, deleter, s_epoch.load(std::memory_order_seq_cst)});
+    if(l.retired.size() >= l.nextCollect) {
+        TryAdvance();
+        EpochCollect(l, false);
+    }
+}
+
+void Epoch::Synchronize() {
+    EpochLocal& l = t_epoch;
+    assert(l.nesting == 0);
+    uint64_t target = s_epoch.load(std::memory_order_seq_cst) + 2;
+    while(s_epoch.load(std::memory_order_acquire) < target) {
+        if(!TryAdvance()) {
+            sched_yield();
+        }
+    }
+    EpochCollect(l, true);
+}
+
+uint64_t Epoch::GetEpoch() {
+    return s_epoch.load(std::memory_order_relaxed);
+}
+
+size_t Epoch::GetPendingCount() {
+    return t_epoch.retired.size();
+}
+
+struct alignas(64) HazardPointer::Slot {
+    std::atomic<void*> ptr{nullptr};
+    std::atomic<bool> used{true};
+    Slot* next = nullptr;
+};
+
+// 所有槽位,只增不减
+static std::atomic<HazardPointer::Slot*> s_hazard_slots{nullptr};
+static std::atomic<size_t> s_hazard_slot_count{0};
+//每个线程缓存的空闲槽位数
+static const size_t s_hazard_cache = 8;
+
+struct HazardLocal {
+    std::vector<HazardPointer::Slot*> cache;
+    std::vector<Retired> retired;
+    size_t nextScan = s_reclaim_batch;
+
+    ~HazardLocal() {
+        for(auto i : cache) {
+            i->used.store(false, std::memory_order_release);
+        }
+        GetHazardOrphans().add(retired);
+    }
+};
+
+static thread_local HazardLocal t_hazard;
+
+HazardPointer::HazardPointer() {
+    HazardLocal& l = t_hazard;
+    if(!l.cache.empty()) {
+        m_slot = l.cache.back();
+        l.cache.pop_back();
+        return;
+    }
+    for(Slot* s = s_hazard_slots.load(std::memory_order_acquire); s; s = s->next) {
+        bool used = false;
+        if(!s->used.load(std::memory_order_relaxed)
+                && s->used.compare_exchange_strong(used, true, std::memory_order_acquire)) {
+            m_slot = s;
+            return;
+        }
+    }
+    m_slot = new Slot;
+    m_slot->next = s_hazard_slots.load(std::memory_order_relaxed);
+    while(!s_hazard_slots.compare_exchange_weak(m_slot->next, m_slot, std::memory_order_release
+                                                ,std::memory_order_relaxed));
+    s_hazard_slot_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+HazardPointer::~HazardPointer() {
+    reset();
+    HazardLocal& l = t_hazard;
+    if(l.cache.size() < s_hazard_cache) {
+        l.cache.push_back(m_slot);
+    } else {
+        m_slot->used.store(false, std::memory_order_release);
+    }
+}
+
+void HazardPointer::set(void* p) {
+    m_slot->ptr.store(p, std::memory_order_relaxed);
+    //发布先于之后对源指针的读取,与Scan中的屏障配对
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void HazardPointer::reset() {
+    m_slot->ptr.store(nullptr, std::memory_order_release);
+}
+
+//取出没有被保护的对象,hazards已排序
+static void TakeUnprotected(std::vector<Retired>& from, std::vector<Retired>& to
+                            ,const std::vector<void*>& hazards) {
+    size_t k = 0;
+    for(size_t i = 0; i < from.size(); ++i) {
+        if(std::binary_search(hazards.begin(), hazards.end(), from[i].ptr)) {
+            from[k++] = from[i];
+        } else {
+            to.push_back(from[i]);
+        }
+    }
+    from.resize(k);
+}
+
+//wait为false时孤儿列表加锁失败就跳过
+static void HazardScan(HazardLocal& l, bool wait) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<void*> hazards;
+    for(HazardPointer::Slot* s = s_hazard_slots.load(std::memory_order_acquire); s; s = s->next) {
+        void* p = s->ptr.load(std::memory_order_relaxed);
+        if(p) {
+            hazards.push_back(p);
+        }
+    }
+    std::sort(hazards.begin(), hazards.end());
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    std::vector<Retired> expired;
+    TakeUnprotected(l.retired, expired, hazards);
+    OrphanList& orphans = GetHazardOrphans();
+    if(orphans.size.load(std::memory_order_relaxed)) {
+        if(wait) {
+            orphans.mutex.lock();
+        }
+        if(wait || orphans.mutex.tryLock()) {
+            TakeUnprotected(orphans.items, expired, hazards);
+            orphans.size.store(orphans.items.size(), std::memory_order_relaxed);
+            orphans.mutex.unlock();
+        }
+    }
+    //槽位越多,一次扫描的代价越大,攒的批次也越大
+    l.nextScan = l.retired.size() + std::max(s_reclaim_batch
+                    ,2 * s_hazard_slot_count.load(std::memory_order_relaxed));
+    FreeRetired(expired);
+}
+
+void HazardPointer::Retire(void* p, ReclaimDeleter deleter) {
+    HazardLocal& l = t_hazard;
+    l.retired.push_back(Retired{p, deleter, 0});
+    if(l.retired.size() >= l.nextScan) {
+        HazardScan(l, false);
+    }
+}
+
+void HazardPointer::Scan() {
+    HazardScan(t_hazard, true);
+}
+
+size_t HazardPointer::GetPendingCount() {
+    return t_hazard.retired.size();
+}
+
+}
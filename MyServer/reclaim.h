@@ -0,0 +1,136 @@
+#ifndef __MYSERVER_RECLAIM_H__
+#define __MYSERVER_RECLAIM_H__
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace MyServer {
+
+//释放被回收对象的函数
+typedef void (*ReclaimDeleter)(void* p);
+
+/**
+ * @brief 基于纪元(epoch)的延迟回收
+ * @details 无锁结构的读者进入临界区(Guard)时记下当前全局纪元,离开时清除;
+ *          写者把对象从结构中摘下后Retire,对象记在本线程的待回收列表里,
+ *          标记为当时的全局纪元e
+ *          全局纪元只有在所有临界区中的线程都已经看到它时才能推进,
+ *          推进到e+2时,摘下对象时还在临界区里的线程都已经离开,对象可以释放
+ *          读者只写自己的槽位,不修改对象的引用计数,读多少都不会让cache line来回
+ *          每个线程第一次使用时自动登记一个槽位,线程退出时归还,
+ *          退出时还没释放的对象交给其它线程释放
+ *          临界区可以嵌套;临界区内不能阻塞太久,否则所有线程的回收都会推迟
+ */
+class Epoch {
+public:
+    /**
+     * @brief 局部临界区
+     */
+    class Guard {
+    public:
+        Guard() { Epoch::Enter();}
+        ~Guard() { Epoch::Leave();}
+    private:
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    //进入临界区
+    static void Enter();
+    //离开临界区
+    static void Leave();
+
+    /**
+     * @brief 延迟释放对象
+     * @details 调用前对象必须已经从共享结构中摘下,新来的读者不会再拿到它
+     *          本线程待回收的对象攒够一批后尝试推进纪元并释放
+     */
+    static void Retire(void* p, ReclaimDeleter deleter);
+
+    template<class T>
+    static void Retire(T* p) {
+        Retire(p, [](void* v) { delete (T*)v;});
+    }
+
+    //所有临界区中的线程都已看到当前纪元时推进一次,成功返回true
+    static bool TryAdvance();
+
+    /**
+     * @brief 等到调用前Retire的对象都可以释放,并释放它们
+     * @details 会等待其它线程离开临界区,不能在临界区内调用
+     */
+    static void Synchronize();
+
+    //当前全局纪元
+    static uint64_t GetEpoch();
+    //本线程还没释放的对象数
+    static size_t GetPendingCount();
+};
+
+/**
+ * @brief 风险指针(hazard pointer)
+ * @details 读者把要访问的指针发布到自己的槽位里,再确认源指针没有变化,
+ *          之后对象不会被释放,直到reset或者析构
+ *          写者Retire的对象攒够一批后扫描所有槽位,没有被发布的才释放
+ *          和Epoch相比,一个长时间持有的指针只会拦住它自己,不会拦住所有回收;
+ *          代价是每次protect都要一次全屏障
+ *          对象获取槽位,每个线程缓存少量空闲槽位,创建和析构通常不用遍历全局链表
+ */
+class HazardPointer {
+public:
+    HazardPointer();
+    ~HazardPointer();
+
+    /**
+     * @brief 读取并保护src指向的对象
+     * @return 读到的指针,在reset或者下一次protect之前不会被释放
+     */
+    template<class T>
+    T* protect(const std::atomic<T*>& src) {
+        T* p = src.load(std::memory_order_relaxed);
+        while(true) {
+            set(p);
+            //发布之后再读一次,写者扫描时要么看到发布,要么我们看到新值
+            T* q = src.load(std::memory_order_acquire);
+            if(q == p) {
+                return p;
+            }
+            p = q;
+        }
+    }
+
+    //发布一个已知仍然有效的指针
+    void set(void* p);
+    //清除保护
+    void reset();
+
+    /**
+     * @brief 延迟释放对象
+     * @details 调用前对象必须已经从共享结构中摘下
+     */
+    static void Retire(void* p, ReclaimDeleter deleter);
+
+    template<class T>
+    static void Retire(T* p) {
+        Retire(p, [](void* v) { delete (T*)v;});
+    }
+
+    //扫描一次所有槽位,释放本线程和已退出线程留下的没有被保护的对象
+    static void Scan();
+    //本线程还没释放的对象数
+    static size_t GetPendingCount();
+public:
+    // 槽位,定义在reclaim.cc
+    struct Slot;
+private:
+    HazardPointer(const HazardPointer&) = delete;
+    HazardPointer& operator=(const HazardPointer&) = delete;
+private:
+    // 发布指针的槽位
+    Slot* m_slot;
+};
+
+}
+
+#endif
@@ -0,0 +1,309 @@
+#include "scheduler.h"
+#include "log.h"
+#include "hook.h"
+#include <algorithm>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+//当前线程所属的调度器和worker下标
+static thread_local Scheduler* t_scheduler = nullptr;
+static thread_local int t_worker_index = -1;
+
+//从全局队列一次最多取走的任务数,多出来的放进自己的队列供其它worker窃取
+static const size_t s_global_batch = 32;
+
+Scheduler::Scheduler(size_t threads, const std::string& name)
+    :m_name(name) {
+    if(threads == 0) {
+        threads = 1;
+    }
+    if(m_name.empty()) {
+        m_name = "scheduler";
+    }
+    for(size_t i = 0; i < threads; ++i) {
+        m_workers.push_back(Worker::ptr(new Worker));
+    }
+}
+
+Scheduler::~Scheduler() {
+    if(m_started && !m_stopping) {
+        stop();
+    }
+    for(auto& i : m_workers) {
+        while(Task* t = i->deque.pop()) {
+            delete t;
+        }
+        for(auto t : i->inbox) {
+            delete t;
+        }
+    }
+    for(auto t : m_global) {
+        delete t;
+    }
+}
+
+Scheduler* Scheduler::GetThis() {
+    return t_scheduler;
+}
+
+int Scheduler::GetWorkerIndex() {
+    return t_worker_index;
+}
+
+void Scheduler::start() {
+    if(m_started) {
+        return;
+    }
+    m_started = true;
+    //所有worker一起创建,只等待一次全部就绪
+    auto threads = Thread::CreateBatch(m_workers.size(), [this](size_t i) {
+        run((int)i);
+    }, m_name);
+    for(size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i]->thread = threads[i];
+    }
+}
+
+void Scheduler::stop() {
+    if(!m_started || m_stopping) {
+        return;
+    }
+    if(t_scheduler == this) {
+        MYSERVER_LOG_ERROR(g_logger) << "Scheduler::stop can not be called in worker, name=" << m_name;
+        return;
+    }
+    m_stopping = true;
+    tickleAll();
+    for(auto& i : m_workers) {
+        if(i->thread) {
+            i->thread->join();
+        }
+    }
+}
+
+void Scheduler::schedule(std::function<void()> cb, int thread) {
+    if(thread >= (int)m_workers.size()) {
+        thread = -1;
+    }
+    if(scheduleNoLock(new Task(cb), thread)) {
+        tickle(thread);
+    }
+}
+
+void Scheduler::schedule(Fiber::ptr fiber, int thread) {
+    if(thread >= (int)m_workers.size()) {
+        thread = -1;
+    }
+    if(scheduleNoLock(new Task(fiber), thread)) {
+        tickle(thread);
+    }
+}
+
+bool Scheduler::scheduleNoLock(Task* task, int thread) {
+    ++m_pending;
+    if(thread >= 0) {
+        Worker& w = *m_workers[thread];
+        MutexType::Lock lock(w.inboxMutex);
+        w.inbox.push_back(task);
+        ++w.inboxSize;
+        return true;
+    }
+    int self = t_scheduler == this ? t_worker_index : -1;
+    if(self >= 0 && m_workers[self]->deque.push(task)) {
+        //与parkWorker里登记空闲后的检查配对,保证不会丢失唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return m_idleCount.load() > 0;
+    }
+    {
+        MutexType::Lock lock(m_mutex);
+        m_global.push_back(task);
+        ++m_globalSize;
+    }
+    return m_idleCount.load() > 0;
+}
+
+void Scheduler::tickle(int thread) {
+    wakeWorker(thread);
+}
+
+void Scheduler::tickleAll() {
+    while(wakeWorker(-1));
+}
+
+void Scheduler::idle() {
+    parkWorker();
+}
+
+bool Scheduler::stopping() {
+    return m_stopping && m_pending == 0;
+}
+
+bool Scheduler::hasTask() const {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_globalSize.load() > 0) {
+        return true;
+    }
+    if(t_worker_index >= 0 && m_workers[t_worker_index]->inboxSize.load() > 0) {
+        return true;
+    }
+    for(auto& i : m_workers) {
+        if(!i->deque.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::parkWorker() {
+    int index = t_worker_index;
+    Worker& w = *m_workers[index];
+    {
+        MutexType::Lock lock(m_idleMutex);
+        w.parked = true;
+        m_idleWorkers.push_back(index);
+        ++m_idleCount;
+    }
+    //登记空闲后再检查一次,期间提交的任务一定能被看到或者提交方会唤醒我们
+    if(hasTask() || stopping()) {
+        MutexType::Lock lock(m_idleMutex);
+        if(w.parked) {
+            w.parked = false;
+            m_idleWorkers.erase(std::find(m_idleWorkers.begin(), m_idleWorkers.end(), index));
+            --m_idleCount;
+            return;
+        }
+        //已经被唤醒,消费掉对应的notify
+    }
+    w.semaphore.wait();
+}
+
+bool Scheduler::wakeWorker(int thread) {
+    int target = thread;
+    {
+        MutexType::Lock lock(m_idleMutex);
+        if(thread >= 0) {
+            if(!m_workers[thread]->parked) {
+                return false;
+            }
+            m_idleWorkers.erase(std::find(m_idleWorkers.begin(), m_idleWorkers.end(), thread));
+        } else {
+            if(m_idleWorkers.empty()) {
+                return false;
+            }
+            target = m_idleWorkers.back();
+            m_idleWorkers.pop_back();
+        }
+        m_workers[target]->parked = false;
+        --m_idleCount;
+    }
+    m_workers[target]->semaphore.notify();
+    return true;
+}
+
+Scheduler::Task* Scheduler::takeTask(int index) {
+    Worker& w = *m_workers[index];
+    Task* task = w.deque.pop();
+    if(task) {
+        return task;
+    }
+
+    if(w.inboxSize.load() > 0) {
+        MutexType::Lock lock(w.inboxMutex);
+        if(!w.inbox.empty()) {
+            task = w.inbox.front();
+            w.inbox.pop_front();
+            --w.inboxSize;
+            return task;
+        }
+    }
+
+    if(m_globalSize.load() > 0) {
+        bool need_tickle = false;
+        {
+            MutexType::Lock lock(m_mutex);
+            if(!m_global.empty()) {
+                task = m_global.front();
+                m_global.pop_front();
+                --m_globalSize;
+            }
+            for(size_t i = 1; i < s_global_batch && !m_global.empty(); ++i) {
+                if(!w.deque.push(m_global.front())) {
+                    break;
+                }
+                m_global.pop_front();
+                --m_globalSize;
+                need_tickle = true;
+            }
+        }
+        if(need_tickle && m_idleCount.load() > 0) {
+            tickle(-1);
+        }
+        if(task) {
+            return task;
+        }
+    }
+
+    size_t count = m_workers.size();
+    for(size_t i = 1; i < count; ++i) {
+        Worker& victim = *m_workers[(index + i) % count];
+        //steal竞争失败时队列可能还有任务,再试一次
+        for(int retry = 0; retry < 2 && !victim.deque.empty(); ++retry) {
+            task = victim.deque.steal();
+            if(task) {
+                return task;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void Scheduler::execute(Task* task) {
+    Fiber::ptr fiber;
+    if(task->fiber) {
+        fiber.swap(task->fiber);
+    } else {
+        Fiber::ptr& cached = m_workers[t_worker_index]->cbFiber;
+        if(cached) {
+            cached->reset(task->cb);
+            fiber.swap(cached);
+        } else {
+            fiber.reset(new Fiber(task->cb));
+        }
+    }
+    delete task;
+
+    fiber->resume();
+    //执行完并且没有其它地方引用的协程留给下一个函数任务
+    if(fiber->isFinished() && fiber.use_count() == 1) {
+        m_workers[t_worker_index]->cbFiber.swap(fiber);
+    }
+    //最后一个任务执行完,唤醒所有worker退出
+    if(--m_pending == 0 && m_stopping) {
+        tickleAll();
+    }
+}
+
+void Scheduler::run(int index) {
+    t_scheduler = this;
+    t_worker_index = index;
+    //worker线程中阻塞的系统调用只挂起当前协程
+    set_hook_enable(true);
+    while(true) {
+        Task* task = takeTask(index);
+        if(task) {
+            execute(task);
+            continue;
+        }
+        if(stopping()) {
+            break;
+        }
+        idle();
+    }
+    set_hook_enable(false);
+    t_scheduler = nullptr;
+    t_worker_index = -1;
+}
+
+}
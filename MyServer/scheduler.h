@@ -0,0 +1,240 @@
+#ifndef __MYSERVER_SCHEDULER_H__
+#define __MYSERVER_SCHEDULER_H__
+
+#include <memory>
+#include <vector>
+#include <list>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include "thread.h"
+#include "fiber.h"
+
+namespace MyServer {
+
+/**
+ * @brief 工作窃取用的双端队列(Chase-Lev)
+ * @details 只有所属的worker可以push/pop底部,其它线程从顶部steal
+ *          容量固定为2的幂,满了push返回false,由调用方放到全局队列
+ */
+template<class T>
+class WorkStealingDeque {
+public:
+    WorkStealingDeque(size_t capacity = 4096)
+        :m_mask(capacity - 1)
+        ,m_buffer(new std::atomic<T*>[capacity]) {
+    }
+
+    ~WorkStealingDeque() {
+        delete[] m_buffer;
+    }
+
+    //只能由所属线程调用
+    bool push(T* v) {
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_acquire);
+        if(b - t > (int64_t)m_mask) {
+            return false;
+        }
+        m_buffer[b & m_mask].store(v, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    //只能由所属线程调用,后进先出
+    T* pop() {
+        int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        T* v = nullptr;
+        if(t <= b) {
+            v = m_buffer[b & m_mask].load(std::memory_order_relaxed);
+            if(t == b) {
+                //只剩最后一个,和steal竞争
+                if(!m_top.compare_exchange_strong(t, t + 1
+                            ,std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    v = nullptr;
+                }
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return v;
+    }
+
+    //任意线程调用,先进先出,竞争失败返回nullptr
+    T* steal() {
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = m_bottom.load(std::memory_order_acquire);
+        if(t < b) {
+            T* v = m_buffer[t & m_mask].load(std::memory_order_relaxed);
+            if(!m_top.compare_exchange_strong(t, t + 1
+                        ,std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return v;
+        }
+        return nullptr;
+    }
+
+    bool empty() const {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+private:
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+private:
+    alignas(64) std::atomic<int64_t> m_top{0};
+    alignas(64) std::atomic<int64_t> m_bottom{0};
+    size_t m_mask;
+    std::atomic<T*>* m_buffer;
+};
+
+/**
+ * @brief 工作窃取的任务调度器
+ * @details 每个worker是一个MyServer::Thread,拥有自己的WorkStealingDeque
+ *          任务在协程中执行,函数任务复用worker上一次执行完的协程;
+ *          协程yield后调度器不再持有它,由挂起它的一方重新schedule
+ *          worker内部提交的任务放进自己的队列,外部线程提交的任务放进全局队列,
+ *          指定worker的任务放进该worker的收件箱(不会被窃取)
+ *          worker取任务的顺序: 自己的队列 -> 收件箱 -> 全局队列 -> 窃取其它worker
+ *          没有任务时先登记为空闲再检查一次队列,然后阻塞在自己的信号量上,不自旋
+ */
+class Scheduler {
+public:
+    typedef std::shared_ptr<Scheduler> ptr;
+    typedef Mutex MutexType;
+
+    /**
+     * @param[in] threads worker数量
+     * @param[in] name 调度器名称,也是worker线程名的前缀
+     */
+    Scheduler(size_t threads = 1, const std::string& name = "");
+    virtual ~Scheduler();
+
+    const std::string& getName() const { return m_name; }
+    size_t getThreadCount() const { return m_workers.size(); }
+
+    //当前线程所属的调度器
+    static Scheduler* GetThis();
+    //当前线程在所属调度器中的worker下标,不是worker返回-1
+    static int GetWorkerIndex();
+
+    //启动所有worker
+    void start();
+    //等待已提交的任务全部执行完后停止所有worker
+    void stop();
+
+    /**
+     * @brief 提交任务,任意线程都可以调用
+     * @param[in] cb 任务
+     * @param[in] thread 指定执行的worker下标,-1表示任意worker
+     */
+    void schedule(std::function<void()> cb, int thread = -1);
+
+    /**
+     * @brief 提交协程,协程状态需要是INIT或HOLD
+     * @param[in] thread 指定执行的worker下标,-1表示任意worker
+     */
+    void schedule(Fiber::ptr fiber, int thread = -1);
+
+    //批量提交,只唤醒一次
+    template<class InputIterator>
+    void schedule(InputIterator begin, InputIterator end) {
+        bool need_tickle = false;
+        while(begin != end) {
+            need_tickle = scheduleNoLock(new Task(*begin), -1) || need_tickle;
+            ++begin;
+        }
+        if(need_tickle) {
+            tickle(-1);
+        }
+    }
+
+    //是否有空闲(阻塞)的worker
+    bool hasIdleThreads() const { return m_idleCount.load() > 0; }
+protected:
+    /**
+     * @brief 唤醒worker
+     * @param[in] thread 需要唤醒的worker下标,-1表示任意一个空闲的worker
+     */
+    virtual void tickle(int thread);
+    //唤醒所有worker,用于停止
+    virtual void tickleAll();
+    //没有任务时调用,返回后worker重新取任务
+    virtual void idle();
+    //是否可以停止
+    virtual bool stopping();
+    //是否已经调用了stop
+    bool isStopping() const { return m_stopping;}
+
+    //worker阻塞直到被wakeWorker唤醒,阻塞前还有任务则直接返回
+    void parkWorker();
+    //唤醒阻塞的worker,没有阻塞的worker返回false
+    bool wakeWorker(int thread);
+    //是否有当前worker可以执行的任务
+    bool hasTask() const;
+
+    struct Task {
+        Task(std::function<void()> f)
+            :cb(f) {
+        }
+        Task(Fiber::ptr f)
+            :fiber(f) {
+        }
+        std::function<void()> cb;
+        Fiber::ptr fiber;
+    };
+
+    //放入队列,返回是否需要唤醒worker
+    bool scheduleNoLock(Task* task, int thread);
+    //执行一个任务
+    virtual void execute(Task* task);
+protected:
+    //空闲的worker数,包括阻塞在信号量上的和子类中阻塞在其它地方(如epoll_wait)的
+    //提交任务时看到非0才会调用tickle
+    std::atomic<size_t> m_idleCount{0};
+private:
+    struct Worker {
+        typedef std::shared_ptr<Worker> ptr;
+        WorkStealingDeque<Task> deque;
+        //指定给本worker的任务
+        MutexType inboxMutex;
+        std::deque<Task*> inbox;
+        std::atomic<size_t> inboxSize{0};
+        //阻塞等待任务
+        Semaphore semaphore;
+        bool parked = false;
+        Thread::ptr thread;
+        //执行完的函数任务协程,下一个函数任务复用它的栈
+        Fiber::ptr cbFiber;
+    };
+
+    void run(int index);
+    Task* takeTask(int index);
+private:
+    std::string m_name;
+    std::vector<Worker::ptr> m_workers;
+
+    //外部提交的任务
+    MutexType m_mutex;
+    std::deque<Task*> m_global;
+    std::atomic<size_t> m_globalSize{0};
+
+    //空闲worker
+    MutexType m_idleMutex;
+    std::vector<int> m_idleWorkers;
+
+    //未完成的任务数
+    std::atomic<size_t> m_pending{0};
+    std::atomic<bool> m_stopping{false};
+    bool m_started = false;
+};
+
+}
+
+#endif
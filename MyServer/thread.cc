@@ -1,5 +1,12 @@
 #include "thread.h"
 #include "log.h"
+#include <unistd.h>
+#include <sched.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
 
 namespace MyServer {
 
@@ -31,6 +38,124 @@ void Semaphore::notify() {
     }
 }
 
+//加锁失败后的自旋次数,大约是一次无竞争临界区的几倍
+static const int s_futex_spin = 100;
+
+//futex等待,*addr仍然等于val时睡眠
+static inline void FutexWait(void* addr, int val) {
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+}
+
+//唤醒最多n个等待addr的线程
+static inline void FutexWake(void* addr, int n) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+void FutexMutex::lockSlow() {
+    for(int i = 0; i < s_futex_spin; ++i) {
+        int c = m_state.load(std::memory_order_relaxed);
+        if(c == 0 && m_state.compare_exchange_weak(c, 1, std::memory_order_acquire
+                                                   ,std::memory_order_relaxed)) {
+            return;
+        }
+        //已经有线程在睡眠,继续自旋也抢不过被唤醒的线程
+        if(c == 2) {
+            break;
+        }
+        CpuRelax();
+    }
+    //标记为有等待者,拿到锁时也保持2,解锁时多一次唤醒但不会丢失唤醒
+    int c = m_state.exchange(2, std::memory_order_acquire);
+    while(c != 0) {
+        FutexWait(&m_state, 2);
+        c = m_state.exchange(2, std::memory_order_acquire);
+    }
+}
+
+void FutexMutex::wake() {
+    FutexWake(&m_state, 1);
+}
+
+void EventCount::wait(uint32_t key) {
+    while((m_val.load(std::memory_order_acquire) >> EPOCH_SHIFT) == key) {
+        FutexWait(epochAddr(), (int)key);
+    }
+    m_val.fetch_sub(WAITER_INC, std::memory_order_seq_cst);
+}
+
+void EventCount::notifySlow() {
+    //等待者自己注销,这里只推进事件号;登记数仍然不为0说明有线程可能在futex上
+    uint64_t prev = m_val.fetch_add(EPOCH_INC, std::memory_order_acq_rel);
+    if(prev & WAITER_MASK) {
+        FutexWake(epochAddr(), INT_MAX);
+    }
+}
+
+void Latch::waitSlow() {
+    for(int i = 0; i < s_futex_spin; ++i) {
+        if(tryWait()) {
+            return;
+        }
+        CpuRelax();
+    }
+    uint32_t s = m_state.load(std::memory_order_acquire);
+    while((s >> 1) != 0) {
+        //先标记有等待者,countDown看到标记才会进入内核
+        if(!(s & 1) && !m_state.compare_exchange_weak(s, s | 1, std::memory_order_acquire
+                                                     ,std::memory_order_acquire)) {
+            continue;
+        }
+        FutexWait(&m_state, (int)(s | 1));
+        s = m_state.load(std::memory_order_acquire);
+    }
+}
+
+void Latch::wake() {
+    //此时等待者可能已经返回并销毁了门闩,这里只用到地址,多余的唤醒对futex是无害的
+    FutexWake(&m_state, INT_MAX);
+}
+
+//等待其它线程时先自旋,超过次数后让出CPU
+static inline void Backoff(int& spins) {
+    if(++spins < s_futex_spin) {
+        CpuRelax();
+    } else {
+        sched_yield();
+    }
+}
+
+void BRMutex::rdlockSlow(std::atomic<int>& readers) {
+    while(true) {
+        readers.fetch_sub(1, std::memory_order_release);
+        int spins = 0;
+        while(m_writer.load(std::memory_order_acquire)) {
+            Backoff(spins);
+        }
+        readers.fetch_add(1, std::memory_order_seq_cst);
+        if(!m_writer.load(std::memory_order_seq_cst)) {
+            return;
+        }
+    }
+}
+
+void BRMutex::wrlock() {
+    m_writeMutex.lock();
+    m_writer.store(true, std::memory_order_seq_cst);
+    for(uint32_t i = 0; i < SLOTS; ++i) {
+        int spins = 0;
+        while(m_slots[i].readers.load(std::memory_order_acquire)) {
+            Backoff(spins);
+        }
+    }
+    m_writerSlot.store(GetThreadSlot(), std::memory_order_relaxed);
+}
+
+void BRMutex::wrunlock() {
+    m_writerSlot.store(~0u, std::memory_order_relaxed);
+    m_writer.store(false, std::memory_order_release);
+    m_writeMutex.unlock();
+}
+
 Thread* Thread::GetThis() {
     return t_thread;
 }
@@ -44,21 +169,103 @@ void Thread::SetName(const std::string& name) {
     t_thread_name = name;
 }
 
-Thread::Thread(std::function<void()> cb, const std::string& name)
+//按参数设置线程属性,返回是否设置了实时调度策略
+static bool InitThreadAttr(pthread_attr_t* attr, const ThreadOptions& opts
+                           ,const std::vector<int>& cpus, bool realtime) {
+    if(opts.stackSize) {
+        pthread_attr_setstacksize(attr, opts.stackSize);
+    }
+    if(!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(auto i : cpus) {
+            if(i >= 0 && i < CPU_SETSIZE) {
+                CPU_SET(i, &set);
+            }
+        }
+        pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+    }
+    if(realtime && opts.policy != SCHED_OTHER) {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = opts.priority;
+        pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(attr, opts.policy);
+        pthread_attr_setschedparam(attr, &param);
+        return true;
+    }
+    return false;
+}
+
+Thread::Thread(std::function<void()> cb, const std::string& name, const ThreadOptions& opts)
     :m_cb(cb)
-    ,m_name(name) {
-    if(name.empty()) {
+    ,m_name(name)
+    ,m_numaNode(opts.numaNode) {
+    Latch ready(1);
+    m_ready = &ready;
+    start(opts);
+    //顺序问题，等线程构造好了才返回构造函数
+    ready.wait();
+}
+
+Thread::Thread(std::function<void()> cb, const std::string& name
+               ,const ThreadOptions& opts, Latch& ready)
+    :m_cb(cb)
+    ,m_name(name)
+    ,m_numaNode(opts.numaNode)
+    ,m_ready(&ready) {
+    start(opts);
+}
+
+std::vector<Thread::ptr> Thread::CreateBatch(size_t count, std::function<void(size_t)> cb
+                                             ,const std::string& name, const ThreadOptions& opts) {
+    std::vector<Thread::ptr> threads;
+    threads.reserve(count);
+    Latch ready(count);
+    try {
+        for(size_t i = 0; i < count; ++i) {
+            threads.push_back(Thread::ptr(new Thread(std::bind(cb, i)
+                            ,name + "_" + std::to_string(i), opts, ready)));
+        }
+    } catch(...) {
+        //没创建出来的线程替它们减掉,等已创建的线程就绪后再抛出,它们还在访问ready
+        ready.countDown(count - threads.size());
+        ready.wait();
+        throw;
+    }
+    ready.wait();
+    return threads;
+}
+
+void Thread::start(const ThreadOptions& opts) {
+    if(m_name.empty()) {
         m_name = "UNKNOW";
     }
+    std::vector<int> cpus = opts.cpus;
+    if(cpus.empty() && opts.numaNode >= 0) {
+        cpus = GetNumaNodeCpus(opts.numaNode);
+    }
     //线程创建，第二个参数可以设置分离属性,但直接设置的时候仍有可能存在内存泄漏
-    int rt = pthread_create(&m_thread, nullptr, &Thread::run, this);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    bool realtime = InitThreadAttr(&attr, opts, cpus, true);
+    int rt = pthread_create(&m_thread, &attr, &Thread::run, this);
+    pthread_attr_destroy(&attr);
+    if(rt == EPERM && realtime) {
+        //没有权限使用实时调度策略,用默认策略重试
+        MYSERVER_LOG_WARN(g_logger) << "pthread_create with policy=" << opts.policy
+            << " no permission, fallback to SCHED_OTHER name=" << m_name;
+        pthread_attr_init(&attr);
+        InitThreadAttr(&attr, opts, cpus, false);
+        rt = pthread_create(&m_thread, &attr, &Thread::run, this);
+        pthread_attr_destroy(&attr);
+    }
     if(rt) {
+        m_thread = 0;
         MYSERVER_LOG_ERROR(g_logger) << "pthread_create thread fail, rt=" << rt
-            << " name=" << name;
+            << " name=" << m_name;
         throw std::logic_error("pthread_create error");
     }
-    //顺序问题，等线程构造好了才返回构造函数
-    m_semaphore.wait();
 }
 Thread::~Thread() {
     if(m_thread) {
@@ -89,13 +296,25 @@ void* Thread::run(void* arg) {
     thread->m_id = MyServer::GetThreadId();
     //给线程命名
     pthread_setname_np(pthread_self(), thread->m_name.substr(0, 15).c_str());
+    if(thread->m_numaNode >= 0) {
+        //之后首次访问的页优先从该节点分配,节点内存不足时从其它节点分配
+        unsigned long mask[4] = {0};
+        if(thread->m_numaNode < (int)(sizeof(mask) * 8)) {
+            mask[thread->m_numaNode / (sizeof(unsigned long) * 8)]
+                |= 1ul << (thread->m_numaNode % (sizeof(unsigned long) * 8));
+            if(syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8)) {
+                MYSERVER_LOG_WARN(g_logger) << "set_mempolicy node=" << thread->m_numaNode
+                    << " fail, errno=" << errno << " name=" << thread->m_name;
+            }
+        }
+    }
 
     std::function<void()> cb;
     //当里面存在智能指针时，防止其不会被释放掉,用swap释放掉
     cb.swap(thread->m_cb);
 
-    
-    thread->m_semaphore.notify();
+    //之后thread可能已被创建方释放,不能再访问
+    thread->m_ready->countDown();
     //执行函数
     cb();
     return 0;
@@ -8,6 +8,12 @@
 #include <stdint.h>
 #include <semaphore.h>
 #include <atomic>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <string.h>
+#include <type_traits>
+#include "util.h"
 
 namespace MyServer {
 
@@ -166,12 +172,18 @@ private:
     pthread_mutex_t m_mutex;
 };
 
-class NullMutex {
+//空锁,不做任何操作,用于不需要线程安全的场景
+class NullMutex /*: Noncopyable*/ {
+public:
+    // 局部锁
     typedef ScopedLockImpl<NullMutex> Lock;
-    NullMutex();
-    ~NullMutex();
-    void lock();
-    void unlock();
+
+    NullMutex() {}
+    ~NullMutex() {}
+    //加锁
+    void lock() {}
+    //解锁
+    void unlock() {}
 };
 
 class RWMutex /*: Noncopyable*/{
@@ -207,16 +219,43 @@ private:
     pthread_rwlock_t m_lock;
 };
 
-class NullRWMutex {
+//空读写锁,不做任何操作,用于不需要线程安全的场景
+class NullRWMutex /*: Noncopyable*/ {
+public:
+    // 局部读锁
     typedef ReadScopedLockImpl<NullRWMutex> ReadLock;
+    // 局部写锁
     typedef WriteScopedLockImpl<NullRWMutex> WriteLock;
-    NullRWMutex();
-    ~NullRWMutex();
-    void wrlock();
-    void rdlock();
-    void unlock();
+
+    NullRWMutex() {}
+    ~NullRWMutex() {}
+    //上写锁
+    void wrlock() {}
+    //上读锁
+    void rdlock() {}
+    //解锁
+    void unlock() {}
 };
 
+/**
+ * @brief 按构建选项选择锁类型
+ * @details 单线程部署时用 cmake -DMYSERVER_SINGLE_THREADED=ON 构建,
+ *          日志和配置模块的锁换成NullMutex/NullRWMutex,加解锁内联后为空
+ *          这种构建下日志器和配置只能在一个线程中使用,
+ *          配置的异步通知(Config::SetListenerAsync)仍然使用真实的锁
+ */
+#ifdef MYSERVER_SINGLE_THREADED
+template<class T>
+using PolicyMutex = NullMutex;
+template<class T>
+using PolicyRWMutex = NullRWMutex;
+#else
+template<class T>
+using PolicyMutex = T;
+template<class T>
+using PolicyRWMutex = T;
+#endif
+
 class Spinlock /*: Noncopyable*/ {
 public:
     // 局部锁
@@ -242,22 +281,391 @@ private:
     pthread_spinlock_t m_mutex;
 };
 
-class Thread {
+//自旋等待时让出流水线,降低功耗并减少对另一个超线程的干扰
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief 原子操作实现的自旋锁
+ * @details 只有一次test_and_set,适合临界区极短且不会阻塞的场景
+ */
+class CASLock /*: Noncopyable*/ {
+public:
+    // 局部锁
+    typedef ScopedLockImpl<CASLock> Lock;
+
+    CASLock() {
+        m_mutex.clear();
+    }
+
+    //上锁
+    void lock() {
+        while(std::atomic_flag_test_and_set_explicit(&m_mutex, std::memory_order_acquire)) {
+            CpuRelax();
+        }
+    }
+    //解锁
+    void unlock() {
+        std::atomic_flag_clear_explicit(&m_mutex, std::memory_order_release);
+    }
+private:
+    // 原子状态
+    volatile std::atomic_flag m_mutex;
+};
+
+/**
+ * @brief 自适应互斥量
+ * @details 基于futex,状态0未加锁,1加锁且没有等待者,2加锁且可能有等待者
+ *          无竞争时加锁解锁各一次原子操作,不进入内核
+ *          有竞争时先短暂自旋,持有者很快释放就不用睡眠;仍然拿不到再futex等待,
+ *          持有者被抢占或者临界区里有IO时不会像Spinlock一样空转
+ */
+class FutexMutex /*: Noncopyable*/ {
+public:
+    // 局部锁
+    typedef ScopedLockImpl<FutexMutex> Lock;
+
+    FutexMutex() {}
+
+    //上锁
+    void lock() {
+        int c = 0;
+        if(!m_state.compare_exchange_strong(c, 1, std::memory_order_acquire
+                                            ,std::memory_order_relaxed)) {
+            lockSlow();
+        }
+    }
+    //尝试上锁,失败立即返回false
+    bool tryLock() {
+        int c = 0;
+        return m_state.compare_exchange_strong(c, 1, std::memory_order_acquire
+                                               ,std::memory_order_relaxed);
+    }
+    //解锁,有等待者时唤醒一个
+    void unlock() {
+        if(m_state.exchange(0, std::memory_order_release) == 2) {
+            wake();
+        }
+    }
+private:
+    FutexMutex(const FutexMutex&) = delete;
+    FutexMutex& operator=(const FutexMutex&) = delete;
+
+    void lockSlow();
+    void wake();
+private:
+    std::atomic<int> m_state{0};
+};
+
+/**
+ * @brief 读多写少的读写锁(big-reader lock)
+ * @details 每个线程槽一个独占cache line的读者计数,读锁只修改自己槽的计数,
+ *          读者之间不会争抢同一个cache line,读锁的开销不随线程数增长
+ *          写锁先置写标志,再等待所有槽的读者计数归零,写的代价与槽数成正比
+ *          有写者时新的读者让路,写者不会饿死;读锁不可重入
+ *          多于SLOTS个线程时共享槽,仍然正确只是会有争用
+ */
+class BRMutex /*: Noncopyable*/ {
+public:
+    // 局部读锁
+    typedef ReadScopedLockImpl<BRMutex> ReadLock;
+
+    // 局部写锁
+    typedef WriteScopedLockImpl<BRMutex> WriteLock;
+
+    //读者槽的数量
+    static const uint32_t SLOTS = 64;
+
+    BRMutex() {}
+
+    //上读锁
+    void rdlock() {
+        std::atomic<int>& readers = m_slots[GetThreadSlot() & (SLOTS - 1)].readers;
+        //与写者先置标志再检查计数配对,双方至少有一方能看到对方
+        readers.fetch_add(1, std::memory_order_seq_cst);
+        if(m_writer.load(std::memory_order_seq_cst)) {
+            rdlockSlow(readers);
+        }
+    }
+    //上写锁
+    void wrlock();
+    //解锁
+    void unlock() {
+        uint32_t slot = GetThreadSlot();
+        if(m_writerSlot.load(std::memory_order_relaxed) == slot) {
+            wrunlock();
+            return;
+        }
+        m_slots[slot & (SLOTS - 1)].readers.fetch_sub(1, std::memory_order_release);
+    }
+private:
+    BRMutex(const BRMutex&) = delete;
+    BRMutex& operator=(const BRMutex&) = delete;
+
+    //有写者时撤销计数,等写者结束后重试
+    void rdlockSlow(std::atomic<int>& readers);
+    void wrunlock();
+private:
+    struct alignas(64) Slot {
+        std::atomic<int> readers{0};
+    };
+    Slot m_slots[SLOTS];
+    // 是否有写者
+    alignas(64) std::atomic<bool> m_writer{false};
+    // 持有写锁的线程槽位,用于unlock区分读写
+    std::atomic<uint32_t> m_writerSlot{~0u};
+    // 写者之间互斥
+    FutexMutex m_writeMutex;
+};
+
+/**
+ * @brief 事件计数,条件不满足时在futex上等待
+ * @details 等待方: key = prepareWait(); 再检查一次条件,满足则cancelWait()后返回,否则wait(key)
+ *          通知方: 先让条件成立再notify()
+ *          等待者数量和事件号放在同一个64位字里(低32位数量,高32位事件号),
+ *          登记和读取事件号是同一次原子加,不会出现登记后被其它通知清掉登记的情况;
+ *          等待者在wait返回或cancelWait时自己注销
+ *          没有登记的等待者时notify只是一次读,连续的notify不会每次都进入内核
+ *          prepareWait之后发生的notify都会让wait立即返回,不会丢失唤醒
+ */
+class EventCount /*: Noncopyable*/ {
 public:
+    EventCount() {}
+
+    //登记为等待者,返回当前的事件号
+    uint32_t prepareWait() {
+        return m_val.fetch_add(WAITER_INC, std::memory_order_seq_cst) >> EPOCH_SHIFT;
+    }
+    //prepareWait之后条件已经满足,不再等待
+    void cancelWait() {
+        m_val.fetch_sub(WAITER_INC, std::memory_order_seq_cst);
+    }
+    //等待事件号变化,返回时已注销
+    void wait(uint32_t key);
+    //唤醒所有等待者
+    void notify() {
+        //与prepareWait配对,条件的修改先于等待者数量的读取
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_val.load(std::memory_order_relaxed) & WAITER_MASK) {
+            notifySlow();
+        }
+    }
+private:
+    EventCount(const EventCount&) = delete;
+    EventCount& operator=(const EventCount&) = delete;
+
+    void notifySlow();
+    //事件号所在的32位,futex等待的地址
+    uint32_t* epochAddr() {
+        static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "EventCount assumes little endian");
+        return (uint32_t*)&m_val + 1;
+    }
+private:
+    static const uint64_t WAITER_INC = 1;
+    static const uint64_t WAITER_MASK = 0xffffffffull;
+    static const uint32_t EPOCH_SHIFT = 32;
+    static const uint64_t EPOCH_INC = 1ull << EPOCH_SHIFT;
+    // 高32位事件号,低32位登记的等待者数量
+    std::atomic<uint64_t> m_val{0};
+};
 
+/**
+ * @brief 倒计数门闩,计数减到0后所有等待者返回
+ * @details 计数和是否有等待者放在同一个futex字里,没有等待者时countDown只是一次原子减;
+ *          减到0后countDown不再访问对象的内存,等待者返回后可以立即销毁门闩
+ *          (放在栈上等待线程启动的场景)
+ *          计数为0后不能再countDown,需要重新使用时调用reset
+ */
+class Latch /*: Noncopyable*/ {
+public:
+    Latch(uint32_t count = 1)
+        :m_state(count << 1) {
+    }
 
+    //计数减n,减到0时唤醒所有等待者
+    void countDown(uint32_t n = 1) {
+        uint32_t old = m_state.fetch_sub(n << 1, std::memory_order_acq_rel);
+        if((old >> 1) == n && (old & 1)) {
+            wake();
+        }
+    }
+    //等待计数减到0
+    void wait() {
+        if(!tryWait()) {
+            waitSlow();
+        }
+    }
+    //计数是否已经为0
+    bool tryWait() const {
+        return (m_state.load(std::memory_order_acquire) >> 1) == 0;
+    }
+    //重新设置计数,调用时不能有线程在等待
+    void reset(uint32_t count) {
+        m_state.store(count << 1, std::memory_order_release);
+    }
 private:
-    std::atomic_flag m_mutex;
+    Latch(const Latch&) = delete;
+    Latch& operator=(const Latch&) = delete;
 
+    void waitSlow();
+    void wake();
+private:
+    // 高31位是计数,最低位表示有线程在futex上等待
+    std::atomic<uint32_t> m_state;
+};
+
+/**
+ * @brief 顺序锁,用于很小、读得很频繁、很少修改的共享数据
+ * @details 写者持锁期间序号为奇数,写完再加一;读者先读序号,拷贝数据,
+ *          再确认序号没有变化,否则重试。读者不写任何共享内存,
+ *          读多少次都不会让cache line在核之间来回
+ *          数据按8字节分段用原子操作拷贝,读者读到一半的数据也不会有数据竞争,
+ *          只是会因为序号变化而丢弃;T必须可以平凡拷贝
+ *          写锁内用getNoLock/setNoLock读写,不能调用load,否则会一直等待自己
+ */
+template<class T>
+class SeqLock /*: Noncopyable*/ {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires trivially copyable T");
+
+    // 局部写锁
+    typedef WriteScopedLockImpl<SeqLock> WriteLock;
+
+    SeqLock(const T& v = T()) {
+        memset(m_words, 0, sizeof(m_words));
+        memcpy(m_words, &v, sizeof(T));
+    }
+
+    //读取一份一致的拷贝
+    T load() const {
+        uint64_t buf[WORDS];
+        uint32_t seq = 0;
+        do {
+            seq = m_seq.load(std::memory_order_acquire);
+            while(seq & 1) {
+                CpuRelax();
+                seq = m_seq.load(std::memory_order_acquire);
+            }
+            for(size_t i = 0; i < WORDS; ++i) {
+                buf[i] = __atomic_load_n(&m_words[i], __ATOMIC_RELAXED);
+            }
+            //数据的读取不能排到再次读取序号之后
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while(seq != m_seq.load(std::memory_order_relaxed));
+        T v;
+        memcpy(&v, buf, sizeof(T));
+        return v;
+    }
+
+    //写入新值
+    void store(const T& v) {
+        WriteLock lock(*this);
+        setNoLock(v);
+    }
+
+    //在写锁内读取、修改、写回
+    template<class Func>
+    void update(Func cb) {
+        WriteLock lock(*this);
+        T v = getNoLock();
+        cb(v);
+        setNoLock(v);
+    }
+
+    //上写锁
+    void wrlock() {
+        m_mutex.lock();
+        m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        //序号变为奇数要先于数据的修改被看到
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    //解锁
+    void unlock() {
+        m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        m_mutex.unlock();
+    }
+
+    //持有写锁时读取
+    T getNoLock() const {
+        T v;
+        memcpy(&v, m_words, sizeof(T));
+        return v;
+    }
+    //持有写锁时写入
+    void setNoLock(const T& v) {
+        uint64_t buf[WORDS] = {0};
+        memcpy(buf, &v, sizeof(T));
+        for(size_t i = 0; i < WORDS; ++i) {
+            __atomic_store_n(&m_words[i], buf[i], __ATOMIC_RELAXED);
+        }
+    }
+private:
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+private:
+    // 序号,奇数表示正在写
+    std::atomic<uint32_t> m_seq{0};
+    // 数据
+    uint64_t m_words[WORDS];
+    // 写者之间互斥
+    FutexMutex m_mutex;
+};
+
+/**
+ * @brief 线程创建参数
+ */
+struct ThreadOptions {
+    //绑定的CPU,为空时不绑定;设置了numaNode时绑定到该节点的CPU
+    std::vector<int> cpus;
+    //栈大小,0使用系统默认
+    size_t stackSize = 0;
+    //调度策略SCHED_OTHER/SCHED_FIFO/SCHED_RR,实时策略没有权限时退回默认策略
+    int policy = SCHED_OTHER;
+    //实时策略的优先级
+    int priority = 0;
+    //内存优先从这个NUMA节点分配,-1不设置
+    int numaNode = -1;
 };
 
 class Thread {
 
 public:
     typedef std::shared_ptr<Thread> ptr;
-    Thread(std::function<void()> cb, const std::string& name);
+    /**
+     * @param[in] cb 线程执行的函数
+     * @param[in] name 线程名称
+     * @param[in] opts CPU绑定、栈大小、调度策略和NUMA节点
+     */
+    Thread(std::function<void()> cb, const std::string& name
+           ,const ThreadOptions& opts = ThreadOptions());
+    /**
+     * @brief 创建线程但不等待它就绪
+     * @param[in] ready 线程设置好id和名称后减一,由调用方统一等待,
+     *            等待之前不能调用getId
+     */
+    Thread(std::function<void()> cb, const std::string& name
+           ,const ThreadOptions& opts, Latch& ready);
     ~Thread();
 
+    /**
+     * @brief 批量创建线程,只等待一次所有线程就绪
+     * @param[in] count 线程数
+     * @param[in] cb 线程执行的函数,参数是线程的下标
+     * @param[in] name 线程名前缀,线程名为name_下标
+     * @param[in] opts 所有线程共用的参数
+     * @return 创建好的线程,有线程创建失败时抛出异常,已创建的线程照常运行
+     */
+    static std::vector<Thread::ptr> CreateBatch(size_t count, std::function<void(size_t)> cb
+                                                ,const std::string& name
+                                                ,const ThreadOptions& opts = ThreadOptions());
+
     pid_t getId() const { return m_id; }
     const std::string& getName() const { return m_name; }
     //实现pthread_jion()（等待线程结束，线程间同步的操作）的功能，并提供日志提示
@@ -275,14 +683,17 @@ private:
     Thread(const Thread&&) = delete;
     Thread& operator=(const Thread&) = delete;
 
+    void start(const ThreadOptions& opts);
     static void* run(void* arg);
 private:
     pid_t m_id = -1;
     pthread_t m_thread = 0;
     std::function<void()> m_cb;
     std::string m_name;
-
-    Semaphore m_semaphore;
+    // 线程内设置的NUMA节点
+    int m_numaNode = -1;
+    // 线程就绪后减一,之后线程不再访问
+    Latch* m_ready = nullptr;
 
 };
 
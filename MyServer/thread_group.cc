@@ -0,0 +1,234 @@
+#include "thread_group.h"
+#include "config.h"
+#include "log.h"
+#include <sstream>
+#include <unistd.h>
+
+namespace MyServer {
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_NAME("system");
+
+//线程组配置
+struct ThreadGroupDefine {
+    std::vector<int> cpus;
+    uint32_t count = 0;
+    bool pin = true;
+    uint64_t stack_size = 0;
+    int policy = SCHED_OTHER;
+    int priority = 0;
+    int numa_node = -1;
+
+    bool operator==(const ThreadGroupDefine& oth) const {
+        return cpus == oth.cpus
+            && count == oth.count
+            && pin == oth.pin
+            && stack_size == oth.stack_size
+            && policy == oth.policy
+            && priority == oth.priority
+            && numa_node == oth.numa_node;
+    }
+};
+
+static int PolicyFromString(const std::string& v) {
+    if(v == "fifo") {
+        return SCHED_FIFO;
+    } else if(v == "rr") {
+        return SCHED_RR;
+    } else if(v == "batch") {
+        return SCHED_BATCH;
+    } else if(v == "idle") {
+        return SCHED_IDLE;
+    }
+    return SCHED_OTHER;
+}
+
+static std::string PolicyToString(int v) {
+    switch(v) {
+        case SCHED_FIFO: return "fifo";
+        case SCHED_RR: return "rr";
+        case SCHED_BATCH: return "batch";
+        case SCHED_IDLE: return "idle";
+        default: return "other";
+    }
+}
+
+template<>
+class LexicalCast<std::string, ThreadGroupDefine> {
+public:
+    ThreadGroupDefine operator()(const std::string& v) {
+        YAML::Node n = YAML::Load(v);
+        ThreadGroupDefine td;
+        //cpus可以是列表[0-3, 8]也可以是字符串"0-3,8"
+        if(n["cpus"].IsDefined()) {
+            std::string list;
+            if(n["cpus"].IsSequence()) {
+                for(size_t i = 0; i < n["cpus"].size(); ++i) {
+                    list += (i ? "," : "") + n["cpus"][i].as<std::string>();
+                }
+            } else {
+                list = n["cpus"].as<std::string>();
+            }
+            if(!ParseCpuList(list, td.cpus)) {
+                throw std::invalid_argument("threads cpus invalid: " + list);
+            }
+        }
+        if(n["count"].IsDefined()) {
+            td.count = n["count"].as<uint32_t>();
+        }
+        if(n["pin"].IsDefined()) {
+            td.pin = n["pin"].as<bool>();
+        }
+        if(n["stack_size"].IsDefined()) {
+            td.stack_size = n["stack_size"].as<uint64_t>();
+        }
+        if(n["policy"].IsDefined()) {
+            td.policy = PolicyFromString(n["policy"].as<std::string>());
+        }
+        if(n["priority"].IsDefined()) {
+            td.priority = n["priority"].as<int>();
+        }
+        if(n["numa_node"].IsDefined()) {
+            td.numa_node = n["numa_node"].as<int>();
+        }
+        return td;
+    }
+};
+
+template<>
+class LexicalCast<ThreadGroupDefine, std::string> {
+public:
+    std::string operator()(const ThreadGroupDefine& i) {
+        YAML::Node n;
+        for(auto c : i.cpus) {
+            n["cpus"].push_back(c);
+        }
+        n["count"] = i.count;
+        n["pin"] = i.pin;
+        n["stack_size"] = i.stack_size;
+        n["policy"] = PolicyToString(i.policy);
+        n["priority"] = i.priority;
+        n["numa_node"] = i.numa_node;
+        std::stringstream ss;
+        ss << n;
+        return ss.str();
+    }
+};
+
+static ConfigVar<std::map<std::string, ThreadGroupDefine> >::ptr g_thread_groups =
+    Config::Lookup("threads", std::map<std::string, ThreadGroupDefine>(), "thread groups config");
+
+ThreadGroup::ThreadGroup(const std::string& name, const ThreadOptions& opts
+                         ,size_t count, bool pin)
+    :m_name(name)
+    ,m_opts(opts)
+    ,m_count(count)
+    ,m_pin(pin) {
+    if(m_opts.cpus.empty() && m_opts.numaNode >= 0) {
+        m_opts.cpus = GetNumaNodeCpus(m_opts.numaNode);
+    }
+    if(m_count == 0) {
+        m_count = m_opts.cpus.empty() ? sysconf(_SC_NPROCESSORS_ONLN) : m_opts.cpus.size();
+    }
+    if(m_count == 0) {
+        m_count = 1;
+    }
+    m_threads.resize(m_count);
+}
+
+ThreadGroup::~ThreadGroup() {
+    //预先创建的线程还在等待m_go,放行让它们退出
+    if(m_prepared) {
+        start(nullptr);
+        join();
+    }
+}
+
+ThreadGroup::ptr ThreadGroup::Create(const std::string& name) {
+    auto groups = g_thread_groups->getValue();
+    auto it = groups.find(name);
+    if(it == groups.end()) {
+        return ThreadGroup::ptr(new ThreadGroup(name, ThreadOptions()));
+    }
+    const ThreadGroupDefine& td = it->second;
+    ThreadOptions opts;
+    opts.cpus = td.cpus;
+    opts.stackSize = td.stack_size;
+    opts.policy = td.policy;
+    opts.priority = td.priority;
+    opts.numaNode = td.numa_node;
+    return ThreadGroup::ptr(new ThreadGroup(name, opts, td.count, td.pin));
+}
+
+ThreadOptions ThreadGroup::getOptions(size_t index) const {
+    ThreadOptions opts = m_opts;
+    if(m_pin && !opts.cpus.empty()) {
+        opts.cpus.assign(1, m_opts.cpus[index % m_opts.cpus.size()]);
+    }
+    return opts;
+}
+
+void ThreadGroup::prepare() {
+    if(m_started) {
+        MYSERVER_LOG_ERROR(g_logger) << "ThreadGroup::prepare already started name=" << m_name;
+        return;
+    }
+    m_go.reset(1);
+    m_prepared = true;
+    try {
+        spawn([this](size_t i) {
+            m_go.wait();
+            if(m_cb) {
+                m_cb(i);
+            }
+        });
+    } catch(...) {
+        //已创建的线程还在等待,放行后回收
+        start(nullptr);
+        join();
+        throw;
+    }
+}
+
+void ThreadGroup::start(std::function<void(size_t index)> cb) {
+    if(m_prepared) {
+        m_cb = cb;
+        m_prepared = false;
+        //所有线程在同一个门闩上等待,放行只需要一次唤醒
+        m_go.countDown();
+        return;
+    }
+    if(m_started) {
+        MYSERVER_LOG_ERROR(g_logger) << "ThreadGroup::start already started name=" << m_name;
+        return;
+    }
+    spawn(cb);
+}
+
+void ThreadGroup::spawn(std::function<void(size_t index)> cb) {
+    m_started = true;
+    Latch ready(m_count);
+    size_t i = 0;
+    try {
+        for(; i < m_count; ++i) {
+            m_threads[i].reset(new Thread(std::bind(cb, i)
+                        ,m_name + "_" + std::to_string(i), getOptions(i), ready));
+        }
+    } catch(...) {
+        ready.countDown(m_count - i);
+        ready.wait();
+        throw;
+    }
+    ready.wait();
+}
+
+void ThreadGroup::join() {
+    for(auto& i : m_threads) {
+        if(i) {
+            i->join();
+            i.reset();
+        }
+    }
+    m_started = false;
+}
+
+}
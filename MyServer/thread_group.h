@@ -0,0 +1,91 @@
+#ifndef __MYSERVER_THREAD_GROUP_H__
+#define __MYSERVER_THREAD_GROUP_H__
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include "thread.h"
+
+namespace MyServer {
+
+/**
+ * @brief 一组参数相同的线程
+ * @details 绑定CPU时每个线程固定在cpus中的一个CPU上(按下标轮流分配),
+ *          也可以让所有线程共享cpus
+ *          可以从配置创建,配置项为threads.<name>:
+ *          threads:
+ *              worker:
+ *                  cpus: [0-15]        #CPU列表,格式同/sys下的cpulist
+ *                  count: 0            #线程数,0时每个CPU一个,没有配置cpus时等于CPU数
+ *                  pin: true           #每个线程绑定一个CPU,false时共享cpus
+ *                  stack_size: 0       #栈大小,0使用默认
+ *                  policy: other       #other/fifo/rr
+ *                  priority: 0
+ *                  numa_node: -1       #内存优先分配的节点,没有配置cpus时绑定到该节点的CPU
+ *          所有线程一起创建,只等待一次全部就绪;也可以先prepare预先创建好线程,
+ *          start时只是放行,重启线程池时不用再付创建线程的开销
+ */
+class ThreadGroup {
+public:
+    typedef std::shared_ptr<ThreadGroup> ptr;
+
+    /**
+     * @param[in] name 名称,线程名为name_下标
+     * @param[in] opts 线程参数
+     * @param[in] count 线程数,0时opts.cpus非空则每个CPU一个线程,否则等于CPU数
+     * @param[in] pin true每个线程绑定opts.cpus中的一个CPU,false所有线程共享opts.cpus
+     */
+    ThreadGroup(const std::string& name, const ThreadOptions& opts
+                ,size_t count = 0, bool pin = true);
+    ~ThreadGroup();
+
+    /**
+     * @brief 按配置threads.<name>创建,没有配置时使用默认参数
+     */
+    static ThreadGroup::ptr Create(const std::string& name);
+
+    /**
+     * @brief 预先创建所有线程,线程就绪后等待start
+     * @details 返回时所有线程都已就绪;prepare之后必须调用start,否则join会一直等待
+     */
+    void prepare();
+
+    /**
+     * @brief 启动所有线程
+     * @details 已经prepare过时只唤醒等待中的线程,否则一起创建所有线程
+     * @param[in] cb 线程执行的函数,参数是线程在组内的下标
+     */
+    void start(std::function<void(size_t index)> cb);
+
+    //等待所有线程结束,之后可以再次prepare或start
+    void join();
+
+    const std::string& getName() const { return m_name;}
+    //线程数
+    size_t size() const { return m_count;}
+    //第index个线程的参数
+    ThreadOptions getOptions(size_t index) const;
+    //第index个线程,start之前为空
+    Thread::ptr getThread(size_t index) const { return m_threads[index];}
+private:
+    //一起创建所有线程,等待全部就绪
+    void spawn(std::function<void(size_t index)> cb);
+private:
+    std::string m_name;
+    ThreadOptions m_opts;
+    size_t m_count;
+    bool m_pin;
+    std::vector<Thread::ptr> m_threads;
+    // prepare创建的线程等待start放行
+    Latch m_go;
+    // 线程执行的函数,m_go放行之后才会被读取
+    std::function<void(size_t index)> m_cb;
+    // 是否已经prepare或start
+    bool m_started = false;
+    // 是否由prepare创建了线程
+    bool m_prepared = false;
+};
+
+}
+
+#endif
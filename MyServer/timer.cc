@@ -0,0 +1,367 @@
+#include "timer.h"
+#include "util.h"
+#include <string.h>
+
+namespace MyServer {
+
+//第level层(从1开始)每个槽的时间跨度是 1 << LevelShift(level)
+static inline uint32_t LevelShift(uint32_t level) {
+    return 8 + (level - 1) * 6;
+}
+
+//循环位图中从start开始第一个置位的偏移,没有返回-1
+static inline int FindNextBit64(uint64_t bitmap, uint32_t start) {
+    start &= 63;
+    if(!bitmap) {
+        return -1;
+    }
+    uint64_t rotated = start ? (bitmap >> start) | (bitmap << (64 - start)) : bitmap;
+    return __builtin_ctzll(rotated);
+}
+
+Timer::Timer(uint64_t ms, std::function<void()> cb, bool recurring, TimerManager* manager)
+    :m_recurring(recurring)
+    ,m_ms(ms)
+    ,m_cb(cb)
+    ,m_manager(manager) {
+}
+
+bool Timer::cancel() {
+    TimerManager* manager = m_manager;
+    if(!manager) {
+        return false;
+    }
+    //在锁外释放自引用
+    Timer::ptr self;
+    {
+        TimerManager::MutexType::Lock lock(manager->m_mutex);
+        if(m_level < 0) {
+            return false;
+        }
+        manager->removeNoLock(this);
+        m_cb = nullptr;
+        self.swap(m_self);
+    }
+    return true;
+}
+
+bool Timer::refresh() {
+    TimerManager* manager = m_manager;
+    if(!manager) {
+        return false;
+    }
+    TimerManager::MutexType::Lock lock(manager->m_mutex);
+    if(m_level < 0) {
+        return false;
+    }
+    manager->removeNoLock(this);
+    m_next = MyServer::GetCurrentMS() + m_ms;
+    //只会更晚到期,不需要唤醒
+    manager->addTimerNoLock(this);
+    return true;
+}
+
+bool Timer::reset(uint64_t ms, bool from_now) {
+    TimerManager* manager = m_manager;
+    if(!manager) {
+        return false;
+    }
+    bool at_front = false;
+    {
+        TimerManager::MutexType::Lock lock(manager->m_mutex);
+        if(m_level < 0) {
+            return false;
+        }
+        //m_ms在锁内修改,比较也要在锁内
+        if(ms == m_ms && !from_now) {
+            return true;
+        }
+        manager->removeNoLock(this);
+        uint64_t start = from_now ? MyServer::GetCurrentMS() : m_next - m_ms;
+        m_ms = ms;
+        m_next = start + m_ms;
+        at_front = manager->addTimerNoLock(this);
+    }
+    if(at_front) {
+        manager->onTimerInsertedAtFront();
+    }
+    return true;
+}
+
+TimerManager::TimerManager() {
+    m_current = MyServer::GetCurrentMS();
+    memset(m_rootBitmap, 0, sizeof(m_rootBitmap));
+    memset(m_levelBitmap, 0, sizeof(m_levelBitmap));
+}
+
+TimerManager::~TimerManager() {
+    //解除所有定时器的自引用,外部还持有的定时器cancel时返回false
+    std::vector<Timer::ptr> timers;
+    {
+        MutexType::Lock lock(m_mutex);
+        for(int level = 0; level <= (int)LEVELS; ++level) {
+            uint32_t size = level ? LEVEL_SIZE : ROOT_SIZE;
+            for(uint32_t i = 0; i < size; ++i) {
+                Slot& slot = getSlot(level, i);
+                for(Timer* t = slot.head; t; t = t->m_nextNode) {
+                    t->m_level = -1;
+                    t->m_manager = nullptr;
+                    timers.push_back(std::move(t->m_self));
+                }
+                slot.head = nullptr;
+            }
+        }
+        m_count = 0;
+    }
+}
+
+TimerManager::Slot& TimerManager::getSlot(int level, uint32_t index) {
+    return level ? m_levels[level - 1][index] : m_root[index];
+}
+
+Timer::ptr TimerManager::addTimer(uint64_t ms, std::function<void()> cb, bool recurring) {
+    Timer::ptr timer(new Timer(ms, cb, recurring, this));
+    return insertTimer(timer);
+}
+
+Timer::ptr TimerManager::addConditionTimer(uint64_t ms, std::function<void()> cb
+                                           ,std::weak_ptr<void> weak_cond, bool recurring) {
+    //回调期间持有条件对象
+    Timer::ptr timer(new Timer(ms, [weak_cond, cb]() {
+        std::shared_ptr<void> tmp = weak_cond.lock();
+        if(tmp) {
+            cb();
+        }
+    }, recurring, this));
+    timer->m_hasCond = true;
+    timer->m_cond = weak_cond;
+    return insertTimer(timer);
+}
+
+Timer::ptr TimerManager::insertTimer(Timer::ptr timer) {
+    timer->m_next = MyServer::GetCurrentMS() + timer->m_ms;
+    bool at_front = false;
+    {
+        MutexType::Lock lock(m_mutex);
+        timer->m_self = timer;
+        at_front = addTimerNoLock(timer.get());
+    }
+    if(at_front) {
+        onTimerInsertedAtFront();
+    }
+    return timer;
+}
+
+bool TimerManager::addTimerNoLock(Timer* timer) {
+    place(timer);
+    ++m_count;
+    if(timer->m_next < m_wakeAt) {
+        //只通知一次,直到下一次getNextTimer
+        m_wakeAt = timer->m_next;
+        return true;
+    }
+    return false;
+}
+
+void TimerManager::place(Timer* timer) {
+    //已经过期的放进当前槽,下一次推进时触发
+    uint64_t expire = timer->m_next > m_current ? timer->m_next : m_current;
+    uint64_t delta = expire - m_current;
+    int level = 0;
+    uint32_t index = 0;
+    if(delta < ROOT_SIZE) {
+        index = expire & (ROOT_SIZE - 1);
+        m_rootBitmap[index >> 6] |= 1ull << (index & 63);
+    } else {
+        //超出时间轮范围的先放在最高层,cascade时按真实的到期时间重新放置
+        if(delta >= (1ull << LevelShift(LEVELS + 1))) {
+            expire = m_current + (1ull << LevelShift(LEVELS + 1)) - 1;
+            delta = expire - m_current;
+        }
+        for(level = 1; level < (int)LEVELS; ++level) {
+            if(delta < (1ull << LevelShift(level + 1))) {
+                break;
+            }
+        }
+        index = (expire >> LevelShift(level)) & (LEVEL_SIZE - 1);
+        m_levelBitmap[level - 1] |= 1ull << index;
+    }
+
+    Slot& slot = getSlot(level, index);
+    timer->m_level = level;
+    timer->m_index = index;
+    timer->m_prevNode = nullptr;
+    timer->m_nextNode = slot.head;
+    if(slot.head) {
+        slot.head->m_prevNode = timer;
+    }
+    slot.head = timer;
+}
+
+void TimerManager::removeNoLock(Timer* timer) {
+    Slot& slot = getSlot(timer->m_level, timer->m_index);
+    if(timer->m_prevNode) {
+        timer->m_prevNode->m_nextNode = timer->m_nextNode;
+    } else {
+        slot.head = timer->m_nextNode;
+    }
+    if(timer->m_nextNode) {
+        timer->m_nextNode->m_prevNode = timer->m_prevNode;
+    }
+    if(!slot.head) {
+        if(timer->m_level == 0) {
+            m_rootBitmap[timer->m_index >> 6] &= ~(1ull << (timer->m_index & 63));
+        } else {
+            m_levelBitmap[timer->m_level - 1] &= ~(1ull << timer->m_index);
+        }
+    }
+    timer->m_level = -1;
+    timer->m_prevNode = timer->m_nextNode = nullptr;
+    --m_count;
+}
+
+void TimerManager::cascade(uint32_t level, uint32_t index) {
+    Slot& slot = getSlot(level, index);
+    Timer* t = slot.head;
+    slot.head = nullptr;
+    m_levelBitmap[level - 1] &= ~(1ull << index);
+    while(t) {
+        Timer* next = t->m_nextNode;
+        place(t);
+        t = next;
+    }
+}
+
+void TimerManager::tick(std::vector<Timer*>& expired) {
+    uint32_t index = m_current & (ROOT_SIZE - 1);
+    //第0层转完一圈,从上一层取下一个槽,上一层也转完一圈时继续往上
+    if(index == 0) {
+        for(uint32_t level = 1; level <= LEVELS; ++level) {
+            uint32_t li = (m_current >> LevelShift(level)) & (LEVEL_SIZE - 1);
+            cascade(level, li);
+            if(li) {
+                break;
+            }
+        }
+    }
+
+    Slot& slot = m_root[index];
+    for(Timer* t = slot.head; t; t = t->m_nextNode) {
+        t->m_level = -1;
+        expired.push_back(t);
+        --m_count;
+    }
+    slot.head = nullptr;
+    m_rootBitmap[index >> 6] &= ~(1ull << (index & 63));
+    ++m_current;
+}
+
+uint64_t TimerManager::nextExpireNoLock() const {
+    if(m_count == 0) {
+        return ~0ull;
+    }
+    uint64_t next = ~0ull;
+    //第0层的槽和到期时间一一对应,是准确值
+    uint32_t start = m_current & (ROOT_SIZE - 1);
+    for(uint32_t i = 0; i <= ROOT_SIZE / 64; ++i) {
+        uint32_t word = ((start >> 6) + i) & (ROOT_SIZE / 64 - 1);
+        uint64_t bits = m_rootBitmap[word];
+        if(i == 0) {
+            bits &= ~0ull << (start & 63);
+        } else if(i == ROOT_SIZE / 64) {
+            bits &= (start & 63) ? (1ull << (start & 63)) - 1 : 0;
+        }
+        if(bits) {
+            uint32_t index = (word << 6) + __builtin_ctzll(bits);
+            next = m_current + ((index - start) & (ROOT_SIZE - 1));
+            break;
+        }
+    }
+    //高层的槽取开始cascade的时间
+    //m_current正好在槽的边界上时,当前槽还没有cascade,从当前槽开始找
+    for(uint32_t level = 1; level <= LEVELS; ++level) {
+        uint32_t shift = LevelShift(level);
+        uint64_t first = m_current >> shift;
+        if(m_current & ((1ull << shift) - 1)) {
+            ++first;
+        }
+        int off = FindNextBit64(m_levelBitmap[level - 1], first & (LEVEL_SIZE - 1));
+        if(off >= 0) {
+            uint64_t t = (first + off) << shift;
+            if(t < next) {
+                next = t;
+            }
+        }
+    }
+    return next;
+}
+
+uint64_t TimerManager::getNextTimer() {
+    MutexType::Lock lock(m_mutex);
+    uint64_t next = nextExpireNoLock();
+    m_wakeAt = next;
+    if(next == ~0ull) {
+        return ~0ull;
+    }
+    uint64_t now = MyServer::GetCurrentMS();
+    return next > now ? next - now : 0;
+}
+
+void TimerManager::listExpiredCb(std::vector<std::function<void()> >& cbs) {
+    uint64_t now = MyServer::GetCurrentMS();
+    std::vector<Timer*> expired;
+    //不再使用的定时器在锁外释放
+    std::vector<Timer::ptr> released;
+    {
+        MutexType::Lock lock(m_mutex);
+        while(m_current <= now) {
+            if(m_count == 0) {
+                m_current = now + 1;
+                break;
+            }
+            //第0层为空时直接跳到下一个需要cascade的时间
+            bool root_empty = true;
+            for(uint32_t i = 0; i < ROOT_SIZE / 64; ++i) {
+                if(m_rootBitmap[i]) {
+                    root_empty = false;
+                    break;
+                }
+            }
+            if(root_empty) {
+                uint64_t next = nextExpireNoLock();
+                if(next > now) {
+                    m_current = now + 1;
+                    break;
+                }
+                if(next > m_current) {
+                    m_current = next;
+                }
+            }
+            tick(expired);
+        }
+        if(expired.empty()) {
+            return;
+        }
+
+        cbs.reserve(cbs.size() + expired.size());
+        for(auto t : expired) {
+            if(t->m_hasCond && t->m_cond.expired()) {
+                t->m_cb = nullptr;
+                released.push_back(std::move(t->m_self));
+                continue;
+            }
+            if(t->m_recurring) {
+                cbs.push_back(t->m_cb);
+                t->m_next = now + t->m_ms;
+                place(t);
+                ++m_count;
+            } else {
+                cbs.push_back(std::move(t->m_cb));
+                t->m_cb = nullptr;
+                released.push_back(std::move(t->m_self));
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,161 @@
+#ifndef __MYSERVER_TIMER_H__
+#define __MYSERVER_TIMER_H__
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include "thread.h"
+
+namespace MyServer {
+
+class TimerManager;
+
+/**
+ * @brief 定时器
+ * @details 由TimerManager::addTimer创建,在时间轮中期间持有自己的引用,
+ *          调用方不保存返回的指针定时器也会照常触发
+ */
+class Timer : public std::enable_shared_from_this<Timer> {
+friend class TimerManager;
+public:
+    typedef std::shared_ptr<Timer> ptr;
+
+    //取消定时器,已经触发或已经取消返回false
+    bool cancel();
+    //从现在开始重新计时
+    bool refresh();
+    /**
+     * @brief 修改定时器的周期
+     * @param[in] ms 新的周期
+     * @param[in] from_now true从现在开始计时,false从上次开始计时的时间算起
+     */
+    bool reset(uint64_t ms, bool from_now);
+
+    uint64_t getPeriod() const { return m_ms;}
+    bool isRecurring() const { return m_recurring;}
+private:
+    Timer(uint64_t ms, std::function<void()> cb, bool recurring, TimerManager* manager);
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+private:
+    //是否循环
+    bool m_recurring = false;
+    //是否是条件定时器
+    bool m_hasCond = false;
+    //周期
+    uint64_t m_ms = 0;
+    //到期时间(单调时钟毫秒)
+    uint64_t m_next = 0;
+    std::function<void()> m_cb;
+    //条件定时器的条件,对象销毁后定时器不再触发
+    std::weak_ptr<void> m_cond;
+    TimerManager* m_manager = nullptr;
+    //所在的层(0是第0层),-1表示不在时间轮中
+    int m_level = -1;
+    //所在的槽
+    uint32_t m_index = 0;
+    //时间轮槽内的双向链表
+    Timer* m_prevNode = nullptr;
+    Timer* m_nextNode = nullptr;
+    //在时间轮中时持有自己
+    Timer::ptr m_self;
+};
+
+/**
+ * @brief 定时器管理
+ * @details 分层时间轮,精度1毫秒: 第0层256个槽,每槽1ms;第1~4层各64个槽,
+ *          每槽分别是256ms, 16s, 17min, 18h,最长约49天,更长的按49天处理后重新计算
+ *          每个槽是侵入式双向链表,添加、取消、刷新都是O(1)
+ *          时间推进到高层槽的边界时把该槽的定时器重新分配到低层(cascade)
+ *          每层用位图记录非空的槽,下一个超时时间只需要找位图中的下一个置位
+ */
+class TimerManager {
+friend class Timer;
+public:
+    typedef Mutex MutexType;
+
+    TimerManager();
+    virtual ~TimerManager();
+
+    /**
+     * @brief 添加定时器
+     * @param[in] ms 超时时间(毫秒)
+     * @param[in] cb 回调
+     * @param[in] recurring 是否循环
+     */
+    Timer::ptr addTimer(uint64_t ms, std::function<void()> cb, bool recurring = false);
+
+    /**
+     * @brief 添加条件定时器
+     * @param[in] weak_cond 条件对象,销毁后定时器不再触发,循环定时器也随之移除
+     */
+    Timer::ptr addConditionTimer(uint64_t ms, std::function<void()> cb
+                                 ,std::weak_ptr<void> weak_cond, bool recurring = false);
+
+    /**
+     * @brief 距离下一个定时器到期的毫秒数,可以直接作为epoll_wait的超时
+     * @details 下一个定时器在高层槽中时返回该槽开始cascade的时间,不会晚于真正的到期时间
+     * @return 没有定时器返回~0ull
+     */
+    uint64_t getNextTimer();
+
+    /**
+     * @brief 推进时间轮,取出所有已经到期的回调
+     */
+    void listExpiredCb(std::vector<std::function<void()> >& cbs);
+
+    //是否有定时器
+    bool hasTimer() const { return m_count > 0;}
+    //定时器数量
+    size_t getTimerCount() const { return m_count;}
+protected:
+    /**
+     * @brief 新的定时器比上一次getNextTimer返回的时间更早到期
+     * @details 用于唤醒正在按旧的超时时间等待的线程,在锁外调用
+     */
+    virtual void onTimerInsertedAtFront() = 0;
+private:
+    static const uint32_t ROOT_BITS = 8;
+    static const uint32_t ROOT_SIZE = 1 << ROOT_BITS;
+    static const uint32_t LEVEL_BITS = 6;
+    static const uint32_t LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const uint32_t LEVELS = 4;
+
+    //槽的链表头
+    struct Slot {
+        Timer* head = nullptr;
+    };
+
+    //设置自引用并放进时间轮
+    Timer::ptr insertTimer(Timer::ptr timer);
+    //把定时器放进时间轮,返回是否需要onTimerInsertedAtFront
+    bool addTimerNoLock(Timer* timer);
+    //按到期时间放进对应的槽
+    void place(Timer* timer);
+    void removeNoLock(Timer* timer);
+    //推进一个tick,到期的定时器放进expired
+    void tick(std::vector<Timer*>& expired);
+    //把高层的一个槽重新分配到低层
+    void cascade(uint32_t level, uint32_t index);
+    //下一个可能有定时器到期的时间
+    uint64_t nextExpireNoLock() const;
+
+    Slot& getSlot(int level, uint32_t index);
+private:
+    MutexType m_mutex;
+    //时间轮当前时间,小于它的都已经处理过
+    uint64_t m_current;
+    //上一次getNextTimer告诉调用方的唤醒时间
+    uint64_t m_wakeAt = ~0ull;
+    std::atomic<size_t> m_count{0};
+
+    Slot m_root[ROOT_SIZE];
+    uint64_t m_rootBitmap[ROOT_SIZE / 64];
+    Slot m_levels[LEVELS][LEVEL_SIZE];
+    uint64_t m_levelBitmap[LEVELS];
+};
+
+}
+
+#endif
@@ -1,5 +1,15 @@
 #include "util.h"
+#include "fiber.h"
+#include "thread.h"
 #include <sys/syscall.h>
+#include <time.h>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <stdlib.h>
+#include <string.h>
+#include <charconv>
 
 namespace MyServer {
 
@@ -7,9 +17,220 @@ pid_t GetThreadId() {
     return syscall(SYS_gettid);
 }
 uint32_t GetFiberId() {
-    return 0;
+    return MyServer::Fiber::GetFiberId();
 }
 
+uint64_t GetCurrentMS() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ul + ts.tv_nsec / 1000000;
+}
+
+uint64_t GetCurrentUS() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ul + ts.tv_nsec / 1000;
+}
+
+static std::atomic<uint32_t> s_thread_slot{0};
+
+//已退出线程归还的槽位,线程可能在静态对象析构之后退出,所以不释放
+static Spinlock& GetFreeSlotMutex() {
+    static Spinlock* s_mutex = new Spinlock;
+    return *s_mutex;
+}
+
+static std::vector<uint32_t>& GetFreeSlots() {
+    static std::vector<uint32_t>* s_slots = new std::vector<uint32_t>;
+    return *s_slots;
+}
+
+//槽位归还之后本线程的其它thread_local析构仍可能取槽位
+static thread_local bool t_thread_slot_dead = false;
+//归还之后取到的槽位,新分配且不再归还,不会和复用了旧编号的线程冲突
+static thread_local uint32_t t_late_thread_slot = (uint32_t)-1;
+
+//线程退出时归还槽位,活着的线程编号保持紧凑
+struct ThreadSlot {
+    ThreadSlot() {
+        Spinlock::Lock lock(GetFreeSlotMutex());
+        std::vector<uint32_t>& slots = GetFreeSlots();
+        if(slots.empty()) {
+            id = s_thread_slot.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            //优先复用最小的编号
+            std::pop_heap(slots.begin(), slots.end(), std::greater<uint32_t>());
+            id = slots.back();
+            slots.pop_back();
+        }
+    }
+    ~ThreadSlot() {
+        Spinlock::Lock lock(GetFreeSlotMutex());
+        std::vector<uint32_t>& slots = GetFreeSlots();
+        slots.push_back(id);
+        std::push_heap(slots.begin(), slots.end(), std::greater<uint32_t>());
+        t_thread_slot_dead = true;
+    }
+    uint32_t id;
+};
+
+uint32_t GetThreadSlot() {
+    if(t_thread_slot_dead) {
+        if(t_late_thread_slot == (uint32_t)-1) {
+            t_late_thread_slot = s_thread_slot.fetch_add(1, std::memory_order_relaxed);
+        }
+        return t_late_thread_slot;
+    }
+    static thread_local ThreadSlot t_slot;
+    return t_slot.id;
+}
+
+bool ParseCpuList(const std::string& str, std::vector<int>& cpus) {
+    size_t pos = 0;
+    while(pos < str.size()) {
+        size_t end = str.find(',', pos);
+        if(end == std::string::npos) {
+            end = str.size();
+        }
+        std::string item = str.substr(pos, end - pos);
+        pos = end + 1;
+        size_t b = item.find_first_not_of(" \t\n");
+        if(b == std::string::npos) {
+            continue;
+        }
+        item = item.substr(b, item.find_last_not_of(" \t\n") - b + 1);
+
+        char* p = nullptr;
+        long first = strtol(item.c_str(), &p, 10);
+        long last = first;
+        if(p == item.c_str() || first < 0) {
+            return false;
+        }
+        if(*p == '-') {
+            const char* q = p + 1;
+            last = strtol(q, &p, 10);
+            if(p == q || last < first) {
+                return false;
+            }
+        }
+        if(*p != '\0') {
+            return false;
+        }
+        for(long i = first; i <= last; ++i) {
+            cpus.push_back(i);
+        }
+    }
+    return true;
+}
+
+std::vector<int> GetNumaNodeCpus(int node) {
+    std::vector<int> cpus;
+    std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string line;
+    if(ifs && std::getline(ifs, line)) {
+        if(!ParseCpuList(line, cpus)) {
+            cpus.clear();
+        }
+    }
+    return cpus;
+}
+
+//00到99的两位数字
+static const char s_digits[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+//十进制位数
+static inline size_t CountDigits(uint64_t v) {
+    size_t n = 1;
+    for(;;) {
+        if(v < 10) {
+            return n;
+        }
+        if(v < 100) {
+            return n + 1;
+        }
+        if(v < 1000) {
+            return n + 2;
+        }
+        if(v < 10000) {
+            return n + 3;
+        }
+        v /= 10000;
+        n += 4;
+    }
+}
 
+size_t UintToChars(uint64_t v, char* buf) {
+    size_t len = CountDigits(v);
+    char* p = buf + len;
+    while(v >= 100) {
+        size_t i = (v % 100) * 2;
+        v /= 100;
+        p -= 2;
+        memcpy(p, s_digits + i, 2);
+    }
+    if(v >= 10) {
+        memcpy(p - 2, s_digits + v * 2, 2);
+    } else {
+        p[-1] = '0' + v;
+    }
+    return len;
+}
+
+size_t IntToChars(int64_t v, char* buf) {
+    if(v < 0) {
+        buf[0] = '-';
+        return 1 + UintToChars(0 - (uint64_t)v, buf + 1);
+    }
+    return UintToChars(v, buf);
+}
+
+size_t DoubleToChars(double v, char* buf) {
+    return std::to_chars(buf, buf + 32, v).ptr - buf;
+}
+
+size_t FloatToChars(float v, char* buf) {
+    return std::to_chars(buf, buf + 32, v).ptr - buf;
+}
+
+//跳过前导的'+',from_chars不接受;"+-1"仍然是错误
+static inline bool SkipPlus(const char*& begin, const char* end) {
+    if(begin != end && *begin == '+') {
+        ++begin;
+        return begin != end && *begin != '-';
+    }
+    return true;
+}
+
+template<class T>
+static inline bool ParseNumber(const char* begin, const char* end, T& v) {
+    if(!SkipPlus(begin, end)) {
+        return false;
+    }
+    T tmp;
+    auto r = std::from_chars(begin, end, tmp);
+    if(r.ec != std::errc() || r.ptr != end) {
+        return false;
+    }
+    v = tmp;
+    return true;
+}
+
+bool ParseInt64(const char* begin, const char* end, int64_t& v) {
+    return ParseNumber(begin, end, v);
+}
+
+bool ParseUint64(const char* begin, const char* end, uint64_t& v) {
+    return ParseNumber(begin, end, v);
+}
 
-}
\ No newline at end of file
+bool ParseDouble(const char* begin, const char* end, double& v) {
+    return ParseNumber(begin, end, v);
+}
+
+bool ParseFloat(const char* begin, const char* end, float& v) {
+    return ParseNumber(begin, end, v);
+}
+
+}
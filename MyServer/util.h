@@ -7,12 +7,67 @@
 #include <sys/syscall.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 namespace MyServer{
 
 pid_t GetThreadId();
 uint32_t GetFiberId(); 
 
+//获取当前时间的毫秒(单调时钟,只用于计算时间间隔)
+uint64_t GetCurrentMS();
+//获取当前时间的微秒(单调时钟,只用于计算时间间隔)
+uint64_t GetCurrentUS();
+
+/**
+ * @brief 当前线程的槽位编号
+ * @details 线程第一次调用时分配,从0开始,同时活着的线程之间不重复;
+ *          线程退出后编号归还,之后的线程优先复用最小的编号,编号总是小于同时存在过的最大线程数
+ *          之后的调用不需要系统调用和加锁
+ *          用于按线程分散的计数器,取模后映射到固定数量的槽
+ */
+uint32_t GetThreadSlot();
+
+/**
+ * @brief 解析CPU列表
+ * @param[in] str 格式与/sys下的cpulist相同,如 "0-3,8,10-11"
+ * @param[out] cpus 解析出的CPU编号,追加在后面
+ * @return 格式错误返回false
+ */
+bool ParseCpuList(const std::string& str, std::vector<int>& cpus);
+
+//NUMA节点上的CPU,节点不存在时返回空
+std::vector<int> GetNumaNodeCpus(int node);
+
+/**
+ * @brief 无符号整数转成十进制文本
+ * @details 查表每次输出两位数字,不经过iostream和locale
+ * @param[out] buf 至少20字节,不写结尾的'\0'
+ * @return 写入的字符数
+ */
+size_t UintToChars(uint64_t v, char* buf);
+//有符号整数转成十进制文本,buf至少20字节,返回写入的字符数
+size_t IntToChars(int64_t v, char* buf);
+/**
+ * @brief 浮点数转成能原样解析回来的最短文本
+ * @details 如0.1输出"0.1"而不是"0.10000000000000001",很大或很小的数用科学计数法
+ * @param[out] buf 至少32字节,不写结尾的'\0'
+ * @return 写入的字符数
+ */
+size_t DoubleToChars(double v, char* buf);
+size_t FloatToChars(float v, char* buf);
+
+/**
+ * @brief 解析[begin, end)中的十进制数
+ * @details 与std::from_chars相同,不跳过空白,另外接受一个前导的'+';
+ *          必须用完整个区间,格式错误或溢出时返回false,v不变
+ */
+bool ParseInt64(const char* begin, const char* end, int64_t& v);
+bool ParseUint64(const char* begin, const char* end, uint64_t& v);
+bool ParseDouble(const char* begin, const char* end, double& v);
+bool ParseFloat(const char* begin, const char* end, float& v);
+
 
 }
 
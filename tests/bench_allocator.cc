@@ -0,0 +1,139 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/allocator.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <stdlib.h>
+#include <sched.h>
+
+//分配器性能测试: 对比glibc malloc/free和SlabAllocator,
+//包括单线程混合大小、多线程各自分配释放、跨线程释放和字符串拼接,结果以JSON输出
+//用法: bench_allocator [ops] [max_threads]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Glibc {
+    static void* alloc(size_t size) { return malloc(size);}
+    static void free(void* p, size_t) { ::free(p);}
+};
+
+struct Slab {
+    static void* alloc(size_t size) { return MyServer::SlabAllocator::Allocate(size);}
+    static void free(void* p, size_t size) { MyServer::SlabAllocator::Deallocate(p, size);}
+};
+
+//日志和配置中常见的大小,保持256个对象存活,随机替换
+static size_t s_sizes[] = {16, 24, 32, 48, 64, 96, 128, 200, 256, 512};
+
+template<class Alloc>
+static void run_mixed(size_t ops, uint32_t seed) {
+    void* objs[256] = {nullptr};
+    size_t sizes[256] = {0};
+    for(size_t i = 0; i < ops; ++i) {
+        seed = seed * 1103515245 + 12345;
+        size_t k = (seed >> 8) & 255;
+        if(objs[k]) {
+            Alloc::free(objs[k], sizes[k]);
+        }
+        sizes[k] = s_sizes[(seed >> 16) % 10];
+        objs[k] = Alloc::alloc(sizes[k]);
+        *(char*)objs[k] = 1;
+    }
+    for(size_t k = 0; k < 256; ++k) {
+        if(objs[k]) {
+            Alloc::free(objs[k], sizes[k]);
+        }
+    }
+}
+
+template<class Alloc>
+static void bench_mixed(std::ostream& os, const char* name, size_t threads, size_t ops) {
+    std::atomic<bool> go{false};
+    auto thrs = MyServer::Thread::CreateBatch(threads, [&](size_t i) {
+        while(!go.load(std::memory_order_acquire)) {
+            sched_yield();
+        }
+        run_mixed<Alloc>(ops, i + 1);
+    }, "bench");
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"alloc\": \"" << name << "\", \"threads\": " << threads
+       << ", \"mops_per_sec\": " << (double)ops * threads / used * 1e3 << "}";
+}
+
+//一个线程分配,另一个线程释放
+template<class Alloc>
+static void bench_cross(std::ostream& os, const char* name, size_t ops) {
+    MyServer::SPSCQueue<void*> q(1024);
+    auto thrs = MyServer::Thread::CreateBatch(2, [&](size_t i) {
+        void* p = nullptr;
+        for(size_t j = 0; j < ops; ++j) {
+            if(i == 0) {
+                p = Alloc::alloc(64);
+                while(!q.tryPush(p)) {
+                    sched_yield();
+                }
+            } else {
+                while(!q.tryPop(p)) {
+                    sched_yield();
+                }
+                Alloc::free(p, 64);
+            }
+        }
+    }, "cross");
+    uint64_t begin = now_ns();
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"alloc\": \"" << name << "\", \"mops_per_sec\": " << (double)ops / used * 1e3 << "}";
+}
+
+//拼接字符串,模拟日志格式化
+template<class String>
+static void bench_string(std::ostream& os, const char* name, size_t ops) {
+    uint64_t begin = now_ns();
+    size_t total = 0;
+    for(size_t i = 0; i < ops / 10; ++i) {
+        String s("2026-01-01 00:00:00\t");
+        s += "12345\t0\t[INFO]\t[system]\t";
+        s += "/path/to/source/file.cc:123\t";
+        s += "some log message body that is long enough to leave SSO";
+        total += s.size();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"string\": \"" << name << "\", \"ns_per_op\": " << (double)used / (ops / 10)
+       << ", \"bytes\": " << total << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t ops = argc > 1 ? atoll(argv[1]) : 2000000;
+    size_t max_threads = argc > 2 ? atoi(argv[2]) : 8;
+    std::ostream& os = std::cout;
+    const char* sep = "\n    ";
+    os << "{\n  \"mixed\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_mixed<Glibc>(os, "glibc", t, ops / t);
+        os << "," << sep;
+        bench_mixed<Slab>(os, "slab", t, ops / t);
+    }
+    os << "\n  ],\n  \"cross_thread\": [" << sep;
+    bench_cross<Glibc>(os, "glibc", ops);
+    os << "," << sep;
+    bench_cross<Slab>(os, "slab", ops);
+    os << "\n  ],\n  \"string\": [" << sep;
+    bench_string<std::string>(os, "std::string", ops);
+    os << "," << sep;
+    bench_string<MyServer::SlabString>(os, "SlabString", ops);
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/arena.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <stdlib.h>
+
+//arena性能测试: 模拟一次请求内构造若干临时字符串、vector、map和日志事件,
+//对比默认分配器逐个释放与arena整体reset,结果以JSON输出
+//用法: bench_arena [requests]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//一次请求: 解析头部到map,拼接若干字符串,收集参数到vector
+template<class String, class Vector, class Map>
+//字符串用proto的分配器构造,arena版本中所有内存都在arena里
+static size_t handle_request(Vector& params, Map& headers, const String& proto, int id) {
+    for(int i = 0; i < 16; ++i) {
+        String key(proto.get_allocator());
+        key += "X-Header-Name-";
+        key += (char)('a' + i);
+        String value(proto.get_allocator());
+        value += "some header value long enough to leave sso ";
+        value += (char)('0' + id % 10);
+        headers.emplace(std::move(key), std::move(value));
+    }
+    for(int i = 0; i < 32; ++i) {
+        params.push_back(i * id);
+    }
+    return headers.size() + params.size();
+}
+
+static void bench_std(std::ostream& os, size_t requests) {
+    uint64_t begin = now_ns();
+    size_t total = 0;
+    std::string proto;
+    for(size_t r = 0; r < requests; ++r) {
+        std::vector<int> params;
+        std::map<std::string, std::string> headers;
+        total += handle_request(params, headers, proto, r);
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"alloc\": \"std\", \"ns_per_request\": " << (double)used / requests
+       << ", \"check\": " << total << "}";
+}
+
+static void bench_arena(std::ostream& os, size_t requests) {
+    uint64_t begin = now_ns();
+    size_t total = 0;
+    MyServer::Arena arena;
+    for(size_t r = 0; r < requests; ++r) {
+        {
+            std::pmr::vector<int> params(&arena);
+            std::pmr::map<std::pmr::string, std::pmr::string> headers(&arena);
+            std::pmr::string proto(&arena);
+            total += handle_request(params, headers, proto, r);
+        }
+        arena.reset();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"alloc\": \"arena\", \"ns_per_request\": " << (double)used / requests
+       << ", \"check\": " << total << "}";
+}
+
+//日志事件的创建和释放
+static void bench_event(std::ostream& os, bool use_arena, size_t requests) {
+    MyServer::Logger::ptr logger = MYSERVER_LOG_ROOT();
+    MyServer::Arena arena;
+    uint64_t begin = now_ns();
+    for(size_t r = 0; r < requests; ++r) {
+        for(int i = 0; i < 4; ++i) {
+            MyServer::LogEvent::ptr event;
+            if(use_arena) {
+                event = std::allocate_shared<MyServer::LogEvent>(
+                        MyServer::ArenaAllocator<MyServer::LogEvent>(&arena), logger
+                        ,MyServer::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, 0);
+            } else {
+                event.reset(new MyServer::LogEvent(logger
+                        ,MyServer::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0, 0));
+            }
+            event->getSS() << i;
+        }
+        arena.reset();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"alloc\": \"" << (use_arena ? "arena" : "std") << "\", \"ns_per_event\": "
+       << (double)used / requests / 4 << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t requests = argc > 1 ? atoll(argv[1]) : 200000;
+    std::ostream& os = std::cout;
+    const char* sep = "\n    ";
+    os << "{\n  \"request\": [" << sep;
+    bench_std(os, requests);
+    os << "," << sep;
+    bench_arena(os, requests);
+    os << "\n  ],\n  \"log_event\": [" << sep;
+    bench_event(os, false, requests);
+    os << "," << sep;
+    bench_event(os, true, requests);
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include "../MyServer/config.h"
+#include "../MyServer/log.h"
+#include "../MyServer/thread.h"
+#include <yaml-cpp/yaml.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+
+//配置模块的性能测试,结果以JSON输出到stdout,便于比较前后版本
+//用法: bench_config [max_keys]   max_keys默认100000
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//防止编译器把测试的计算优化掉
+template<class T>
+static void do_not_optimize(const T& v) {
+    asm volatile("" : : "g"(&v) : "memory");
+}
+
+//每个key的类型按下标轮换
+enum KeyType {
+    KEY_INT = 0,
+    KEY_STRING,
+    KEY_VEC,
+    KEY_MAP,
+    KEY_TYPE_COUNT
+};
+
+static std::string key_group(const std::string& prefix, size_t i) {
+    return prefix + ".g" + std::to_string(i / 100);
+}
+
+static std::string key_name(const std::string& prefix, size_t i) {
+    return key_group(prefix, i) + ".k" + std::to_string(i);
+}
+
+//生成 prefix: { g0: { k0: ..., k1: [...], ... }, g1: ... } 的YAML, seed改变所有的值
+static std::string gen_yaml(const std::string& prefix, size_t count, int seed) {
+    std::stringstream ss;
+    ss << prefix << ":\n";
+    for(size_t i = 0; i < count; ++i) {
+        if(i % 100 == 0) {
+            ss << "  g" << i / 100 << ":\n";
+        }
+        ss << "    k" << i << ": ";
+        switch(i % KEY_TYPE_COUNT) {
+            case KEY_INT:
+                ss << i + seed << "\n";
+                break;
+            case KEY_STRING:
+                ss << "str_" << i + seed << "\n";
+                break;
+            case KEY_VEC:
+                ss << "[" << seed << ", " << i << ", " << i + 1 << ", " << i + 2 << "]\n";
+                break;
+            case KEY_MAP:
+                ss << "{a: " << seed << ", b: " << i << "}\n";
+                break;
+        }
+    }
+    return ss.str();
+}
+
+static void register_vars(const std::string& prefix, size_t count) {
+    for(size_t i = 0; i < count; ++i) {
+        std::string name = key_name(prefix, i);
+        switch(i % KEY_TYPE_COUNT) {
+            case KEY_INT:
+                MyServer::Config::Lookup(name, (int)0);
+                break;
+            case KEY_STRING:
+                MyServer::Config::Lookup(name, std::string());
+                break;
+            case KEY_VEC:
+                MyServer::Config::Lookup(name, std::vector<int>());
+                break;
+            case KEY_MAP:
+                MyServer::Config::Lookup(name, std::map<std::string, int>());
+                break;
+        }
+    }
+}
+
+static void add_listeners(const std::string& prefix, size_t count, uint64_t key) {
+    for(size_t i = 0; i < count; i += KEY_TYPE_COUNT) {
+        MyServer::Config::Lookup<int>(key_name(prefix, i))->addListener(key, [](const int&, const int&) {
+        });
+    }
+}
+
+static void bench_load(std::ostream& os, size_t count) {
+    std::string prefix = "bench" + std::to_string(count);
+    register_vars(prefix, count);
+
+    std::string yaml1 = gen_yaml(prefix, count, 1);
+    std::string yaml2 = gen_yaml(prefix, count, 2);
+
+    uint64_t begin = now_ns();
+    YAML::Node root1 = YAML::Load(yaml1);
+    uint64_t parse_ns = now_ns() - begin;
+
+    begin = now_ns();
+    MyServer::Config::LoadFromYaml(root1);
+    uint64_t load_ns = now_ns() - begin;
+
+    //每个int参数挂一个空监听,测试reload时的分发开销
+    add_listeners(prefix, count, 1);
+    YAML::Node root2 = YAML::Load(yaml2);
+    begin = now_ns();
+    MyServer::Config::LoadFromYaml(root2);
+    uint64_t reload_ns = now_ns() - begin;
+
+    uint64_t listener_us = 0;
+    auto stats = MyServer::Config::GetListenerStats();
+    for(auto& i : stats) {
+        listener_us += i.elapse_us;
+    }
+
+    //随机Lookup的平均耗时
+    const size_t lookups = 200000;
+    std::vector<std::string> names;
+    for(size_t i = 0; i < 1024; ++i) {
+        names.push_back(key_name(prefix, (rand() % (count / KEY_TYPE_COUNT)) * KEY_TYPE_COUNT));
+    }
+    size_t found = 0;
+    begin = now_ns();
+    for(size_t i = 0; i < lookups; ++i) {
+        found += !!MyServer::Config::Lookup<int>(names[i & 1023]);
+    }
+    uint64_t lookup_ns = now_ns() - begin;
+
+    os << "{\"keys\": " << count
+       << ", \"yaml_bytes\": " << yaml1.size()
+       << ", \"yaml_parse_ms\": " << parse_ns / 1e6
+       << ", \"load_from_yaml_ms\": " << load_ns / 1e6
+       << ", \"reload_ms\": " << reload_ns / 1e6
+       << ", \"listeners\": " << stats.size()
+       << ", \"listener_dispatch_ms\": " << listener_us / 1e3
+       << ", \"lookup_ns\": " << (double)lookup_ns / lookups
+       << ", \"lookup_found\": " << (found == lookups ? "true" : "false")
+       << "}";
+}
+
+//writer_hz不为0时另起一个线程按固定频率setValue,测量读者在有写者时的吞吐
+static void bench_get_value(std::ostream& os, int threads, bool cached, int writer_hz) {
+    static MyServer::ConfigVar<int>::ptr s_var = MyServer::Config::Lookup("bench.get_value", (int)1);
+    const size_t ops = 2000000;
+    std::vector<MyServer::Thread::ptr> thrs;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> writes{0};
+    MyServer::Thread::ptr writer;
+    if(writer_hz) {
+        writer.reset(new MyServer::Thread([&stop, &writes, writer_hz]() {
+            int v = 1;
+            while(!stop.load(std::memory_order_relaxed)) {
+                s_var->setValue(++v);
+                writes.fetch_add(1, std::memory_order_relaxed);
+                usleep(1000000 / writer_hz);
+            }
+        }, "bench_writer"));
+    }
+    uint64_t begin = now_ns();
+    for(int i = 0; i < threads; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([cached, ops]() {
+            if(cached) {
+                static thread_local MyServer::ConfigVarCache<int> s_cache(s_var);
+                for(size_t n = 0; n < ops; ++n) {
+                    do_not_optimize(s_cache.getValue());
+                }
+            } else {
+                for(size_t n = 0; n < ops; ++n) {
+                    do_not_optimize(s_var->getValue());
+                }
+            }
+        }, "bench_" + std::to_string(i))));
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+    stop.store(true, std::memory_order_relaxed);
+    if(writer) {
+        writer->join();
+    }
+    os << "{\"threads\": " << threads
+       << ", \"cached\": " << (cached ? "true" : "false")
+       << ", \"writer_hz\": " << writer_hz
+       << ", \"writes\": " << writes.load()
+       << ", \"mops\": " << (double)ops * threads / used * 1e3
+       << "}";
+}
+
+template<class T>
+static void bench_cast(std::ostream& os, const char* name, const std::string& str) {
+    const size_t ops = 20000;
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        T v = MyServer::LexicalCast<std::string, T>()(str);
+        do_not_optimize(v);
+    }
+    uint64_t from_ns = now_ns() - begin;
+
+    T v = MyServer::LexicalCast<std::string, T>()(str);
+    begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        std::string s = MyServer::LexicalCast<T, std::string>()(v);
+        do_not_optimize(s);
+    }
+    uint64_t to_ns = now_ns() - begin;
+    os << "{\"type\": \"" << name << "\""
+       << ", \"from_string_ns\": " << (double)from_ns / ops
+       << ", \"to_string_ns\": " << (double)to_ns / ops
+       << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t max_keys = argc > 1 ? atoi(argv[1]) : 100000;
+
+    std::ostream& os = std::cout;
+    os << "{\n  \"load\": [";
+    bool first = true;
+    for(size_t count = 1000; count <= max_keys; count *= 10) {
+        os << (first ? "\n    " : ",\n    ");
+        bench_load(os, count);
+        first = false;
+    }
+    os << "\n  ],\n  \"get_value\": [";
+    first = true;
+    //无写者和每秒1000次写入两种情况
+    for(int writer_hz = 0; writer_hz <= 1000; writer_hz += 1000) {
+        for(int cached = 0; cached < 2; ++cached) {
+            for(int threads = 1; threads <= 8; threads *= 2) {
+                os << (first ? "\n    " : ",\n    ");
+                bench_get_value(os, threads, cached, writer_hz);
+                first = false;
+            }
+        }
+    }
+    os << "\n  ],\n  \"lexical_cast\": [\n    ";
+    bench_cast<int>(os, "int", "12345");
+    os << ",\n    ";
+    bench_cast<double>(os, "double", "3.1415926");
+    os << ",\n    ";
+    bench_cast<std::string>(os, "string", "hello_config");
+    os << ",\n    ";
+    bench_cast<std::vector<int> >(os, "vector<int>", "[1, 2, 3, 4, 5, 6, 7, 8]");
+    os << ",\n    ";
+    bench_cast<std::list<int> >(os, "list<int>", "[1, 2, 3, 4, 5, 6, 7, 8]");
+    os << ",\n    ";
+    bench_cast<std::set<int> >(os, "set<int>", "[1, 2, 3, 4, 5, 6, 7, 8]");
+    os << ",\n    ";
+    bench_cast<std::unordered_set<int> >(os, "unordered_set<int>", "[1, 2, 3, 4, 5, 6, 7, 8]");
+    os << ",\n    ";
+    bench_cast<std::map<std::string, int> >(os, "map<string,int>", "{a: 1, b: 2, c: 3, d: 4}");
+    os << ",\n    ";
+    bench_cast<std::unordered_map<std::string, int> >(os, "unordered_map<string,int>", "{a: 1, b: 2, c: 3, d: 4}");
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "../MyServer/MyServer.h"
+#include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <random>
+#include <stdlib.h>
+
+//数值转换性能测试: 整数和浮点数转文本、文本转数值,
+//对比std::ostringstream、boost::lexical_cast、std::to_string/strtol和util中的转换函数,
+//以及日志格式器中数值项的开销,结果以JSON输出
+//用法: bench_convert [ops]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//ops次调用cb的平均耗时
+template<class Cb>
+static void run(std::ostream& os, const char* name, size_t ops, Cb cb) {
+    size_t check = 0;
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        check += cb(i);
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"method\": \"" << name << "\", \"ns_per_op\": " << (double)used / ops
+       << ", \"check\": " << check << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t ops = argc > 1 ? atoll(argv[1]) : 1000000;
+    std::mt19937_64 rnd(1);
+    std::vector<int64_t> ints(1024);
+    std::vector<double> doubles(1024);
+    std::vector<std::string> int_strs(1024);
+    std::vector<std::string> double_strs(1024);
+    for(size_t i = 0; i < 1024; ++i) {
+        ints[i] = (int64_t)(rnd() >> (rnd() % 64));
+        doubles[i] = (double)(rnd() % 1000000) / 1000;
+        int_strs[i] = std::to_string(ints[i]);
+        double_strs[i] = MyServer::LexicalCast<double, std::string>()(doubles[i]);
+    }
+    std::ostream& os = std::cout;
+    const char* sep = "\n    ";
+
+    os << "{\n  \"int_to_string\": [" << sep;
+    std::ostringstream ss;
+    run(os, "ostringstream", ops, [&](size_t i) {
+        ss.str("");
+        ss << ints[i & 1023];
+        return ss.str().size();
+    });
+    os << "," << sep;
+    run(os, "boost::lexical_cast", ops, [&](size_t i) {
+        return boost::lexical_cast<std::string>(ints[i & 1023]).size();
+    });
+    os << "," << sep;
+    run(os, "std::to_string", ops, [&](size_t i) {
+        return std::to_string(ints[i & 1023]).size();
+    });
+    os << "," << sep;
+    run(os, "IntToChars", ops, [&](size_t i) {
+        char buf[20];
+        return MyServer::IntToChars(ints[i & 1023], buf);
+    });
+
+    os << "\n  ],\n  \"double_to_string\": [" << sep;
+    run(os, "ostringstream", ops, [&](size_t i) {
+        ss.str("");
+        ss << doubles[i & 1023];
+        return ss.str().size();
+    });
+    os << "," << sep;
+    run(os, "boost::lexical_cast", ops, [&](size_t i) {
+        return boost::lexical_cast<std::string>(doubles[i & 1023]).size();
+    });
+    os << "," << sep;
+    run(os, "DoubleToChars", ops, [&](size_t i) {
+        char buf[32];
+        return MyServer::DoubleToChars(doubles[i & 1023], buf);
+    });
+
+    os << "\n  ],\n  \"string_to_int\": [" << sep;
+    run(os, "boost::lexical_cast", ops, [&](size_t i) {
+        return (size_t)boost::lexical_cast<int64_t>(int_strs[i & 1023]);
+    });
+    os << "," << sep;
+    run(os, "strtoll", ops, [&](size_t i) {
+        return (size_t)strtoll(int_strs[i & 1023].c_str(), nullptr, 10);
+    });
+    os << "," << sep;
+    run(os, "ParseInt64", ops, [&](size_t i) {
+        const std::string& s = int_strs[i & 1023];
+        int64_t v = 0;
+        MyServer::ParseInt64(s.data(), s.data() + s.size(), v);
+        return (size_t)v;
+    });
+
+    os << "\n  ],\n  \"string_to_double\": [" << sep;
+    run(os, "boost::lexical_cast", ops, [&](size_t i) {
+        return (size_t)boost::lexical_cast<double>(double_strs[i & 1023]);
+    });
+    os << "," << sep;
+    run(os, "strtod", ops, [&](size_t i) {
+        return (size_t)strtod(double_strs[i & 1023].c_str(), nullptr);
+    });
+    os << "," << sep;
+    run(os, "ParseDouble", ops, [&](size_t i) {
+        const std::string& s = double_strs[i & 1023];
+        double v = 0;
+        MyServer::ParseDouble(s.data(), s.data() + s.size(), v);
+        return (size_t)v;
+    });
+
+    //格式器只包含数值项时每条日志的耗时
+    os << "\n  ],\n  \"log_format\": [" << sep;
+    MyServer::Logger::ptr logger(new MyServer::Logger("bench"));
+    MyServer::LogFormatter::ptr fmt(new MyServer::LogFormatter("%r %t %F %l"));
+    MyServer::LogEvent::ptr event(new MyServer::LogEvent(logger, MyServer::LogLevel::INFO
+                ,__FILE__, __LINE__, 123456, MyServer::GetThreadId(), 0, time(0)));
+    run(os, "numeric_items", ops, [&](size_t i) {
+        return fmt->format(logger, MyServer::LogLevel::INFO, event).size();
+    });
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "../MyServer/MyServer.h"
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <sched.h>
+
+//计数器性能测试: test_thread中fun1的负载,每个线程对同一个计数器自增固定次数,
+//对比Mutex保护的整数、std::atomic和ShardedCounter,结果以JSON输出
+//用法: bench_counter [max_threads] [increments_per_thread]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct MutexCounter {
+    MyServer::Mutex mutex;
+    int64_t count = 0;
+
+    void inc() {
+        MyServer::Mutex::Lock lock(mutex);
+        ++count;
+    }
+    int64_t get() {
+        MyServer::Mutex::Lock lock(mutex);
+        return count;
+    }
+};
+
+struct AtomicCounter {
+    std::atomic<int64_t> count{0};
+
+    void inc() {
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+    int64_t get() {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+struct ShardCounter {
+    MyServer::ShardedCounter<> count;
+
+    void inc() {
+        count.add(1);
+    }
+    int64_t get() {
+        return count.get();
+    }
+};
+
+template<class Counter>
+static void bench_inc(std::ostream& os, const char* name, size_t threads, int64_t per_thread) {
+    Counter counter;
+    std::atomic<bool> go{false};
+    auto thrs = MyServer::Thread::CreateBatch(threads, [&](size_t) {
+        while(!go.load(std::memory_order_acquire)) {
+            sched_yield();
+        }
+        for(int64_t i = 0; i < per_thread; ++i) {
+            counter.inc();
+        }
+    }, "bench");
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+    int64_t total = per_thread * threads;
+    if(counter.get() != total) {
+        std::cerr << name << " lost update total=" << total << " count=" << counter.get() << std::endl;
+        exit(1);
+    }
+    //汇总读取的开销
+    const int reads = 100000;
+    volatile int64_t sink = 0;
+    uint64_t rbegin = now_ns();
+    for(int i = 0; i < reads; ++i) {
+        sink = counter.get();
+    }
+    uint64_t rused = now_ns() - rbegin;
+    os << "{\"counter\": \"" << name << "\", \"threads\": " << threads
+       << ", \"mops_per_sec\": " << (double)total / used * 1e3
+       << ", \"read_ns\": " << (double)rused / reads
+       << ", \"last_read\": " << sink << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t max_threads = argc > 1 ? atoi(argv[1]) : 32;
+    int64_t per_thread = argc > 2 ? atoll(argv[2]) : 100000;
+    std::ostream& os = std::cout;
+    const char* sep = "\n    ";
+    os << "{\n  \"increment\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_inc<MutexCounter>(os, "Mutex", t, per_thread);
+        os << "," << sep;
+        bench_inc<AtomicCounter>(os, "atomic", t, per_thread);
+        os << "," << sep;
+        bench_inc<ShardCounter>(os, "ShardedCounter", t, per_thread);
+    }
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
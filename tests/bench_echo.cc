@@ -0,0 +1,172 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/iomanager.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+
+//回环echo性能测试: IOManager做服务端,每个连接一个客户端线程(阻塞socket)一问一答,
+//统计请求数/秒和往返延迟,结果以JSON输出
+//用法: bench_echo [server_threads] [connections] [seconds] [msg_size]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void set_nonblock(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+//连接协程: 读到数据原样写回,EAGAIN时等待事件并yield
+static void handle_client(int fd) {
+    MyServer::IOManager* iom = MyServer::IOManager::GetThis();
+    char buf[4096];
+    while(true) {
+        int n = read(fd, buf, sizeof(buf));
+        if(n < 0 && errno == EAGAIN) {
+            iom->addEvent(fd, MyServer::IOManager::READ);
+            MyServer::Fiber::Yield();
+            continue;
+        }
+        if(n <= 0) {
+            break;
+        }
+        int off = 0;
+        while(off < n) {
+            int w = write(fd, buf + off, n - off);
+            if(w < 0 && errno == EAGAIN) {
+                iom->addEvent(fd, MyServer::IOManager::WRITE);
+                MyServer::Fiber::Yield();
+                continue;
+            }
+            if(w <= 0) {
+                break;
+            }
+            off += w;
+        }
+    }
+    close(fd);
+}
+
+static void accept_loop(int listen_fd, std::atomic<bool>* stop) {
+    MyServer::IOManager* iom = MyServer::IOManager::GetThis();
+    while(!*stop) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) {
+            if(errno == EAGAIN) {
+                iom->addEvent(listen_fd, MyServer::IOManager::READ);
+                MyServer::Fiber::Yield();
+                continue;
+            }
+            break;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        iom->schedule(std::bind(&handle_client, fd));
+    }
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t threads = argc > 1 ? atoi(argv[1]) : 2;
+    size_t conns = argc > 2 ? atoi(argv[2]) : 16;
+    double seconds = argc > 3 ? atof(argv[3]) : 2;
+    size_t msg_size = argc > 4 ? atoi(argv[4]) : 64;
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) || listen(listen_fd, 1024)
+            || getsockname(listen_fd, (sockaddr*)&addr, &len)) {
+        std::cerr << "listen fail errno=" << errno << std::endl;
+        return 1;
+    }
+    set_nonblock(listen_fd);
+
+    std::atomic<bool> stop{false};
+    MyServer::IOManager::ptr iom(new MyServer::IOManager(threads, "echo"));
+    iom->schedule(std::bind(&accept_loop, listen_fd, &stop));
+
+    std::vector<std::vector<uint64_t> > latencies(conns);
+    std::vector<MyServer::Thread::ptr> clients;
+    std::atomic<bool> running{true};
+    for(size_t i = 0; i < conns; ++i) {
+        clients.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i]() {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if(connect(fd, (sockaddr*)&addr, sizeof(addr))) {
+                close(fd);
+                return;
+            }
+            std::string msg(msg_size, 'x');
+            std::vector<char> buf(msg_size);
+            std::vector<uint64_t>& lat = latencies[i];
+            lat.reserve(1 << 20);
+            while(running) {
+                uint64_t begin = now_ns();
+                if(write(fd, msg.c_str(), msg.size()) != (int)msg.size()) {
+                    break;
+                }
+                size_t got = 0;
+                while(got < msg_size) {
+                    int n = read(fd, &buf[got], msg_size - got);
+                    if(n <= 0) {
+                        break;
+                    }
+                    got += n;
+                }
+                if(got < msg_size) {
+                    break;
+                }
+                lat.push_back(now_ns() - begin);
+            }
+            close(fd);
+        }, "client_" + std::to_string(i))));
+    }
+
+    uint64_t begin = now_ns();
+    usleep(seconds * 1000 * 1000);
+    running = false;
+    for(auto& i : clients) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+
+    stop = true;
+    iom->cancelAll(listen_fd);
+    iom.reset();
+    close(listen_fd);
+
+    std::vector<uint64_t> all;
+    for(auto& i : latencies) {
+        all.insert(all.end(), i.begin(), i.end());
+    }
+    std::sort(all.begin(), all.end());
+    size_t count = all.size();
+    std::cout << "{\"server_threads\": " << threads
+              << ", \"connections\": " << conns
+              << ", \"msg_size\": " << msg_size
+              << ", \"requests\": " << count
+              << ", \"requests_per_sec\": " << (uint64_t)(count * 1e9 / used)
+              << ", \"p50_us\": " << (count ? all[count / 2] / 1e3 : 0)
+              << ", \"p99_us\": " << (count ? all[count * 99 / 100] / 1e3 : 0)
+              << ", \"max_us\": " << (count ? all.back() / 1e3 : 0)
+              << "}" << std::endl;
+    return 0;
+}
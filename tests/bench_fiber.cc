@@ -0,0 +1,181 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/fiber_stack.h"
+#include <ucontext.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+//协程性能测试: 切换开销、创建开销和大量并发协程,结果以JSON输出
+//用法: bench_fiber [fibers] [idle_fibers]   fibers默认10000, idle_fibers默认100000
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//resume + yield 一次往返是两次切换
+static void bench_switch(std::ostream& os) {
+    const size_t rounds = 5000000;
+    MyServer::Fiber::ptr fiber(new MyServer::Fiber([]() {
+        for(size_t i = 0; i < rounds; ++i) {
+            MyServer::Fiber::Yield();
+        }
+    }));
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < rounds; ++i) {
+        fiber->resume();
+    }
+    uint64_t used = now_ns() - begin;
+    fiber->resume();
+    os << "{\"name\": \"fiber_switch\", \"impl\": \"" << (MYSERVER_FIBER_ASM ? "asm" : "ucontext")
+       << "\", \"switches\": " << rounds * 2
+       << ", \"ns_per_switch\": " << (double)used / (rounds * 2) << "}";
+}
+
+//直接使用swapcontext作为对照,每次切换都有一次sigprocmask系统调用
+static ucontext_t s_main_ctx;
+static ucontext_t s_uc_ctx;
+static size_t s_uc_rounds = 0;
+
+static void uc_func() {
+    for(size_t i = 0; i < s_uc_rounds; ++i) {
+        swapcontext(&s_uc_ctx, &s_main_ctx);
+    }
+}
+
+static void bench_ucontext(std::ostream& os) {
+    const size_t rounds = 1000000;
+    const size_t stacksize = 128 * 1024;
+    std::vector<char> stack(stacksize);
+    s_uc_rounds = rounds;
+    getcontext(&s_uc_ctx);
+    s_uc_ctx.uc_link = &s_main_ctx;
+    s_uc_ctx.uc_stack.ss_sp = &stack[0];
+    s_uc_ctx.uc_stack.ss_size = stacksize;
+    makecontext(&s_uc_ctx, &uc_func, 0);
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < rounds; ++i) {
+        swapcontext(&s_main_ctx, &s_uc_ctx);
+    }
+    uint64_t used = now_ns() - begin;
+    swapcontext(&s_main_ctx, &s_uc_ctx);
+    os << "{\"name\": \"raw_swapcontext\", \"switches\": " << rounds * 2
+       << ", \"ns_per_switch\": " << (double)used / (rounds * 2) << "}";
+}
+
+//新建协程执行一个空函数再销毁,和reset复用栈对比
+static void bench_create(std::ostream& os) {
+    const size_t rounds = 200000;
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < rounds; ++i) {
+        MyServer::Fiber::ptr fiber(new MyServer::Fiber([]() {}));
+        fiber->resume();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"name\": \"fiber_create\", \"count\": " << rounds
+       << ", \"ns_per_fiber\": " << (double)used / rounds << "},\n    ";
+
+    MyServer::Fiber::ptr fiber(new MyServer::Fiber([]() {}));
+    fiber->resume();
+    begin = now_ns();
+    for(size_t i = 0; i < rounds; ++i) {
+        fiber->reset([]() {});
+        fiber->resume();
+    }
+    used = now_ns() - begin;
+    os << "{\"name\": \"fiber_reset\", \"count\": " << rounds
+       << ", \"ns_per_fiber\": " << (double)used / rounds << "}";
+}
+
+//大量协程同时存活,轮流resume
+static void bench_many(std::ostream& os, size_t count) {
+    const size_t rounds = 100;
+    std::vector<MyServer::Fiber::ptr> fibers;
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        fibers.push_back(MyServer::Fiber::ptr(new MyServer::Fiber([]() {
+            for(size_t j = 0; j < rounds; ++j) {
+                MyServer::Fiber::Yield();
+            }
+        })));
+    }
+    uint64_t create = now_ns() - begin;
+    begin = now_ns();
+    for(size_t j = 0; j <= rounds; ++j) {
+        for(auto& i : fibers) {
+            i->resume();
+        }
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"name\": \"many_fibers\", \"fibers\": " << count
+       << ", \"create_ms\": " << create / 1e6
+       << ", \"ns_per_switch\": " << (double)used / (count * (rounds + 1) * 2) << "}";
+}
+
+//当前进程的常驻内存(KB)
+static size_t rss_kb() {
+    size_t pages = 0, resident = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if(fp) {
+        if(fscanf(fp, "%zu %zu", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+//大量执行过一次后挂起的协程占用的常驻内存
+static void bench_idle(std::ostream& os, size_t count) {
+    //每个guard页多占一个VMA,超过vm.max_map_count时关闭guard页
+    bool guard = count * 2 + 1000 < 65530;
+    MyServer::Config::Lookup<bool>("fiber.stack_guard")->setValue(guard);
+    size_t stacksize = MyServer::Config::Lookup<uint32_t>("fiber.stack_size")->getValue();
+
+    size_t before = rss_kb();
+    std::vector<MyServer::Fiber::ptr> fibers;
+    fibers.reserve(count);
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        fibers.push_back(MyServer::Fiber::ptr(new MyServer::Fiber([]() {
+            MyServer::Fiber::Yield();
+        })));
+        fibers.back()->resume();
+    }
+    uint64_t used = now_ns() - begin;
+    size_t after = rss_kb();
+    for(auto& i : fibers) {
+        i->resume();
+    }
+    fibers.clear();
+    MyServer::FiberStackPool::Trim();
+    MyServer::Config::Lookup<bool>("fiber.stack_guard")->setValue(true);
+    os << "{\"name\": \"idle_fibers\", \"fibers\": " << count
+       << ", \"guard\": " << (guard ? "true" : "false")
+       << ", \"ns_per_fiber\": " << (double)used / count
+       << ", \"rss_kb\": " << after - before
+       << ", \"rss_per_fiber_kb\": " << (double)(after - before) / count
+       << ", \"stack_kb\": " << stacksize / 1024 << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t fibers = argc > 1 ? atoi(argv[1]) : 10000;
+    size_t idle_fibers = argc > 2 ? atoi(argv[2]) : 100000;
+    MyServer::Fiber::GetThis();
+
+    std::ostream& os = std::cout;
+    os << "{\n  \"results\": [\n    ";
+    bench_switch(os);
+    os << ",\n    ";
+    bench_ucontext(os);
+    os << ",\n    ";
+    bench_create(os);
+    os << ",\n    ";
+    bench_many(os, fibers);
+    os << ",\n    ";
+    bench_idle(os, idle_fibers);
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
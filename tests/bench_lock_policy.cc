@@ -0,0 +1,90 @@
+#include "../MyServer/MyServer.h"
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+
+//锁策略性能测试: 单线程下空锁和真实锁加解锁的开销,以及日志、配置模块按当前构建选项的单次调用开销,
+//结果以JSON输出。分别用默认构建和 -DMYSERVER_SINGLE_THREADED=ON 构建运行,比较logger和config部分
+//用法: bench_lock_policy [ops]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//单线程反复加锁解锁,返回每次的纳秒数
+template<class MutexType, class LockType>
+static double bench_lock(size_t ops) {
+    MutexType m;
+    volatile uint64_t counter = 0;
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        LockType lock(m);
+        counter = counter + 1;
+    }
+    return (double)(now_ns() - begin) / ops;
+}
+
+//格式化后丢弃,只保留日志路径上的加锁和格式化开销
+class DiscardAppender : public MyServer::LogAppender {
+public:
+    void log(MyServer::Logger::ptr logger, MyServer::LogLevel::Level level
+             ,MyServer::LogEvent::ptr event) override {
+        MutexType::Lock lock(m_mutex);
+        m_bytes += m_formatter->format(logger, level, event).size();
+    }
+    std::string toYamlString() override {
+        return "";
+    }
+    size_t m_bytes = 0;
+};
+
+int main(int argc, char** argv) {
+    size_t ops = argc > 1 ? atoll(argv[1]) : 1000000;
+    std::ostream& os = std::cout;
+#ifdef MYSERVER_SINGLE_THREADED
+    bool single = true;
+#else
+    bool single = false;
+#endif
+    os << "{\n  \"single_threaded\": " << (single ? "true" : "false") << ",\n  \"locks\": {";
+    os << "\n    \"NullMutex_ns\": " << bench_lock<MyServer::NullMutex, MyServer::NullMutex::Lock>(ops)
+       << ",\n    \"FutexMutex_ns\": " << bench_lock<MyServer::FutexMutex, MyServer::FutexMutex::Lock>(ops)
+       << ",\n    \"Spinlock_ns\": " << bench_lock<MyServer::Spinlock, MyServer::Spinlock::Lock>(ops)
+       << ",\n    \"NullRWMutex_read_ns\": "
+       << bench_lock<MyServer::NullRWMutex, MyServer::NullRWMutex::ReadLock>(ops)
+       << ",\n    \"BRMutex_read_ns\": " << bench_lock<MyServer::BRMutex, MyServer::BRMutex::ReadLock>(ops)
+       << ",\n    \"BRMutex_write_ns\": " << bench_lock<MyServer::BRMutex, MyServer::BRMutex::WriteLock>(ops);
+
+    //日志: Logger和LogAppender的锁,按当前构建选项
+    MyServer::Logger::ptr logger = MYSERVER_LOG_NAME("bench_lock_policy");
+    std::shared_ptr<DiscardAppender> appender(new DiscardAppender);
+    logger->addAppender(appender);
+    logger->setLevel(MyServer::LogLevel::DEBUG);
+    size_t log_ops = ops / 10;
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < log_ops; ++i) {
+        MYSERVER_LOG_INFO(logger) << "bench " << i;
+    }
+    double log_ns = (double)(now_ns() - begin) / log_ops;
+
+    //查找日志器: LoggerManager的读锁
+    begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        logger = MYSERVER_LOG_NAME("bench_lock_policy");
+    }
+    double lookup_ns = (double)(now_ns() - begin) / ops;
+
+    //读配置: ConfigVar的读锁
+    auto var = MyServer::Config::Lookup("bench.lock_policy", (int)1, "bench");
+    volatile int sink = 0;
+    begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        sink = sink + var->getValue();
+    }
+    double config_ns = (double)(now_ns() - begin) / ops;
+
+    os << "\n  },\n  \"logger\": {\"log_ns\": " << log_ns << ", \"lookup_ns\": " << lookup_ns
+       << "},\n  \"config\": {\"get_value_ns\": " << config_ns << "}\n}" << std::endl;
+    return 0;
+}
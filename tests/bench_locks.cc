@@ -0,0 +1,284 @@
+#include "../MyServer/MyServer.h"
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+
+//锁性能测试: 无竞争和多线程竞争下加锁解锁的开销,结果以JSON输出
+//用法: bench_locks [max_threads] [ms_per_case]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//每个线程的计数独占一个cache line
+struct alignas(64) PaddedCount {
+    uint64_t v = 0;
+};
+
+//单线程反复加锁解锁
+template<class MutexType, class LockType>
+static void bench_uncontended(std::ostream& os) {
+    const size_t ops = 10000000;
+    MutexType m;
+    volatile uint64_t counter = 0;
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        LockType lock(m);
+        counter = counter + 1;
+    }
+    uint64_t used = now_ns() - begin;
+    os << "\"uncontended_ns\": " << (double)used / ops;
+}
+
+//所有线程争同一把锁,临界区只有一次自增,按固定时长统计吞吐
+template<class MutexType, class LockType>
+static void bench_contended(std::ostream& os, size_t threads, int ms) {
+    MutexType m;
+    volatile uint64_t counter = 0;
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<PaddedCount> ops(threads);
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(size_t i = 0; i < threads; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i]() {
+            while(!go.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            uint64_t n = 0;
+            while(!stop.load(std::memory_order_relaxed)) {
+                LockType lock(m);
+                counter = counter + 1;
+                ++n;
+            }
+            ops[i].v = n;
+        }, "bench_" + std::to_string(i))));
+    }
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    usleep(ms * 1000);
+    stop.store(true, std::memory_order_relaxed);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+
+    uint64_t total = 0;
+    uint64_t min_ops = ~0ull;
+    uint64_t max_ops = 0;
+    for(auto& i : ops) {
+        total += i.v;
+        min_ops = std::min(min_ops, i.v);
+        max_ops = std::max(max_ops, i.v);
+    }
+    if(total != counter) {
+        std::cerr << "lost update total=" << total << " counter=" << counter << std::endl;
+        exit(1);
+    }
+    os << "{\"threads\": " << threads
+       << ", \"mops_per_sec\": " << (double)total / used * 1e3
+       << ", \"fairness\": " << (max_ops ? (double)min_ops / max_ops : 0) << "}";
+}
+
+template<class MutexType, class LockType>
+static void bench_lock(std::ostream& os, const char* name, size_t max_threads, int ms, bool first) {
+    const char* sep = "\n      ";
+    os << (first ? "" : ",") << "\n    {\"lock\": \"" << name << "\", ";
+    bench_uncontended<MutexType, LockType>(os);
+    os << ", \"contended\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_contended<MutexType, LockType>(os, t, ms);
+    }
+    os << "\n    ]}";
+}
+
+//防止读取被优化掉
+static volatile uint64_t s_sink = 0;
+
+//读多写少: 读者在读锁内读取一组数据,一个写者每毫秒更新一次
+template<class MutexType>
+static void bench_read(std::ostream& os, size_t threads, int ms) {
+    MutexType m;
+    uint64_t data[8] = {0};
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<PaddedCount> ops(threads);
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(size_t i = 0; i < threads; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i]() {
+            while(!go.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            uint64_t n = 0;
+            uint64_t sum = 0;
+            while(!stop.load(std::memory_order_relaxed)) {
+                typename MutexType::ReadLock lock(m);
+                for(int j = 0; j < 8; ++j) {
+                    sum += data[j];
+                }
+                ++n;
+            }
+            ops[i].v = n;
+            s_sink = sum;
+        }, "reader_" + std::to_string(i))));
+    }
+    uint64_t writes = 0;
+    MyServer::Thread::ptr writer(new MyServer::Thread([&]() {
+        while(!go.load(std::memory_order_acquire)) {
+            sched_yield();
+        }
+        while(!stop.load(std::memory_order_relaxed)) {
+            {
+                typename MutexType::WriteLock lock(m);
+                for(int j = 0; j < 8; ++j) {
+                    ++data[j];
+                }
+            }
+            ++writes;
+            usleep(1000);
+        }
+    }, "writer"));
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    usleep(ms * 1000);
+    stop.store(true, std::memory_order_relaxed);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    writer->join();
+    uint64_t used = now_ns() - begin;
+
+    uint64_t total = 0;
+    for(auto& i : ops) {
+        total += i.v;
+    }
+    os << "{\"threads\": " << threads
+       << ", \"read_mops_per_sec\": " << (double)total / used * 1e3
+       << ", \"writes\": " << writes << "}";
+}
+
+template<class MutexType>
+static void bench_rwlock(std::ostream& os, const char* name, size_t max_threads, int ms, bool first) {
+    const char* sep = "\n      ";
+    os << (first ? "" : ",") << "\n    {\"lock\": \"" << name << "\", ";
+    bench_uncontended<MutexType, typename MutexType::ReadLock>(os);
+    os << ", \"read_mostly\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_read<MutexType>(os, t, ms);
+    }
+    os << "\n    ]}";
+}
+
+//每次请求都要读的小数据
+struct SmallState {
+    uint64_t v[4];
+};
+
+struct SeqLockState {
+    MyServer::SeqLock<SmallState> s;
+    SmallState read() { return s.load();}
+    void write(const SmallState& v) { s.store(v);}
+};
+
+template<class MutexType, class ReadLockType, class WriteLockType>
+struct LockedState {
+    MutexType m;
+    SmallState s = SmallState();
+    SmallState read() {
+        ReadLockType lock(m);
+        return s;
+    }
+    void write(const SmallState& v) {
+        WriteLockType lock(m);
+        s = v;
+    }
+};
+
+//读者不停读取小数据,一个写者每毫秒更新一次
+template<class StateType>
+static void bench_state(std::ostream& os, const char* name, size_t threads, int ms) {
+    StateType state;
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<PaddedCount> ops(threads);
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(size_t i = 0; i < threads; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i]() {
+            while(!go.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            uint64_t n = 0;
+            uint64_t sum = 0;
+            while(!stop.load(std::memory_order_relaxed)) {
+                sum += state.read().v[0];
+                ++n;
+            }
+            ops[i].v = n;
+            s_sink = sum;
+        }, "reader_" + std::to_string(i))));
+    }
+    MyServer::Thread::ptr writer(new MyServer::Thread([&]() {
+        while(!go.load(std::memory_order_acquire)) {
+            sched_yield();
+        }
+        SmallState v = SmallState();
+        while(!stop.load(std::memory_order_relaxed)) {
+            ++v.v[0];
+            state.write(v);
+            usleep(1000);
+        }
+    }, "writer"));
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    usleep(ms * 1000);
+    stop.store(true, std::memory_order_relaxed);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    writer->join();
+    uint64_t used = now_ns() - begin;
+
+    uint64_t total = 0;
+    for(auto& i : ops) {
+        total += i.v;
+    }
+    os << "{\"state\": \"" << name << "\", \"threads\": " << threads
+       << ", \"read_mops_per_sec\": " << (double)total / used * 1e3 << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t max_threads = argc > 1 ? atoi(argv[1]) : 64;
+    int ms = argc > 2 ? atoi(argv[2]) : 200;
+    std::ostream& os = std::cout;
+
+    os << "{\n  \"exclusive\": [";
+    bench_lock<MyServer::Mutex, MyServer::Mutex::Lock>(os, "Mutex", max_threads, ms, true);
+    bench_lock<MyServer::FutexMutex, MyServer::FutexMutex::Lock>(os, "FutexMutex", max_threads, ms, false);
+    bench_lock<MyServer::Spinlock, MyServer::Spinlock::Lock>(os, "Spinlock", max_threads, ms, false);
+    bench_lock<MyServer::CASLock, MyServer::CASLock::Lock>(os, "CASLock", max_threads, ms, false);
+    bench_lock<MyServer::RWMutex, MyServer::RWMutex::WriteLock>(os, "RWMutex.write", max_threads, ms, false);
+    bench_lock<MyServer::BRMutex, MyServer::BRMutex::WriteLock>(os, "BRMutex.write", max_threads, ms, false);
+    os << "\n  ],\n  \"shared\": [";
+    bench_rwlock<MyServer::RWMutex>(os, "RWMutex", max_threads, ms, true);
+    bench_rwlock<MyServer::BRMutex>(os, "BRMutex", max_threads, ms, false);
+    os << "\n  ],\n  \"small_state\": [";
+    typedef LockedState<MyServer::RWMutex, MyServer::RWMutex::ReadLock, MyServer::RWMutex::WriteLock> RWMutexState;
+    typedef LockedState<MyServer::Spinlock, MyServer::Spinlock::Lock, MyServer::Spinlock::Lock> SpinlockState;
+    const char* sep = "\n    ";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_state<SeqLockState>(os, "SeqLock", t, ms);
+        os << "," << sep;
+        bench_state<RWMutexState>(os, "RWMutex", t, ms);
+        os << "," << sep;
+        bench_state<SpinlockState>(os, "Spinlock", t, ms);
+    }
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
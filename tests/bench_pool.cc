@@ -0,0 +1,128 @@
+#include "../MyServer/MyServer.h"
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <sched.h>
+
+//对象池性能测试: 同一线程取还,以及一个线程分配、另一个线程释放,
+//对比new/delete、make_shared和ObjectPool,结果以JSON输出
+//用法: bench_pool [ops] [max_pairs]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//模拟一个请求对象
+struct Request {
+    char header[256];
+    uint64_t id = 0;
+    std::string path;
+};
+
+static MyServer::ObjectPool<Request> s_pool(64, 256, [](Request& r) {
+    r.id = 0;
+    r.path.clear();
+});
+
+struct NewDelete {
+    typedef Request* ptr;
+    static ptr alloc() { return new Request;}
+    static void free(ptr& p) { delete p;}
+};
+
+struct MakeShared {
+    typedef std::shared_ptr<Request> ptr;
+    static ptr alloc() { return std::make_shared<Request>();}
+    static void free(ptr& p) { p.reset();}
+};
+
+struct Pool {
+    typedef MyServer::ObjectPool<Request>::UniquePtr ptr;
+    static ptr alloc() { return s_pool.get();}
+    static void free(ptr& p) { p.reset();}
+};
+
+//同一线程取还,一次保持16个对象
+template<class Alloc>
+static void bench_local(std::ostream& os, const char* name, size_t ops) {
+    std::vector<typename Alloc::ptr> objs(16);
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < ops; ++i) {
+        auto& p = objs[i & 15];
+        Alloc::free(p);
+        p = Alloc::alloc();
+        p->id = i;
+    }
+    uint64_t used = now_ns() - begin;
+    for(auto& p : objs) {
+        Alloc::free(p);
+    }
+    os << "{\"alloc\": \"" << name << "\", \"ns_per_op\": " << (double)used / ops << "}";
+}
+
+//pairs对线程,每对一个分配一个释放,经SPSC队列传递
+template<class Alloc>
+static void bench_cross(std::ostream& os, const char* name, size_t pairs, size_t ops) {
+    std::vector<std::shared_ptr<MyServer::SPSCQueue<typename Alloc::ptr> > > queues;
+    for(size_t i = 0; i < pairs; ++i) {
+        queues.emplace_back(new MyServer::SPSCQueue<typename Alloc::ptr>(1024));
+    }
+    std::atomic<bool> go{false};
+    auto thrs = MyServer::Thread::CreateBatch(pairs * 2, [&](size_t i) {
+        auto& q = *queues[i / 2];
+        while(!go.load(std::memory_order_acquire)) {
+            sched_yield();
+        }
+        if(i % 2 == 0) {
+            for(size_t j = 0; j < ops; ++j) {
+                typename Alloc::ptr p = Alloc::alloc();
+                p->id = j;
+                while(!q.tryPush(std::move(p))) {
+                    sched_yield();
+                }
+            }
+        } else {
+            typename Alloc::ptr p;
+            for(size_t j = 0; j < ops; ++j) {
+                while(!q.tryPop(p)) {
+                    sched_yield();
+                }
+                Alloc::free(p);
+            }
+        }
+    }, "bench");
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"alloc\": \"" << name << "\", \"pairs\": " << pairs
+       << ", \"mops_per_sec\": " << (double)ops * pairs / used * 1e3 << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t ops = argc > 1 ? atoll(argv[1]) : 1000000;
+    size_t max_pairs = argc > 2 ? atoi(argv[2]) : 8;
+    std::ostream& os = std::cout;
+    const char* sep = "\n    ";
+    os << "{\n  \"same_thread\": [" << sep;
+    bench_local<NewDelete>(os, "new_delete", ops);
+    os << "," << sep;
+    bench_local<MakeShared>(os, "make_shared", ops);
+    os << "," << sep;
+    bench_local<Pool>(os, "ObjectPool", ops);
+    os << "\n  ],\n  \"cross_thread\": [";
+    for(size_t t = 1; t <= max_pairs; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_cross<NewDelete>(os, "new_delete", t, ops / t);
+        os << "," << sep;
+        bench_cross<MakeShared>(os, "make_shared", t, ops / t);
+        os << "," << sep;
+        bench_cross<Pool>(os, "ObjectPool", t, ops / t);
+    }
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "../MyServer/MyServer.h"
+#include <chrono>
+#include <iostream>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <stdlib.h>
+
+//队列性能测试: 生产者和消费者数量相同时的吞吐,对比加锁的std::deque,结果以JSON输出
+//用法: bench_queue [max_threads] [items]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//互斥量加std::deque,空时在条件变量上等待
+class MutexDeque {
+public:
+    typedef uint64_t value_type;
+
+    MutexDeque(size_t) {}
+
+    void push(uint64_t v) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(v);
+        }
+        m_cond.notify_one();
+    }
+
+    void pop(uint64_t& v) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]() { return !m_queue.empty();});
+        v = m_queue.front();
+        m_queue.pop_front();
+    }
+
+    template<class InputIterator>
+    void pushBatch(InputIterator first, size_t n) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.insert(m_queue.end(), first, first + n);
+        }
+        m_cond.notify_all();
+    }
+
+    template<class OutputIterator>
+    size_t popBatch(OutputIterator out, size_t max) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]() { return !m_queue.empty();});
+        size_t k = std::min(max, m_queue.size());
+        for(size_t i = 0; i < k; ++i, ++out) {
+            *out = m_queue.front();
+            m_queue.pop_front();
+        }
+        return k;
+    }
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<uint64_t> m_queue;
+};
+
+/**
+ * @brief producers个生产者各发送items/producers个值,consumers个消费者取完为止
+ * @param[in] batch 每次批量操作的数量,1表示逐个操作
+ */
+template<class Queue>
+static void bench_queue(std::ostream& os, const char* name, size_t producers
+                        ,size_t consumers, uint64_t items, size_t batch) {
+    Queue q(1024);
+    uint64_t per_producer = items / producers;
+    std::vector<MyServer::Thread::ptr> thrs;
+    std::atomic<bool> go{false};
+    for(size_t i = 0; i < consumers; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&q, &go, batch]() {
+            while(!go.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            std::vector<uint64_t> vals(batch);
+            while(true) {
+                size_t k = 1;
+                if(batch > 1) {
+                    k = q.popBatch(vals.begin(), batch);
+                } else {
+                    q.pop(vals[0]);
+                }
+                //0是结束标记,一次取到多个时把多余的放回去
+                size_t stops = 0;
+                for(size_t j = 0; j < k; ++j) {
+                    if(vals[j] == 0) {
+                        ++stops;
+                    }
+                }
+                if(stops) {
+                    for(size_t j = 1; j < stops; ++j) {
+                        q.push((uint64_t)0);
+                    }
+                    return;
+                }
+            }
+        }, "consumer_" + std::to_string(i))));
+    }
+    std::vector<MyServer::Thread::ptr> prods;
+    for(size_t i = 0; i < producers; ++i) {
+        prods.push_back(MyServer::Thread::ptr(new MyServer::Thread([&q, &go, batch, per_producer]() {
+            while(!go.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            std::vector<uint64_t> vals;
+            for(uint64_t j = 1; j <= per_producer; ++j) {
+                if(batch == 1) {
+                    q.push(j);
+                    continue;
+                }
+                vals.push_back(j);
+                if(vals.size() == batch || j == per_producer) {
+                    q.pushBatch(vals.begin(), vals.size());
+                    vals.clear();
+                }
+            }
+        }, "producer_" + std::to_string(i))));
+    }
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    for(auto& i : prods) {
+        i->join();
+    }
+    for(size_t i = 0; i < consumers; ++i) {
+        q.push((uint64_t)0);
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t used = now_ns() - begin;
+    os << "{\"queue\": \"" << name << "\", \"producers\": " << producers
+       << ", \"consumers\": " << consumers << ", \"batch\": " << batch
+       << ", \"mitems_per_sec\": " << (double)per_producer * producers / used * 1e3 << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t max_threads = argc > 1 ? atoi(argv[1]) : 32;
+    uint64_t items = argc > 2 ? atoll(argv[2]) : 1000000;
+    std::ostream& os = std::cout;
+    typedef MyServer::BlockingQueue<MyServer::MPMCQueue<uint64_t> > MPMC;
+    typedef MyServer::BlockingQueue<MyServer::MPSCQueue<uint64_t> > MPSC;
+    typedef MyServer::BlockingQueue<MyServer::SPSCQueue<uint64_t> > SPSC;
+
+    const char* sep = "\n    ";
+    os << "{\n  \"mpmc\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_queue<MPMC>(os, "MPMCQueue", t, t, items, 1);
+        os << "," << sep;
+        bench_queue<MPMC>(os, "MPMCQueue", t, t, items, 16);
+        os << "," << sep;
+        bench_queue<MutexDeque>(os, "MutexDeque", t, t, items, 1);
+        os << "," << sep;
+        bench_queue<MutexDeque>(os, "MutexDeque", t, t, items, 16);
+    }
+    os << "\n  ],\n  \"single_consumer\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        if(t == 1) {
+            bench_queue<SPSC>(os, "SPSCQueue", t, 1, items, 1);
+            os << "," << sep;
+        }
+        bench_queue<MPSC>(os, "MPSCQueue", t, 1, items, 1);
+        os << "," << sep;
+        bench_queue<MPMC>(os, "MPMCQueue", t, 1, items, 1);
+        os << "," << sep;
+        bench_queue<MutexDeque>(os, "MutexDeque", t, 1, items, 1);
+    }
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
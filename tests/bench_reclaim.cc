@@ -0,0 +1,175 @@
+#include "../MyServer/MyServer.h"
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+
+//延迟回收性能测试: 读者反复读取一个共享快照,一个写者每毫秒替换一次,
+//对比读锁加shared_ptr拷贝、shared_ptr原子读、Epoch临界区和风险指针的读吞吐,结果以JSON输出
+//用法: bench_reclaim [max_threads] [ms_per_case]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct alignas(64) PaddedCount {
+    uint64_t v = 0;
+};
+
+struct Snapshot {
+    uint64_t data[8] = {0};
+};
+
+//防止读取被优化掉
+static volatile uint64_t s_sink = 0;
+
+//读锁内拷贝shared_ptr,各处注册表现在的做法
+struct LockedShared {
+    MyServer::BRMutex mutex;
+    std::shared_ptr<Snapshot> ptr{new Snapshot};
+
+    template<class Cb>
+    void read(Cb cb) {
+        std::shared_ptr<Snapshot> p;
+        {
+            MyServer::BRMutex::ReadLock lock(mutex);
+            p = ptr;
+        }
+        cb(*p);
+    }
+    void update(uint64_t v) {
+        std::shared_ptr<Snapshot> p(new Snapshot);
+        p->data[0] = v;
+        MyServer::BRMutex::WriteLock lock(mutex);
+        ptr.swap(p);
+    }
+};
+
+struct AtomicShared {
+    std::shared_ptr<Snapshot> ptr{new Snapshot};
+
+    template<class Cb>
+    void read(Cb cb) {
+        std::shared_ptr<Snapshot> p = std::atomic_load_explicit(&ptr, std::memory_order_acquire);
+        cb(*p);
+    }
+    void update(uint64_t v) {
+        std::shared_ptr<Snapshot> p(new Snapshot);
+        p->data[0] = v;
+        std::atomic_store_explicit(&ptr, p, std::memory_order_release);
+    }
+};
+
+struct EpochShared {
+    std::atomic<Snapshot*> ptr{new Snapshot};
+
+    ~EpochShared() {
+        MyServer::Epoch::Synchronize();
+        delete ptr.load();
+    }
+    template<class Cb>
+    void read(Cb cb) {
+        MyServer::Epoch::Guard guard;
+        cb(*ptr.load(std::memory_order_acquire));
+    }
+    void update(uint64_t v) {
+        Snapshot* p = new Snapshot;
+        p->data[0] = v;
+        MyServer::Epoch::Retire(ptr.exchange(p, std::memory_order_acq_rel));
+    }
+};
+
+struct HazardShared {
+    std::atomic<Snapshot*> ptr{new Snapshot};
+
+    ~HazardShared() {
+        MyServer::HazardPointer::Scan();
+        delete ptr.load();
+    }
+    template<class Cb>
+    void read(Cb cb) {
+        MyServer::HazardPointer hp;
+        cb(*hp.protect(ptr));
+    }
+    void update(uint64_t v) {
+        Snapshot* p = new Snapshot;
+        p->data[0] = v;
+        MyServer::HazardPointer::Retire(ptr.exchange(p, std::memory_order_acq_rel));
+    }
+};
+
+template<class Shared>
+static void bench_read(std::ostream& os, const char* name, size_t threads, int ms) {
+    Shared shared;
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<PaddedCount> ops(threads);
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(size_t i = 0; i < threads; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i]() {
+            while(!go.load(std::memory_order_acquire)) {
+                sched_yield();
+            }
+            uint64_t n = 0;
+            uint64_t sum = 0;
+            while(!stop.load(std::memory_order_relaxed)) {
+                shared.read([&sum](const Snapshot& s) {
+                    for(int j = 0; j < 8; ++j) {
+                        sum += s.data[j];
+                    }
+                });
+                ++n;
+            }
+            ops[i].v = n;
+            s_sink = sum;
+        }, "reader_" + std::to_string(i))));
+    }
+    MyServer::Thread::ptr writer(new MyServer::Thread([&]() {
+        while(!go.load(std::memory_order_acquire)) {
+            sched_yield();
+        }
+        uint64_t v = 0;
+        while(!stop.load(std::memory_order_relaxed)) {
+            shared.update(++v);
+            usleep(1000);
+        }
+    }, "writer"));
+    uint64_t begin = now_ns();
+    go.store(true, std::memory_order_release);
+    usleep(ms * 1000);
+    stop.store(true, std::memory_order_relaxed);
+    for(auto& i : thrs) {
+        i->join();
+    }
+    writer->join();
+    uint64_t used = now_ns() - begin;
+    uint64_t total = 0;
+    for(auto& i : ops) {
+        total += i.v;
+    }
+    os << "{\"reclaim\": \"" << name << "\", \"threads\": " << threads
+       << ", \"mops_per_sec\": " << (double)total / used * 1e3 << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t max_threads = argc > 1 ? atoi(argv[1]) : 32;
+    int ms = argc > 2 ? atoi(argv[2]) : 200;
+    std::ostream& os = std::cout;
+    const char* sep = "\n    ";
+    os << "{\n  \"read_mostly\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_read<LockedShared>(os, "brmutex_shared_ptr", t, ms);
+        os << "," << sep;
+        bench_read<AtomicShared>(os, "atomic_shared_ptr", t, ms);
+        os << "," << sep;
+        bench_read<EpochShared>(os, "epoch", t, ms);
+        os << "," << sep;
+        bench_read<HazardShared>(os, "hazard_pointer", t, ms);
+    }
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/scheduler.h"
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+
+//调度器性能测试: 任务吞吐和提交到开始执行的延迟,结果以JSON输出
+//用法: bench_scheduler [max_threads]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//外部线程提交空任务的吞吐
+static void bench_external(std::ostream& os, size_t threads) {
+    const size_t tasks = 1000000;
+    MyServer::Scheduler sc(threads, "bench");
+    sc.start();
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < tasks; ++i) {
+        sc.schedule([]() {});
+    }
+    sc.stop();
+    uint64_t used = now_ns() - begin;
+    os << "{\"threads\": " << threads << ", \"tasks\": " << tasks
+       << ", \"mtasks_per_sec\": " << (double)tasks / used * 1e3 << "}";
+}
+
+//worker内部递归提交(分治),主要走本地队列和窃取
+static void spawn_tree(MyServer::Scheduler* sc, int depth) {
+    if(depth == 0) {
+        return;
+    }
+    sc->schedule(std::bind(&spawn_tree, sc, depth - 1));
+    sc->schedule(std::bind(&spawn_tree, sc, depth - 1));
+}
+
+static void bench_internal(std::ostream& os, size_t threads) {
+    const int depth = 20;
+    MyServer::Scheduler sc(threads, "bench");
+    sc.start();
+    uint64_t begin = now_ns();
+    sc.schedule(std::bind(&spawn_tree, &sc, depth));
+    sc.stop();
+    uint64_t used = now_ns() - begin;
+    double tasks = (1 << (depth + 1)) - 1;
+    os << "{\"threads\": " << threads << ", \"tasks\": " << (size_t)tasks
+       << ", \"mtasks_per_sec\": " << tasks / used * 1e3 << "}";
+}
+
+//提交到开始执行的延迟,每次提交时worker都处于空闲状态,包含唤醒的开销
+static void bench_latency(std::ostream& os, size_t threads) {
+    const size_t samples = 20000;
+    MyServer::Scheduler sc(threads, "bench");
+    sc.start();
+    std::vector<uint64_t> lat(samples);
+    MyServer::Semaphore sem;
+    for(size_t i = 0; i < samples; ++i) {
+        uint64_t submit = now_ns();
+        sc.schedule([&lat, &sem, i, submit]() {
+            lat[i] = now_ns() - submit;
+            sem.notify();
+        });
+        sem.wait();
+    }
+    sc.stop();
+    std::sort(lat.begin(), lat.end());
+    os << "{\"threads\": " << threads
+       << ", \"p50_us\": " << lat[samples / 2] / 1e3
+       << ", \"p99_us\": " << lat[samples * 99 / 100] / 1e3
+       << ", \"max_us\": " << lat.back() / 1e3 << "}";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    std::ostream& os = std::cout;
+
+    const char* sep = "\n    ";
+    os << "{\n  \"external_submit\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_external(os, t);
+    }
+    os << "\n  ],\n  \"internal_spawn\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_internal(os, t);
+    }
+    os << "\n  ],\n  \"submit_to_start\": [";
+    for(size_t t = 1; t <= max_threads; t *= 2) {
+        os << (t == 1 ? "" : ",") << sep;
+        bench_latency(os, t);
+    }
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
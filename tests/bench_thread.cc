@@ -0,0 +1,154 @@
+#include "../MyServer/MyServer.h"
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <sched.h>
+
+//线程性能测试,结果以JSON输出
+//pingpong: 两个线程通过共享变量来回传递的往返延迟,对比不绑定、绑在同一个CPU和绑在不同CPU
+//spawn: 创建一组线程直到全部就绪的耗时,对比逐个创建、批量创建和预先创建后放行
+//用法: bench_thread [rounds] [spawn_threads]
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//等待flag变成v,自旋一段时间后让出CPU,两个线程在同一个CPU上时也能推进
+static void wait_for(std::atomic<uint64_t>& flag, uint64_t v) {
+    int spins = 0;
+    while(flag.load(std::memory_order_acquire) != v) {
+        if(++spins < 1000) {
+            MyServer::CpuRelax();
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * @brief ping线程写入奇数,pong线程回写偶数,ping记录每次往返的时间
+ * @param[in] ping_cpus ping线程绑定的CPU,为空不绑定
+ * @param[in] pong_cpus pong线程绑定的CPU,为空不绑定
+ */
+static void bench_pingpong(std::ostream& os, const char* name, const std::vector<int>& ping_cpus
+                           ,const std::vector<int>& pong_cpus, size_t rounds) {
+    alignas(64) std::atomic<uint64_t> flag{0};
+    std::vector<uint64_t> samples(rounds);
+    MyServer::ThreadOptions ping_opts;
+    ping_opts.cpus = ping_cpus;
+    MyServer::ThreadOptions pong_opts;
+    pong_opts.cpus = pong_cpus;
+
+    MyServer::Thread::ptr pong(new MyServer::Thread([&flag, rounds]() {
+        for(uint64_t i = 0; i < rounds; ++i) {
+            wait_for(flag, i * 2 + 1);
+            flag.store(i * 2 + 2, std::memory_order_release);
+        }
+    }, "pong", pong_opts));
+    MyServer::Thread::ptr ping(new MyServer::Thread([&flag, &samples, rounds]() {
+        for(uint64_t i = 0; i < rounds; ++i) {
+            uint64_t begin = now_ns();
+            flag.store(i * 2 + 1, std::memory_order_release);
+            wait_for(flag, i * 2 + 2);
+            samples[i] = now_ns() - begin;
+        }
+    }, "ping", ping_opts));
+    ping->join();
+    pong->join();
+
+    std::sort(samples.begin(), samples.end());
+    os << "{\"case\": \"" << name << "\", \"rounds\": " << rounds
+       << ", \"p50_ns\": " << samples[rounds / 2]
+       << ", \"p99_ns\": " << samples[rounds * 99 / 100]
+       << ", \"max_ns\": " << samples.back() << "}";
+}
+
+/**
+ * @brief 创建threads个线程直到全部就绪,重复多次取中位数
+ * @details 线程执行空函数,统计的时间不包括join
+ */
+static void bench_spawn(std::ostream& os, size_t threads) {
+    const int repeat = 20;
+    std::vector<uint64_t> one, batch, prepared;
+    for(int r = 0; r < repeat; ++r) {
+        //逐个创建,每个构造函数都等待线程就绪
+        uint64_t begin = now_ns();
+        std::vector<MyServer::Thread::ptr> thrs;
+        for(size_t i = 0; i < threads; ++i) {
+            thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([]() {}
+                            ,"one_" + std::to_string(i))));
+        }
+        one.push_back(now_ns() - begin);
+        for(auto& i : thrs) {
+            i->join();
+        }
+
+        begin = now_ns();
+        thrs = MyServer::Thread::CreateBatch(threads, [](size_t) {}, "batch");
+        batch.push_back(now_ns() - begin);
+        for(auto& i : thrs) {
+            i->join();
+        }
+
+        //预先创建的开销在启动阶段,只统计放行
+        MyServer::ThreadGroup group("pre", MyServer::ThreadOptions(), threads, false);
+        group.prepare();
+        begin = now_ns();
+        group.start([](size_t) {});
+        prepared.push_back(now_ns() - begin);
+        group.join();
+    }
+    std::sort(one.begin(), one.end());
+    std::sort(batch.begin(), batch.end());
+    std::sort(prepared.begin(), prepared.end());
+    const char* sep = "\n    ";
+    os << "[" << sep << "{\"mode\": \"one_by_one\", \"threads\": " << threads
+       << ", \"us\": " << one[repeat / 2] / 1e3 << "}," << sep
+       << "{\"mode\": \"batch\", \"threads\": " << threads
+       << ", \"us\": " << batch[repeat / 2] / 1e3 << "}," << sep
+       << "{\"mode\": \"prepared\", \"threads\": " << threads
+       << ", \"us\": " << prepared[repeat / 2] / 1e3 << "}\n  ]";
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t rounds = argc > 1 ? atoi(argv[1]) : 100000;
+    if(rounds == 0) {
+        rounds = 1;
+    }
+    size_t spawn_threads = argc > 2 ? atoi(argv[2]) : 64;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    std::vector<int> cpus;
+    for(int i = 0; i < CPU_SETSIZE; ++i) {
+        if(CPU_ISSET(i, &set)) {
+            cpus.push_back(i);
+        }
+    }
+    std::ostream& os = std::cout;
+    const char* sep = "\n    ";
+    os << "{\n  \"cpus\": " << cpus.size() << ",\n  \"pingpong\": [" << sep;
+    bench_pingpong(os, "unpinned", {}, {}, rounds);
+    os << "," << sep;
+    bench_pingpong(os, "same_cpu", {cpus[0]}, {cpus[0]}, rounds);
+    if(cpus.size() > 1) {
+        os << "," << sep;
+        bench_pingpong(os, "cross_cpu", {cpus[0]}, {cpus[1]}, rounds);
+    }
+    //两个NUMA节点之间
+    std::vector<int> node1 = MyServer::GetNumaNodeCpus(1);
+    if(!node1.empty()) {
+        std::vector<int> node0 = MyServer::GetNumaNodeCpus(0);
+        if(!node0.empty()) {
+            os << "," << sep;
+            bench_pingpong(os, "cross_node", {node0[0]}, {node1[0]}, rounds);
+        }
+    }
+    os << "\n  ],\n  \"spawn\": ";
+    bench_spawn(os, spawn_threads);
+    os << "\n}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/timer.h"
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <vector>
+#include <random>
+#include <stdlib.h>
+
+//定时器性能测试: 大量定时器下的添加、刷新、取消和到期处理,
+//以std::set实现的最小堆作为对照,结果以JSON输出
+//用法: bench_timer [timers]   timers默认1000000
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class BenchTimerManager : public MyServer::TimerManager {
+protected:
+    void onTimerInsertedAtFront() override {}
+};
+
+static void report(std::ostream& os, const char* impl, const char* op, size_t count, uint64_t used) {
+    os << "{\"impl\": \"" << impl << "\", \"op\": \"" << op << "\", \"count\": " << count
+       << ", \"ns_per_op\": " << (double)used / count << "}";
+}
+
+//连接超时的典型用法: 大量长超时定时器,随机refresh(keepalive)和cancel+add(连接关闭/新建)
+static void bench_wheel(std::ostream& os, size_t count) {
+    std::mt19937 rng(1);
+    BenchTimerManager tm;
+    std::vector<MyServer::Timer::ptr> timers(count);
+
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        timers[i] = tm.addTimer(10000 + rng() % 50000, []() {});
+    }
+    report(os, "wheel", "add", count, now_ns() - begin);
+    os << ",\n    ";
+
+    begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        timers[rng() % count]->refresh();
+    }
+    report(os, "wheel", "refresh", count, now_ns() - begin);
+    os << ",\n    ";
+
+    begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        size_t idx = rng() % count;
+        timers[idx]->cancel();
+        timers[idx] = tm.addTimer(10000 + rng() % 50000, []() {});
+    }
+    report(os, "wheel", "cancel_add", count, now_ns() - begin);
+    os << ",\n    ";
+
+    begin = now_ns();
+    uint64_t next = 0;
+    for(size_t i = 0; i < 100000; ++i) {
+        next += tm.getNextTimer();
+    }
+    report(os, "wheel", "next_timer", 100000, now_ns() - begin);
+    os << ",\n    ";
+
+    begin = now_ns();
+    for(auto& i : timers) {
+        i->cancel();
+    }
+    timers.clear();
+    report(os, "wheel", "cancel", count, now_ns() - begin);
+}
+
+//到期处理: 定时器分布在1秒内,不断推进直到全部触发
+static void bench_expire(std::ostream& os, size_t count) {
+    std::mt19937 rng(2);
+    BenchTimerManager tm;
+    size_t fired = 0;
+    for(size_t i = 0; i < count; ++i) {
+        tm.addTimer(rng() % 1000, [&fired]() { ++fired; });
+    }
+    uint64_t used = 0;
+    std::vector<std::function<void()> > cbs;
+    while(tm.hasTimer()) {
+        uint64_t begin = now_ns();
+        cbs.clear();
+        tm.listExpiredCb(cbs);
+        used += now_ns() - begin;
+        for(auto& cb : cbs) {
+            cb();
+        }
+        usleep(1000);
+    }
+    report(os, "wheel", "expire", fired, used);
+}
+
+//对照: std::set按(到期时间, id)排序
+static void bench_set(std::ostream& os, size_t count) {
+    typedef std::set<std::pair<uint64_t, size_t> > TimerSet;
+    std::mt19937 rng(1);
+    TimerSet timers;
+    std::vector<TimerSet::iterator> its(count);
+    uint64_t now = MyServer::GetCurrentMS();
+
+    uint64_t begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        its[i] = timers.insert(std::make_pair(now + 10000 + rng() % 50000, i)).first;
+    }
+    report(os, "set", "add", count, now_ns() - begin);
+    os << ",\n    ";
+
+    begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        size_t idx = rng() % count;
+        uint64_t ms = its[idx]->first;
+        timers.erase(its[idx]);
+        its[idx] = timers.insert(std::make_pair(ms + 1, idx)).first;
+    }
+    report(os, "set", "refresh", count, now_ns() - begin);
+    os << ",\n    ";
+
+    begin = now_ns();
+    for(size_t i = 0; i < count; ++i) {
+        timers.erase(its[i]);
+    }
+    report(os, "set", "cancel", count, now_ns() - begin);
+}
+
+int main(int argc, char** argv) {
+    MYSERVER_LOG_ROOT()->setLevel(MyServer::LogLevel::ERROR);
+    size_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    std::ostream& os = std::cout;
+    os << "{\n  \"timers\": " << count << ",\n  \"results\": [\n    ";
+    bench_wheel(os, count);
+    os << ",\n    ";
+    bench_expire(os, count);
+    os << ",\n    ";
+    bench_set(os, count);
+    os << "\n  ]\n}" << std::endl;
+    return 0;
+}
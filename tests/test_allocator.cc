@@ -0,0 +1,105 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/allocator.h"
+#include <assert.h>
+#include <map>
+#include <string.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+typedef MyServer::SlabAllocator Slab;
+
+//每个大小都落在不小于它的最小类别上
+void test_size_class() {
+    assert(Slab::ClassSize(Slab::CLASS_COUNT - 1) == Slab::MAX_SIZE);
+    for(size_t size = 1; size <= Slab::MAX_SIZE; ++size) {
+        size_t cls = Slab::SizeClass(size);
+        assert(cls < Slab::CLASS_COUNT);
+        assert(Slab::ClassSize(cls) >= size);
+        assert(cls == 0 || Slab::ClassSize(cls - 1) < size);
+        assert(Slab::ClassSize(cls) % 16 == 0);
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_size_class ok";
+}
+
+//写满对象再检查,对象之间不重叠;统计与分配释放次数一致
+void test_alloc_free() {
+    MyServer::SlabStats before = Slab::GetStats();
+    std::vector<std::pair<char*, size_t> > objs;
+    for(int i = 0; i < 20000; ++i) {
+        size_t size = 1 + (i * 37) % 5000;
+        char* p = (char*)Slab::Allocate(size);
+        assert(((uintptr_t)p & 15) == 0);
+        memset(p, i & 0xff, size);
+        objs.push_back(std::make_pair(p, size));
+    }
+    for(size_t i = 0; i < objs.size(); ++i) {
+        for(size_t j = 0; j < objs[i].second; j += 97) {
+            assert((unsigned char)objs[i].first[j] == (i & 0xff));
+        }
+    }
+    MyServer::SlabStats mid = Slab::GetStats();
+    assert(mid.inUseBytes() > before.inUseBytes());
+    for(auto& i : objs) {
+        Slab::Deallocate(i.first, i.second);
+    }
+    MyServer::SlabStats after = Slab::GetStats();
+    assert(after.inUseBytes() == before.inUseBytes());
+    assert(after.largeAllocs - before.largeAllocs == after.largeFrees - before.largeFrees);
+    assert(after.largeAllocs > before.largeAllocs);
+    MYSERVER_LOG_INFO(g_logger) << "test_alloc_free ok\n" << after.toYamlString();
+}
+
+//一个线程分配,另一个线程释放
+void test_cross_thread() {
+    MyServer::MPMCQueue<char*> q(1024);
+    const int count = 200000;
+    auto thrs = MyServer::Thread::CreateBatch(2, [&q](size_t i) {
+        char* p = nullptr;
+        for(int j = 0; j < count; ++j) {
+            if(i == 0) {
+                p = (char*)Slab::Allocate(48);
+                memset(p, j & 0xff, 48);
+                while(!q.tryPush(p)) {
+                    sched_yield();
+                }
+            } else {
+                while(!q.tryPop(p)) {
+                    sched_yield();
+                }
+                assert((unsigned char)p[47] == (j & 0xff));
+                Slab::Deallocate(p, 48);
+            }
+        }
+    }, "slab");
+    for(auto& i : thrs) {
+        i->join();
+    }
+    MyServer::SlabStats stats = Slab::GetStats();
+    auto& c = stats.classes[Slab::SizeClass(48)];
+    assert(c.allocs == c.frees);
+    MYSERVER_LOG_INFO(g_logger) << "test_cross_thread ok central_free=" << c.centralFree;
+}
+
+//STL容器和字符串
+void test_stl() {
+    std::vector<int, MyServer::SlabStlAllocator<int> > v;
+    for(int i = 0; i < 10000; ++i) {
+        v.push_back(i);
+    }
+    assert(v[9999] == 9999);
+    std::map<int, MyServer::SlabString, std::less<int>
+             ,MyServer::SlabStlAllocator<std::pair<const int, MyServer::SlabString> > > m;
+    for(int i = 0; i < 1000; ++i) {
+        m[i] = MyServer::SlabString("value_with_some_length_") + std::to_string(i).c_str();
+    }
+    assert(m[500] == "value_with_some_length_500");
+    MYSERVER_LOG_INFO(g_logger) << "test_stl ok";
+}
+
+int main(int argc, char** argv) {
+    test_size_class();
+    test_alloc_free();
+    test_cross_thread();
+    test_stl();
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/arena.h"
+#include <assert.h>
+#include <map>
+#include <string.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+//分配连续、对齐,reset后块回到线程缓存再被复用
+void test_bump() {
+    MyServer::Arena arena(4096);
+    char* last = nullptr;
+    for(int i = 0; i < 1000; ++i) {
+        char* p = (char*)arena.alloc(1 + i % 100, 8);
+        assert(((uintptr_t)p & 7) == 0);
+        assert(arena.contains(p));
+        memset(p, i & 0xff, 1 + i % 100);
+        last = p;
+    }
+    assert((unsigned char)last[0] == (999 & 0xff));
+    assert(arena.getBlockCount() > 1);
+    void* big = arena.alloc(100000, 64);
+    assert(((uintptr_t)big & 63) == 0);
+    assert(arena.contains(big));
+    memset(big, 0, 100000);
+
+    size_t count = arena.getBlockCount();
+    arena.reset();
+    assert(arena.getBlockCount() == 1 && arena.getAllocated() == 0);
+    assert(!arena.contains(big));
+    //同样的分配序列用回之前的块
+    for(int i = 0; i < 1000; ++i) {
+        arena.alloc(1 + i % 100, 8);
+    }
+    assert(arena.getBlockCount() == count - 1);
+    MYSERVER_LOG_INFO(g_logger) << "test_bump ok blocks=" << arena.getBlockCount()
+        << " capacity=" << arena.getCapacity();
+}
+
+struct Counted {
+    Counted(int& c) :count(c) { ++count;}
+    ~Counted() { --count;}
+    int& count;
+};
+
+//create构造的对象在reset时析构
+void test_create() {
+    int alive = 0;
+    {
+        MyServer::Arena arena;
+        for(int i = 0; i < 100; ++i) {
+            arena.create<Counted>(alive);
+        }
+        int* n = arena.create<int>(5);
+        assert(*n == 5);
+        assert(alive == 100);
+        arena.reset();
+        assert(alive == 0);
+        arena.create<Counted>(alive);
+        assert(alive == 1);
+    }
+    assert(alive == 0);
+    MYSERVER_LOG_INFO(g_logger) << "test_create ok";
+}
+
+//STL容器放在arena里
+void test_stl() {
+    MyServer::Arena arena;
+    {
+        std::pmr::vector<std::pmr::string> v(&arena);
+        std::pmr::map<int, std::pmr::string> m(&arena);
+        for(int i = 0; i < 1000; ++i) {
+            v.emplace_back("a string that does not fit into sso ");
+            m.emplace(i, "value_with_some_length_" + std::to_string(i));
+        }
+        assert(v[999].size() == 36);
+        assert(arena.contains(v.data()) && arena.contains(v[0].data()));
+        assert(m[500] == "value_with_some_length_500");
+
+        std::vector<int, MyServer::ArenaAllocator<int> > iv{MyServer::ArenaAllocator<int>(&arena)};
+        for(int i = 0; i < 10000; ++i) {
+            iv.push_back(i);
+        }
+        assert(iv[9999] == 9999);
+        assert(arena.contains(iv.data()));
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_stl ok allocated=" << arena.getAllocated();
+}
+
+//把格式化后的日志保存到arena里的appender
+class ArenaAppender : public MyServer::LogAppender {
+public:
+    ArenaAppender(std::pmr::vector<std::pmr::string>& out)
+        :m_out(out) {
+    }
+    void log(std::shared_ptr<MyServer::Logger> logger, MyServer::LogLevel::Level level, MyServer::LogEvent::ptr event) override {
+        m_out.emplace_back(getFormatter()->format(logger, level, event));
+    }
+    std::string toYamlString() override { return "";}
+private:
+    std::pmr::vector<std::pmr::string>& m_out;
+};
+
+//一次请求的日志事件在arena中构造,请求结束时随arena一起释放
+void test_log_event() {
+    MyServer::Logger::ptr logger(new MyServer::Logger("arena"));
+    MyServer::Arena arena;
+    std::pmr::vector<std::pmr::string> lines(&arena);
+    MyServer::LogAppender::ptr appender(new ArenaAppender(lines));
+    appender->setFormatter(MyServer::LogFormatter::ptr(new MyServer::LogFormatter("%p %f:%l %m")));
+    logger->addAppender(appender);
+
+    for(int round = 0; round < 3; ++round) {
+        for(int i = 0; i < 10; ++i) {
+            auto event = std::allocate_shared<MyServer::LogEvent>(
+                    MyServer::ArenaAllocator<MyServer::LogEvent>(&arena), logger
+                    ,MyServer::LogLevel::INFO, __FILE__, __LINE__, 0
+                    ,MyServer::GetThreadId(), MyServer::GetFiberId(), time(0));
+            assert(arena.contains(event.get()));
+            event->getSS() << "request " << i;
+            logger->log(MyServer::LogLevel::INFO, event);
+        }
+        assert(lines.size() == 10);
+        assert(arena.contains(lines[9].data()));
+        assert(lines[9].find("INFO") == 0);
+        assert(lines[9].find("request 9") != std::pmr::string::npos);
+        //请求结束,清空容器后整个arena复用
+        lines.clear();
+        lines.shrink_to_fit();
+        size_t blocks = arena.getBlockCount();
+        arena.reset();
+        assert(arena.getBlockCount() == 1);
+        MYSERVER_LOG_INFO(g_logger) << "round " << round << " blocks=" << blocks;
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_log_event ok";
+}
+
+int main(int argc, char** argv) {
+    test_bump();
+    test_create();
+    test_stl();
+    test_log_event();
+    return 0;
+}
@@ -2,6 +2,10 @@
 #include "../MyServer/log.h"
 #include <yaml-cpp/yaml.h>
 #include <iostream>
+#include <assert.h>
+#include <unistd.h>
+#include <set>
+#include "../MyServer/thread.h"
 
 
 MyServer::ConfigVar<int>::ptr g_int_value_config = 
@@ -212,7 +216,110 @@ void test_log() {
     MYSERVER_LOG_INFO(system_log) << "hello system" << std::endl;
 }
 
+MyServer::ConfigVar<int>::ptr g_txn_a =
+    MyServer::Config::Lookup("txn.a", (int)1, "txn a");
+
+MyServer::ConfigVar<int>::ptr g_txn_b =
+    MyServer::Config::Lookup("txn.b", (int)1, "txn b");
+
+//一次LoadFromYaml里的参数一起提交,监听回调里能看到同一批次的所有新值
+void test_transaction() {
+    int seen_b = 0;
+    g_txn_a->addListener(20, [&seen_b](const int& old_value, const int& new_value){
+        seen_b = g_txn_b->getValue();
+    });
+    MyServer::Config::LoadFromYaml(YAML::Load("txn:\n  a: 2\n  b: 3\n"));
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "txn.a listener seen txn.b=" << seen_b;
+    assert(seen_b == 3);
+
+    //后台分发,reload线程不等待回调
+    MyServer::Config::SetListenerAsync(true);
+    g_txn_b->addListener(21, [](const int& old_value, const int& new_value){
+        usleep(20 * 1000);
+    });
+    uint64_t begin = MyServer::GetCurrentMS();
+    MyServer::Config::LoadFromYaml(YAML::Load("txn:\n  a: 4\n  b: 5\n"));
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "async reload used " << MyServer::GetCurrentMS() - begin << "ms";
+    MyServer::Config::FlushListeners();
+    assert(seen_b == 5);
+    for(auto& i : MyServer::Config::GetListenerStats()) {
+        MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "listener name=" << i.name << " key=" << i.key
+            << " elapse=" << i.elapse_us << "us";
+    }
+    MyServer::Config::SetListenerAsync(false);
+    g_txn_a->delListener(20);
+    g_txn_b->delListener(21);
+}
+
+void test_cache() {
+    static thread_local MyServer::ConfigVarCache<int> s_txn_a(g_txn_a);
+    int v = s_txn_a.getValue();
+    g_txn_a->setValue(v + 1);
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "cache before=" << v << " after=" << s_txn_a.getValue()
+        << " epoch=" << MyServer::ConfigVarBase::GetEpoch();
+    assert(s_txn_a.getValue() == v + 1);
+}
+
+#define SCHEMA_FIELDS(XX) \
+    XX(int, port, "schema.port", 8080, "schema port") \
+    XX(std::string, name, "schema.name", "myserver", "schema name") \
+    XX(std::vector<int>, ids, "schema.ids", (std::vector<int>{1, 2}), "schema ids")
+MYSERVER_CONFIG_SCHEMA(SchemaConfig, SCHEMA_FIELDS)
+#undef SCHEMA_FIELDS
+
+void test_schema() {
+    SchemaConfig conf = SchemaConfig::Get();
+    assert(conf.port == 8080 && conf.name == "myserver" && conf.ids.size() == 2);
+
+    MyServer::Config::LoadFromYaml(YAML::Load("schema:\n  port: 9900\n  ids: [5, 6, 7]\n"));
+    conf.load();
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "schema port=" << conf.port << " name=" << conf.name
+        << " ids=" << SchemaConfig::ids_var()->toString();
+    assert(conf.port == 9900 && conf.ids.size() == 3);
+    assert(MyServer::Config::Lookup<int>("schema.port") == SchemaConfig::port_var());
+}
+
+MyServer::ConfigVar<int>::ptr g_concurrent =
+    MyServer::Config::Lookup("concurrent.value", (int)0, "concurrent value");
+
+//并发setValue时每次回调拿到的旧值各不相同,串起来正好是写入的顺序
+void test_concurrent_set() {
+    MyServer::Spinlock mutex;
+    std::vector<std::pair<int, int> > changes;
+    g_concurrent->addListener(30, [&mutex, &changes](const int& old_value, const int& new_value){
+        MyServer::Spinlock::Lock lock(mutex);
+        changes.push_back(std::make_pair(old_value, new_value));
+    });
+    const int count = 20000;
+    auto thrs = MyServer::Thread::CreateBatch(4, [](size_t i) {
+        for(int j = 1; j <= count; ++j) {
+            g_concurrent->setValue(i * count + j);
+        }
+    }, "set");
+    for(auto& i : thrs) {
+        i->join();
+    }
+    g_concurrent->delListener(30);
+    assert(changes.size() == 4 * count);
+    std::map<int, int> next;
+    for(auto& i : changes) {
+        assert(next.insert(i).second);
+    }
+    int v = 0;
+    for(size_t i = 0; i < changes.size(); ++i) {
+        auto it = next.find(v);
+        assert(it != next.end());
+        v = it->second;
+    }
+    assert(v == g_concurrent->getValue());
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "test_concurrent_set ok";
+}
+
 int main(int argc, char** argv) {
+    test_transaction();
+    test_concurrent_set();
+    test_cache();
+    test_schema();
     //test_config();
     //test_class();
     //test_yaml();
@@ -0,0 +1,69 @@
+#include "../MyServer/config.h"
+#include "../MyServer/config_shm.h"
+#include "../MyServer/log.h"
+#include <assert.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+MyServer::ConfigVar<int>::ptr g_workers =
+    MyServer::Config::Lookup("shm.workers", (int)4, "shm workers");
+
+MyServer::ConfigVar<std::vector<std::string> >::ptr g_hosts =
+    MyServer::Config::Lookup("shm.hosts", std::vector<std::string>{"a"}, "shm hosts");
+
+static const std::string s_name = "/myserver_test_config_shm";
+
+//worker进程: 只读映射,等待两个版本
+static int run_worker() {
+    MyServer::ConfigShm::ptr shm = MyServer::ConfigShm::Attach(s_name);
+    if(!shm || !shm->sync()) {
+        return 1;
+    }
+    if(g_workers->getValue() != 8 || g_hosts->getValue().size() != 2) {
+        return 2;
+    }
+    uint64_t begin = MyServer::GetCurrentMS();
+    while(!shm->sync()) {
+        if(MyServer::GetCurrentMS() - begin > 3000) {
+            return 3;
+        }
+        usleep(1000);
+    }
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "worker pid=" << getpid() << " version=" << shm->getVersion()
+        << " shm.workers=" << g_workers->getValue();
+    return g_workers->getValue() == 16 ? 0 : 4;
+}
+
+void test_shm() {
+    MyServer::ConfigShm::ptr shm = MyServer::ConfigShm::Create(s_name, 64 * 1024);
+    assert(shm);
+    MyServer::Config::LoadFromYaml(YAML::Load("shm:\n  workers: 8\n  hosts: [h1, h2]\n"));
+    assert(shm->publish());
+    assert(shm->getVersion() == 1);
+
+    std::vector<pid_t> pids;
+    for(int i = 0; i < 3; ++i) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            _exit(run_worker());
+        }
+        pids.push_back(pid);
+    }
+
+    usleep(50 * 1000);
+    g_workers->setValue(16);
+    assert(shm->publish());
+
+    for(auto pid : pids) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "worker pid=" << pid << " exit=" << WEXITSTATUS(status);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    MyServer::ConfigShm::Unlink(s_name);
+}
+
+int main(int argc, char** argv) {
+    test_shm();
+    return 0;
+}
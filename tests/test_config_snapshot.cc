@@ -0,0 +1,85 @@
+#include "../MyServer/config.h"
+#include "../MyServer/config_snapshot.h"
+#include "../MyServer/log.h"
+#include <fstream>
+#include <assert.h>
+
+MyServer::ConfigVar<int>::ptr g_port =
+    MyServer::Config::Lookup("snapshot.port", (int)8080, "snapshot port");
+
+MyServer::ConfigVar<double>::ptr g_ratio =
+    MyServer::Config::Lookup("snapshot.ratio", (double)0.5, "snapshot ratio");
+
+MyServer::ConfigVar<std::vector<int> >::ptr g_vec =
+    MyServer::Config::Lookup("snapshot.vec", std::vector<int>{1, 2}, "snapshot vec");
+
+static void write_file(const std::string& file, const std::string& content) {
+    std::ofstream ofs(file, std::ios::trunc);
+    ofs << content;
+}
+
+void test_snapshot() {
+    const std::string yaml_file = "/tmp/myserver_test_snapshot.yml";
+    const std::string snap_file = "/tmp/myserver_test_snapshot.bin";
+    write_file(yaml_file, "snapshot:\n  port: 9900\n  ratio: 0.25\n  vec: [3, 4, 5]\n");
+
+    assert(MyServer::ConfigSnapshot::Compile(yaml_file, snap_file));
+
+    MyServer::ConfigSnapshot snapshot;
+    assert(snapshot.open(snap_file));
+    assert(snapshot.isFresh(yaml_file));
+    //snapshot, snapshot.port, snapshot.ratio, snapshot.vec
+    assert(snapshot.size() == 4);
+    //port和ratio是已注册的基础类型
+    assert(snapshot.getBinaryCount() == 2);
+    assert(snapshot.apply() == 3);
+
+    std::string value;
+    assert(snapshot.find("snapshot.port", value) && value == "9900");
+    assert(!snapshot.find("snapshot.none", value));
+
+    MyServer::Config::LoadFromFile(yaml_file, snap_file);
+    assert(g_port->getValue() == 9900);
+    assert(g_ratio->getValue() == 0.25);
+    assert(g_vec->getValue() == std::vector<int>({3, 4, 5}));
+
+    //源文件修改后快照失效,回退到解析YAML
+    write_file(yaml_file, "snapshot:\n  port: 7000\n");
+    assert(!snapshot.isFresh(yaml_file));
+    MyServer::Config::LoadFromFile(yaml_file, snap_file);
+    assert(g_port->getValue() == 7000);
+
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "test_snapshot ok";
+}
+
+//编译工具没有业务参数时,按schema注册后同样保存二进制值
+void test_schema() {
+    const std::string schema_file = "/tmp/myserver_test_schema.yml";
+    const std::string yaml_file = "/tmp/myserver_test_schema_conf.yml";
+    const std::string snap_file = "/tmp/myserver_test_schema.bin";
+    write_file(schema_file, "svc:\n  workers: uint32\n  timeout: double\nsvc.port: int32\n");
+    write_file(yaml_file, "svc:\n  workers: 8\n  timeout: 1.5\n  port: 80\n  name: abc\n");
+
+    assert(MyServer::ConfigSnapshot::RegisterSchema(schema_file) == 3);
+    assert(MyServer::ConfigSnapshot::RegisterSchema(schema_file) == 0);
+    auto workers = MyServer::Config::Lookup<uint32_t>("svc.workers");
+    assert(workers);
+
+    assert(MyServer::ConfigSnapshot::Compile(yaml_file, snap_file));
+    MyServer::ConfigSnapshot snapshot;
+    assert(snapshot.open(snap_file));
+    assert(snapshot.getBinaryCount() == 3);
+    //svc、svc.name没有注册
+    assert(snapshot.apply() == 3);
+    assert(workers->getValue() == 8);
+
+    write_file(schema_file, "svc:\n  other: string\n");
+    assert(MyServer::ConfigSnapshot::RegisterSchema(schema_file) == -1);
+    MYSERVER_LOG_INFO(MYSERVER_LOG_ROOT()) << "test_schema ok";
+}
+
+int main(int argc, char** argv) {
+    test_snapshot();
+    test_schema();
+    return 0;
+}
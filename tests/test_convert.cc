@@ -0,0 +1,140 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+static std::string itoa(int64_t v) {
+    char buf[20];
+    return std::string(buf, MyServer::IntToChars(v, buf));
+}
+
+static std::string utoa(uint64_t v) {
+    char buf[20];
+    return std::string(buf, MyServer::UintToChars(v, buf));
+}
+
+//整数输出与std::to_string一致,每个位数的边界都覆盖到
+void test_int() {
+    assert(utoa(0) == "0");
+    assert(itoa(-1) == "-1");
+    assert(utoa(std::numeric_limits<uint64_t>::max()) == "18446744073709551615");
+    assert(itoa(std::numeric_limits<int64_t>::min()) == "-9223372036854775808");
+    assert(itoa(std::numeric_limits<int64_t>::max()) == "9223372036854775807");
+    uint64_t p = 1;
+    for(int i = 0; i < 20; ++i) {
+        assert(utoa(p) == std::to_string(p));
+        assert(utoa(p - 1) == std::to_string(p - 1));
+        assert(itoa(-(int64_t)(p - 1)) == std::to_string(-(int64_t)(p - 1)));
+        p *= 10;
+    }
+    std::mt19937_64 rnd(1);
+    for(int i = 0; i < 100000; ++i) {
+        uint64_t v = rnd() >> (rnd() % 64);
+        assert(utoa(v) == std::to_string(v));
+        assert(itoa((int64_t)v) == std::to_string((int64_t)v));
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_int ok";
+}
+
+//浮点数输出最短,能原样解析回来
+void test_double() {
+    char buf[32];
+    assert(std::string(buf, MyServer::DoubleToChars(0.1, buf)) == "0.1");
+    assert(std::string(buf, MyServer::DoubleToChars(100, buf)) == "100");
+    assert(std::string(buf, MyServer::DoubleToChars(-2.5, buf)) == "-2.5");
+    assert(std::string(buf, MyServer::FloatToChars(0.1f, buf)) == "0.1");
+    std::mt19937_64 rnd(2);
+    for(int i = 0; i < 100000; ++i) {
+        uint64_t bits = rnd();
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        if(v != v) {
+            continue;
+        }
+        size_t len = MyServer::DoubleToChars(v, buf);
+        assert(len < 32);
+        double back = 0;
+        assert(MyServer::ParseDouble(buf, buf + len, back));
+        assert(back == v);
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_double ok";
+}
+
+static bool parse_int(const std::string& s, int64_t& v) {
+    return MyServer::ParseInt64(s.data(), s.data() + s.size(), v);
+}
+
+//必须用完整个字符串,溢出和多余字符都是错误
+void test_parse() {
+    int64_t i = 7;
+    assert(parse_int("123", i) && i == 123);
+    assert(parse_int("+123", i) && i == 123);
+    assert(parse_int("-9223372036854775808", i) && i == std::numeric_limits<int64_t>::min());
+    i = 7;
+    assert(!parse_int("", i) && i == 7);
+    assert(!parse_int("+", i) && !parse_int("+-1", i) && !parse_int(" 1", i));
+    assert(!parse_int("12a", i) && !parse_int("1.5", i) && i == 7);
+    assert(!parse_int("9223372036854775808", i) && i == 7);
+    uint64_t u = 0;
+    std::string s = "18446744073709551615";
+    assert(MyServer::ParseUint64(s.data(), s.data() + s.size(), u) && u == (uint64_t)-1);
+    s = "-1";
+    assert(!MyServer::ParseUint64(s.data(), s.data() + s.size(), u));
+    double d = 0;
+    s = "1e-3";
+    assert(MyServer::ParseDouble(s.data(), s.data() + s.size(), d) && d == 0.001);
+    s = "+.5";
+    assert(MyServer::ParseDouble(s.data(), s.data() + s.size(), d) && d == 0.5);
+    s = "1.5x";
+    assert(!MyServer::ParseDouble(s.data(), s.data() + s.size(), d));
+    MYSERVER_LOG_INFO(g_logger) << "test_parse ok";
+}
+
+//配置的数值转换不再经过boost::lexical_cast,失败时仍然抛出bad_lexical_cast
+void test_lexical_cast() {
+    assert((MyServer::LexicalCast<std::string, int>()("-42") == -42));
+    assert((MyServer::LexicalCast<std::string, unsigned short>()("65535") == 65535));
+    assert((MyServer::LexicalCast<std::string, float>()("0.25") == 0.25f));
+    assert((MyServer::LexicalCast<double, std::string>()(0.1) == "0.1"));
+    assert((MyServer::LexicalCast<long, std::string>()(-5) == "-5"));
+    bool thrown = false;
+    try {
+        MyServer::LexicalCast<std::string, short>()("40000");
+    } catch(boost::bad_lexical_cast& e) {
+        thrown = true;
+    }
+    assert(thrown);
+    auto v = MyServer::LexicalCast<std::string, std::vector<int> >()("[1, 2, 3]");
+    assert(v.size() == 3 && v[2] == 3);
+
+    auto var = MyServer::Config::Lookup("test.convert.ratio", 1.5, "ratio");
+    var->fromString("0.75");
+    assert(var->getValue() == 0.75);
+    assert(var->toString() == "0.75");
+    var->fromString("abc");
+    assert(var->getValue() == 0.75);
+    MYSERVER_LOG_INFO(g_logger) << "test_lexical_cast ok";
+}
+
+//格式器中的数值项
+void test_format() {
+    MyServer::Logger::ptr logger(new MyServer::Logger("convert"));
+    MyServer::LogFormatter::ptr fmt(new MyServer::LogFormatter("%r|%t|%F|%l"));
+    MyServer::LogEvent::ptr event(new MyServer::LogEvent(logger, MyServer::LogLevel::INFO
+                ,__FILE__, -12, 1234567, 4000000000u, 0, 0));
+    assert(fmt->format(logger, MyServer::LogLevel::INFO, event) == "1234567|4000000000|0|-12");
+    MYSERVER_LOG_INFO(g_logger) << "test_format ok";
+}
+
+int main(int argc, char** argv) {
+    test_int();
+    test_double();
+    test_parse();
+    test_lexical_cast();
+    test_format();
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+//多个线程同时增加,汇总不丢失;线程数超过分片数时共享分片
+void test_counter(int threads) {
+    const int64_t per_thread = 100000;
+    MyServer::ShardedCounter<> counter;
+    MyServer::ShardedCounter<uint64_t, 4> bytes;
+    auto thrs = MyServer::Thread::CreateBatch(threads, [&](size_t) {
+        for(int64_t j = 0; j < per_thread; ++j) {
+            ++counter;
+            bytes += 3;
+        }
+        counter.sub(per_thread / 2);
+    }, "counter");
+    for(auto& i : thrs) {
+        i->join();
+    }
+    assert(counter.get() == threads * per_thread / 2);
+    assert(bytes == (uint64_t)threads * per_thread * 3);
+    assert(bytes.exchange() == (uint64_t)threads * per_thread * 3);
+    assert(bytes.get() == 0);
+    MYSERVER_LOG_INFO(g_logger) << "test_counter threads=" << threads << " ok";
+}
+
+//PerCpu存放任意结构,每个分片独占cache line
+struct Stat {
+    uint64_t count = 0;
+    uint64_t max = 0;
+};
+
+void test_percpu() {
+    MyServer::PerCpu<Stat, 16> stats;
+    static_assert(sizeof(stats) == 16 * 64, "PerCpu slot padding");
+    stats.local().count = 1;
+    stats.local().max = 7;
+    uint64_t count = 0;
+    uint64_t max = 0;
+    stats.foreach([&](const Stat& s) {
+        count += s.count;
+        max = std::max(max, s.max);
+    });
+    assert(count == 1 && max == 7);
+    assert(stats.get(MyServer::GetThreadSlot() & 15).max == 7);
+    MYSERVER_LOG_INFO(g_logger) << "test_percpu ok";
+}
+
+//线程退出后槽位被复用,编号保持紧凑
+void test_slot_reuse() {
+    uint32_t max_slot = 0;
+    for(int round = 0; round < 20; ++round) {
+        std::vector<uint32_t> slots(8);
+        //等8个线程都拿到编号再退出,保证它们同时存在
+        MyServer::Latch all(8);
+        auto thrs = MyServer::Thread::CreateBatch(8, [&slots, &all](size_t i) {
+            slots[i] = MyServer::GetThreadSlot();
+            all.countDown();
+            all.wait();
+        }, "slot");
+        for(auto& i : thrs) {
+            i->join();
+        }
+        std::sort(slots.begin(), slots.end());
+        assert(std::unique(slots.begin(), slots.end()) == slots.end());
+        max_slot = std::max(max_slot, slots.back());
+    }
+    //20轮共160个线程,同时存在的不超过8个加上主线程和之前测试留下的编号
+    assert(max_slot < 8 + 1 + 64);
+    MYSERVER_LOG_INFO(g_logger) << "test_slot_reuse ok max_slot=" << max_slot;
+}
+
+//槽位归还之后,后析构的thread_local再取槽位不会拿到已归还的编号
+static std::atomic<uint32_t> s_late_slot{0};
+struct LateSlotProbe {
+    ~LateSlotProbe() {
+        s_late_slot = MyServer::GetThreadSlot();
+    }
+};
+
+void test_slot_after_exit() {
+    uint32_t slot = 0;
+    MyServer::Thread::ptr thr(new MyServer::Thread([&slot]() {
+        //先构造的thread_local后析构
+        static thread_local LateSlotProbe t_probe;
+        (void)t_probe;
+        slot = MyServer::GetThreadSlot();
+    }, "late_slot"));
+    thr->join();
+    assert(s_late_slot != slot);
+    MYSERVER_LOG_INFO(g_logger) << "test_slot_after_exit ok slot=" << slot
+        << " late_slot=" << s_late_slot;
+}
+
+int main(int argc, char** argv) {
+    test_percpu();
+    test_counter(4);
+    test_counter(100);
+    test_slot_reuse();
+    test_slot_after_exit();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/fiber_stack.h"
+#include <assert.h>
+#include <stdexcept>
+#include <signal.h>
+#include <sys/wait.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+void run_in_fiber() {
+    MYSERVER_LOG_INFO(g_logger) << "run_in_fiber begin";
+    MyServer::Fiber::Yield();
+    MYSERVER_LOG_INFO(g_logger) << "run_in_fiber end";
+}
+
+void test_fiber() {
+    MyServer::Fiber::GetThis();
+    assert(MyServer::GetFiberId() == 0);
+    MyServer::Fiber::ptr fiber(new MyServer::Fiber(run_in_fiber));
+    assert(fiber->getState() == MyServer::Fiber::INIT);
+    fiber->resume();
+    assert(fiber->getState() == MyServer::Fiber::HOLD);
+    MYSERVER_LOG_INFO(g_logger) << "main after resume";
+    fiber->resume();
+    assert(fiber->getState() == MyServer::Fiber::TERM);
+
+    //复用栈
+    int value = 0;
+    fiber->reset([&value]() {
+        value = MyServer::GetFiberId();
+    });
+    fiber->resume();
+    assert(fiber->getState() == MyServer::Fiber::TERM);
+    assert(value == (int)fiber->getId());
+}
+
+//嵌套resume, yield回到直接调用方
+void test_nested() {
+    std::vector<int> order;
+    MyServer::Fiber::ptr inner(new MyServer::Fiber([&order]() {
+        order.push_back(2);
+        MyServer::Fiber::Yield();
+        order.push_back(5);
+    }));
+    MyServer::Fiber::ptr outer(new MyServer::Fiber([&order, inner]() {
+        order.push_back(1);
+        inner->resume();
+        order.push_back(3);
+        MyServer::Fiber::Yield();
+        inner->resume();
+        order.push_back(6);
+    }));
+    outer->resume();
+    order.push_back(4);
+    outer->resume();
+    assert(inner->getState() == MyServer::Fiber::TERM);
+    assert(outer->getState() == MyServer::Fiber::TERM);
+    assert((order == std::vector<int>{1, 2, 3, 4, 5, 6}));
+}
+
+void test_exception() {
+    MyServer::Fiber::ptr fiber(new MyServer::Fiber([]() {
+        throw std::logic_error("test exception");
+    }));
+    fiber->resume();
+    assert(fiber->getState() == MyServer::Fiber::EXCEPT);
+}
+
+//协程在worker之间yield/resume
+void test_scheduler() {
+    const int fibers = 10000;
+    const int rounds = 10;
+    std::atomic<int> count{0};
+    {
+        MyServer::Scheduler sc(4, "fiber");
+        sc.start();
+        for(int i = 0; i < fibers; ++i) {
+            sc.schedule([&sc, &count]() {
+                MyServer::Fiber::ptr self = MyServer::Fiber::GetThis();
+                uint64_t id = MyServer::GetFiberId();
+                for(int j = 0; j < rounds; ++j) {
+                    //先提交再yield,其它worker会等yield完成后再resume
+                    sc.schedule(self);
+                    MyServer::Fiber::Yield();
+                    assert(MyServer::GetFiberId() == id);
+                }
+                ++count;
+            });
+        }
+        //所有协程都在yield之前重新提交过,stop会等它们执行完
+        sc.stop();
+    }
+    MYSERVER_LOG_INFO(g_logger) << "count=" << count << " total_fibers=" << MyServer::Fiber::TotalFibers();
+    assert(count == fibers);
+}
+
+void test_stack_pool() {
+    const size_t size = 64 * 1024;
+    void* s1 = MyServer::FiberStackPool::Alloc(size);
+    assert(s1);
+    MyServer::FiberStackPool::Dealloc(s1, size);
+    //同一线程释放后马上复用
+    void* s2 = MyServer::FiberStackPool::Alloc(size);
+    assert(s1 == s2);
+    ((char*)s2)[0] = 1;
+    ((char*)s2)[size - 1] = 1;
+
+    //写guard页直接SIGSEGV
+    pid_t pid = fork();
+    if(pid == 0) {
+        ((volatile char*)s2)[-1] = 1;
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+    MyServer::FiberStackPool::Dealloc(s2, size);
+
+    uint64_t total = MyServer::FiberStackPool::TotalStacks();
+    MyServer::FiberStackPool::Trim();
+    assert(MyServer::FiberStackPool::CachedStacks() == 0);
+    assert(MyServer::FiberStackPool::TotalStacks() < total);
+}
+
+int main(int argc, char** argv) {
+    MyServer::Thread::SetName("main");
+    test_fiber();
+    test_nested();
+    test_exception();
+    test_scheduler();
+    test_stack_pool();
+    MYSERVER_LOG_INFO(g_logger) << "test_fiber end";
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+//同一个worker上的两个sleep并发执行,总耗时接近一次sleep
+void test_sleep() {
+    assert(!MyServer::is_hook_enable());
+    uint64_t start = MyServer::GetCurrentMS();
+    std::atomic<int> done{0};
+    {
+        MyServer::IOManager iom(1, "sleep");
+        iom.schedule([&done]() {
+            assert(MyServer::is_hook_enable());
+            sleep(1);
+            ++done;
+        });
+        iom.schedule([&done]() {
+            usleep(500 * 1000);
+            ++done;
+        });
+        iom.schedule([&done]() {
+            struct timespec ts = {0, 200 * 1000 * 1000};
+            nanosleep(&ts, nullptr);
+            ++done;
+        });
+    }
+    uint64_t used = MyServer::GetCurrentMS() - start;
+    MYSERVER_LOG_INFO(g_logger) << "test_sleep used=" << used << "ms";
+    assert(done == 3);
+    assert(used >= 1000 && used < 1500);
+}
+
+//不足1毫秒的sleep向上取整到1毫秒,不会变成立即返回
+void test_short_sleep() {
+    uint64_t used = 0;
+    {
+        MyServer::IOManager iom(1, "short_sleep");
+        iom.schedule([&used]() {
+            uint64_t start = MyServer::GetCurrentUS();
+            for(int i = 0; i < 10; ++i) {
+                usleep(100);
+                struct timespec ts = {0, 50 * 1000};
+                nanosleep(&ts, nullptr);
+            }
+            used = MyServer::GetCurrentUS() - start;
+        });
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_short_sleep used=" << used << "us";
+    assert(used >= 15 * 1000);
+}
+
+static sockaddr_in LocalAddr(uint16_t port) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+//阻塞写法的客户端和服务端跑在同一个IOManager上
+void test_socket() {
+    std::atomic<int> port{0};
+    std::atomic<int> done{0};
+    MyServer::IOManager iom(2, "socket");
+    iom.schedule([&port, &done]() {
+        int lfd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(lfd >= 0);
+        //用户看到的仍然是阻塞的fd
+        assert(!(fcntl(lfd, F_GETFL, 0) & O_NONBLOCK));
+        //不带参数的命令
+        assert(fcntl(lfd, F_GETFD) >= 0);
+        sockaddr_in addr = LocalAddr(0);
+        assert(bind(lfd, (sockaddr*)&addr, sizeof(addr)) == 0);
+        assert(listen(lfd, 16) == 0);
+        socklen_t len = sizeof(addr);
+        getsockname(lfd, (sockaddr*)&addr, &len);
+        port = ntohs(addr.sin_port);
+
+        int fd = accept(lfd, nullptr, nullptr);
+        assert(fd >= 0);
+        //客户端300ms后才发送,100ms的读超时先到
+        timeval tv = {0, 100 * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char buf[64];
+        uint64_t start = MyServer::GetCurrentMS();
+        assert(recv(fd, buf, sizeof(buf), 0) == -1);
+        assert(errno == ETIMEDOUT);
+        uint64_t used = MyServer::GetCurrentMS() - start;
+        assert(used >= 100 && used < 300);
+
+        tv.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ssize_t n = read(fd, buf, sizeof(buf));
+        assert(n == 5 && memcmp(buf, "hello", 5) == 0);
+        assert(write(fd, buf, n) == n);
+        close(fd);
+        close(lfd);
+        ++done;
+    });
+    iom.schedule([&port, &done]() {
+        while(!port) {
+            usleep(1000);
+        }
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = LocalAddr(port);
+        assert(connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+        usleep(300 * 1000);
+        assert(send(fd, "hello", 5, 0) == 5);
+        char buf[64];
+        assert(recv(fd, buf, sizeof(buf), 0) == 5);
+        assert(recv(fd, buf, sizeof(buf), 0) == 0);
+        close(fd);
+
+        //端口已经关闭
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(connect_with_timeout(fd, (sockaddr*)&addr, sizeof(addr), 1000) == -1);
+        assert(errno == ECONNREFUSED);
+        close(fd);
+        ++done;
+    });
+    iom.stop();
+    assert(done == 2);
+}
+
+int main(int argc, char** argv) {
+    test_sleep();
+    test_short_sleep();
+    test_socket();
+    MYSERVER_LOG_INFO(g_logger) << "test_hook ok";
+    return 0;
+}
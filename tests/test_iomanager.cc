@@ -0,0 +1,126 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/iomanager.h"
+#include <assert.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+void test_callback() {
+    MyServer::IOManager iom(2, "iom");
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    //回调方式
+    MyServer::Semaphore sem;
+    std::string data;
+    assert(iom.addEvent(fds[0], MyServer::IOManager::READ, [&]() {
+        char buf[64];
+        int n = read(fds[0], buf, sizeof(buf));
+        data.assign(buf, n > 0 ? n : 0);
+        sem.notify();
+    }) == 0);
+    //重复关注同一个事件失败
+    assert(iom.addEvent(fds[0], MyServer::IOManager::READ, []() {}) == -1);
+    assert(write(fds[1], "hello", 5) == 5);
+    sem.wait();
+    assert(data == "hello");
+
+    //协程方式,事件触发后协程被重新调度
+    iom.schedule([&]() {
+        iom.addEvent(fds[0], MyServer::IOManager::READ);
+        MyServer::Fiber::Yield();
+        char buf[64];
+        int n = read(fds[0], buf, sizeof(buf));
+        data.assign(buf, n > 0 ? n : 0);
+        sem.notify();
+    });
+    usleep(10 * 1000);
+    assert(write(fds[1], "world", 5) == 5);
+    sem.wait();
+    assert(data == "world");
+
+    //cancelEvent触发回调, delEvent不触发
+    bool triggered = false;
+    iom.addEvent(fds[0], MyServer::IOManager::READ, [&]() {
+        triggered = true;
+        sem.notify();
+    });
+    assert(iom.getPendingEventCount() == 1);
+    assert(iom.cancelEvent(fds[0], MyServer::IOManager::READ));
+    sem.wait();
+    assert(triggered);
+
+    //没有数据可读,事件不会触发
+    iom.addEvent(fds[0], MyServer::IOManager::READ, []() {
+        assert(false);
+    });
+    assert(iom.delEvent(fds[0], MyServer::IOManager::READ));
+    assert(!iom.delEvent(fds[0], MyServer::IOManager::READ));
+    assert(iom.getPendingEventCount() == 0);
+
+    close(fds[0]);
+    close(fds[1]);
+    MYSERVER_LOG_INFO(g_logger) << "test_callback ok";
+}
+
+//worker都空闲时指定worker执行,其中一个阻塞在epoll_wait上,需要eventfd唤醒
+void test_tickle() {
+    MyServer::IOManager iom(3, "iom");
+    std::atomic<int> ok{0};
+    for(int i = 0; i < 300; ++i) {
+        int target = i % 3;
+        iom.schedule([target, &ok]() {
+            if(MyServer::Scheduler::GetWorkerIndex() == target
+                    && MyServer::IOManager::GetThis()) {
+                ++ok;
+            }
+        }, target);
+        if(i % 10 == 0) {
+            usleep(1000);
+        }
+    }
+    iom.stop();
+    assert(ok == 300);
+    MYSERVER_LOG_INFO(g_logger) << "test_tickle ok";
+}
+
+//单线程且没有定时器,epoll_wait不会超时,只能靠eventfd唤醒
+//清tickle标记和读eventfd的顺序不对时,丢掉一次唤醒后就再也唤不醒
+void test_cross_thread_schedule() {
+    MyServer::IOManager iom(1, "iom");
+    const int producers = 4;
+    const int per_producer = 20000;
+    std::atomic<int> done{0};
+    auto thrs = MyServer::Thread::CreateBatch(producers, [&](size_t) {
+        for(int j = 0; j < per_producer; ++j) {
+            iom.schedule([&done]() {
+                ++done;
+            });
+            //时不时停一下,让worker进入epoll_wait
+            if(j % 64 == 0) {
+                usleep(50);
+            }
+        }
+    }, "producer");
+    for(auto& i : thrs) {
+        i->join();
+    }
+    //丢失唤醒时任务永远执行不完,超时失败而不是卡住
+    uint64_t deadline = MyServer::GetCurrentMS() + 10000;
+    while(done < producers * per_producer && MyServer::GetCurrentMS() < deadline) {
+        usleep(1000);
+    }
+    assert(done == producers * per_producer);
+    iom.stop();
+    MYSERVER_LOG_INFO(g_logger) << "test_cross_thread_schedule ok";
+}
+
+int main(int argc, char** argv) {
+    test_callback();
+    test_tickle();
+    test_cross_thread_schedule();
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+//多个线程在锁内做非原子的读改写,最后计数不能丢
+template<class MutexType, class LockType = typename MutexType::Lock>
+static void test_exclusive(const char* name) {
+    const int threads = 8;
+    const int loops = 100000;
+    MutexType m;
+    volatile uint64_t count = 0;
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(int i = 0; i < threads; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&m, &count]() {
+            for(int j = 0; j < loops; ++j) {
+                LockType lock(m);
+                count = count + 1;
+            }
+        }, "lock_" + std::to_string(i))));
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    assert(count == (uint64_t)threads * loops);
+    MYSERVER_LOG_INFO(g_logger) << name << " ok";
+}
+
+//持锁期间睡眠,等待者进入futex等待后仍然能被唤醒
+void test_futex_sleep() {
+    MyServer::FutexMutex m;
+    std::atomic<int> stage{0};
+    m.lock();
+    assert(!m.tryLock());
+    MyServer::Thread::ptr thr(new MyServer::Thread([&m, &stage]() {
+        stage = 1;
+        MyServer::FutexMutex::Lock lock(m);
+        stage = 2;
+    }, "waiter"));
+    while(stage != 1) {
+        sched_yield();
+    }
+    usleep(50 * 1000);
+    assert(stage == 1);
+    m.unlock();
+    thr->join();
+    assert(stage == 2);
+    assert(m.tryLock());
+    m.unlock();
+    MYSERVER_LOG_INFO(g_logger) << "test_futex_sleep ok";
+}
+
+//写者同时修改两个值,读者在读锁内看到的两个值必须相等
+template<class MutexType>
+static void test_shared(const char* name) {
+    const int readers = 6;
+    const int writes = 2000;
+    MutexType m;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(int i = 0; i < readers; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&]() {
+            uint64_t n = 0;
+            while(!stop) {
+                typename MutexType::ReadLock lock(m);
+                assert(a == b);
+                ++n;
+            }
+            reads += n;
+        }, "reader_" + std::to_string(i))));
+    }
+    for(int i = 0; i < writes; ++i) {
+        typename MutexType::WriteLock lock(m);
+        ++a;
+        sched_yield();
+        ++b;
+    }
+    stop = true;
+    for(auto& i : thrs) {
+        i->join();
+    }
+    assert(a == (uint64_t)writes && b == (uint64_t)writes);
+    MYSERVER_LOG_INFO(g_logger) << name << " ok reads=" << reads;
+}
+
+struct SeqState {
+    uint64_t a;
+    uint64_t b;
+    uint32_t c;
+};
+
+//写者写入各字段相等的值,读者读到的必须一致且不会倒退
+void test_seqlock() {
+    const int readers = 4;
+    const uint64_t writes = 200000;
+    MyServer::SeqLock<SeqState> sl(SeqState{0, 0, 0});
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(int i = 0; i < readers; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&]() {
+            uint64_t last = 0;
+            uint64_t n = 0;
+            while(!stop) {
+                SeqState v = sl.load();
+                assert(v.a == v.b && (uint32_t)v.a == v.c);
+                assert(v.a >= last);
+                last = v.a;
+                ++n;
+            }
+            reads += n;
+        }, "reader_" + std::to_string(i))));
+    }
+    for(uint64_t i = 1; i <= writes; ++i) {
+        if(i & 1) {
+            sl.store(SeqState{i, i, (uint32_t)i});
+        } else {
+            sl.update([](SeqState& v) {
+                ++v.a;
+                ++v.b;
+                ++v.c;
+            });
+        }
+    }
+    stop = true;
+    for(auto& i : thrs) {
+        i->join();
+    }
+    SeqState v = sl.load();
+    assert(v.a == writes && v.b == writes && v.c == writes);
+    MYSERVER_LOG_INFO(g_logger) << "test_seqlock ok reads=" << reads;
+}
+
+//空锁可以和真实锁一样使用,且不占额外空间
+void test_null() {
+    MyServer::NullMutex m;
+    {
+        MyServer::NullMutex::Lock lock(m);
+        lock.unlock();
+        lock.lock();
+    }
+    MyServer::NullRWMutex rw;
+    {
+        MyServer::NullRWMutex::ReadLock rlock(rw);
+    }
+    {
+        MyServer::NullRWMutex::WriteLock wlock(rw);
+    }
+    static_assert(sizeof(MyServer::NullMutex) == 1 && sizeof(MyServer::NullRWMutex) == 1
+                  ,"null mutex has no state");
+#ifdef MYSERVER_SINGLE_THREADED
+    static_assert(std::is_same<MyServer::Logger::MutexType, MyServer::NullMutex>::value
+                  ,"single threaded logger lock");
+#else
+    static_assert(std::is_same<MyServer::Logger::MutexType, MyServer::FutexMutex>::value
+                  ,"logger lock");
+#endif
+    MYSERVER_LOG_INFO(g_logger) << "test_null ok";
+}
+
+int main(int argc, char** argv) {
+    test_null();
+    test_exclusive<MyServer::FutexMutex>("FutexMutex");
+    test_exclusive<MyServer::CASLock>("CASLock");
+    test_futex_sleep();
+    test_exclusive<MyServer::BRMutex, MyServer::BRMutex::WriteLock>("BRMutex.write");
+    test_shared<MyServer::BRMutex>("BRMutex");
+    test_seqlock();
+    return 0;
+}
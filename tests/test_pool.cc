@@ -0,0 +1,97 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+static std::atomic<int64_t> s_live{0};
+
+struct Request {
+    Request() {
+        ++s_live;
+    }
+    ~Request() {
+        --s_live;
+    }
+    std::string body;
+    int id = 0;
+};
+
+//归还的对象经过reset后被复用
+void test_reuse() {
+    {
+        MyServer::ObjectPool<Request> pool(4, 2, [](Request& r) {
+            r.body.clear();
+            r.id = 0;
+        });
+        Request* raw = nullptr;
+        {
+            auto r = pool.get();
+            r->body = "hello";
+            r->id = 7;
+            raw = r.get();
+        }
+        auto r = pool.get();
+        assert(r.get() == raw);
+        assert(r->body.empty() && r->id == 0);
+        assert(pool.getCreatedCount() == 1);
+
+        //本线程超过2个弹匣时整批交给仓库,仓库满了直接释放
+        std::vector<MyServer::ObjectPool<Request>::UniquePtr> objs;
+        for(int i = 0; i < 40; ++i) {
+            objs.push_back(pool.get());
+        }
+        objs.clear();
+        assert(pool.getDepotSize() == 2);
+        //8个在本线程,8个在仓库,其余被释放
+        assert(s_live == 1 + 16);
+    }
+    assert(s_live == 0);
+    MYSERVER_LOG_INFO(g_logger) << "test_reuse ok";
+}
+
+//一个线程取,其它线程还,对象经仓库回到取的线程
+void test_cross_thread() {
+    {
+        MyServer::ObjectPool<Request> pool(16, 1024);
+        MyServer::MPMCQueue<Request*> q(1024);
+        const int per_producer = 100000;
+        std::atomic<int> freed{0};
+        auto consumers = MyServer::Thread::CreateBatch(2, [&](size_t) {
+            Request* r = nullptr;
+            while(freed < per_producer * 2) {
+                if(q.tryPop(r)) {
+                    assert(r->id > 0);
+                    pool.release(r);
+                    ++freed;
+                } else {
+                    sched_yield();
+                }
+            }
+        }, "free");
+        auto producers = MyServer::Thread::CreateBatch(2, [&](size_t) {
+            for(int i = 0; i < per_producer; ++i) {
+                Request* r = pool.acquire();
+                r->id = i + 1;
+                while(!q.tryPush(r)) {
+                    sched_yield();
+                }
+            }
+        }, "alloc");
+        for(auto& i : producers) {
+            i->join();
+        }
+        for(auto& i : consumers) {
+            i->join();
+        }
+        //大部分对象来自复用
+        assert(pool.getCreatedCount() < (uint64_t)per_producer);
+        MYSERVER_LOG_INFO(g_logger) << "test_cross_thread ok created=" << pool.getCreatedCount();
+    }
+    assert(s_live == 0);
+}
+
+int main(int argc, char** argv) {
+    test_reuse();
+    test_cross_thread();
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+#include <string>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+//单线程下的满、空、批量和非平凡类型
+void test_basic() {
+    MyServer::MPMCQueue<std::string> q(3);
+    assert(q.capacity() == 4);
+    for(int i = 0; i < 4; ++i) {
+        assert(q.tryPush(std::to_string(i)));
+    }
+    std::string s = "x";
+    assert(!q.tryPush(s));
+    assert(s == "x");
+    assert(q.tryPop(s) && s == "0");
+
+    std::vector<std::string> in = {"a", "b", "c"};
+    assert(q.tryPushBatch(in.begin(), in.size()) == 1);
+    std::vector<std::string> out;
+    assert(q.tryPopBatch(std::back_inserter(out), 10) == 4);
+    assert(out[0] == "1" && out[3] == "a");
+    assert(!q.tryPop(s));
+
+    //析构时释放剩余元素
+    MyServer::MPSCQueue<std::unique_ptr<int> > mq(8);
+    mq.tryPush(std::unique_ptr<int>(new int(1)));
+    mq.tryPush(std::unique_ptr<int>(new int(2)));
+
+    MyServer::SPSCQueue<int> sq(4);
+    std::vector<int> nums = {1, 2, 3, 4, 5};
+    assert(sq.tryPushBatch(nums.begin(), nums.size()) == 4);
+    assert(!sq.tryPush(6));
+    int v = 0;
+    assert(sq.tryPop(v) && v == 1);
+    std::vector<int> got;
+    assert(sq.tryPopBatch(std::back_inserter(got), 10) == 3);
+    assert(got[2] == 4);
+    MYSERVER_LOG_INFO(g_logger) << "test_basic ok";
+}
+
+//多个生产者和消费者通过阻塞接口传递,每个值恰好被取出一次
+template<class Queue>
+static void test_blocking(const char* name, int producers, int consumers, bool batch) {
+    const uint64_t per_producer = 100000;
+    MyServer::BlockingQueue<Queue> q(64);
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> count{0};
+    std::atomic<int> exited{0};
+    uint64_t total = per_producer * producers;
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(int i = 0; i < consumers; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, batch]() {
+            uint64_t local = 0;
+            uint64_t n = 0;
+            uint64_t vals[16];
+            while(true) {
+                size_t k = 1;
+                if(batch) {
+                    k = q.popBatch(vals, 16);
+                } else {
+                    q.pop(vals[0]);
+                }
+                for(size_t j = 0; j < k; ++j) {
+                    //0是结束标记
+                    if(vals[j] == 0) {
+                        sum += local;
+                        count += n;
+                        ++exited;
+                        return;
+                    }
+                    local += vals[j];
+                    ++n;
+                }
+            }
+        }, "consumer_" + std::to_string(i))));
+    }
+    std::vector<MyServer::Thread::ptr> prods;
+    for(int i = 0; i < producers; ++i) {
+        prods.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i, batch]() {
+            uint64_t base = i * per_producer;
+            if(batch) {
+                std::vector<uint64_t> vals;
+                for(uint64_t j = 1; j <= per_producer; ++j) {
+                    vals.push_back(base + j);
+                    if(vals.size() == 8 || j == per_producer) {
+                        q.pushBatch(vals.begin(), vals.size());
+                        vals.clear();
+                    }
+                }
+            } else {
+                for(uint64_t j = 1; j <= per_producer; ++j) {
+                    q.push(base + j);
+                }
+            }
+        }, "producer_" + std::to_string(i))));
+    }
+    for(auto& i : prods) {
+        i->join();
+    }
+    //批量出队时结束标记之后的值会被丢掉,所以等全部取完再逐个发
+    while(q.sizeApprox()) {
+        sched_yield();
+    }
+    for(int i = 0; i < consumers; ++i) {
+        q.push((uint64_t)0);
+        while(exited <= i) {
+            sched_yield();
+        }
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    assert(count == total);
+    assert(sum == total * (total + 1) / 2);
+    MYSERVER_LOG_INFO(g_logger) << name << " producers=" << producers
+        << " consumers=" << consumers << " batch=" << batch << " ok";
+}
+
+//生产者远多于队列槽位,消费者慢,生产者陆续退出时其它生产者仍在等待;
+//不能有等待者被漏掉唤醒而永远阻塞
+static void test_park_exit(int rounds) {
+    const int producers = 16;
+    for(int r = 0; r < rounds; ++r) {
+        MyServer::BlockingQueue<MyServer::MPMCQueue<uint64_t> > q(2);
+        uint64_t total = 0;
+        std::vector<MyServer::Thread::ptr> prods;
+        for(int i = 0; i < producers; ++i) {
+            //每个生产者的数量不同,退出的时间错开
+            uint64_t n = 20 + i * 15;
+            total += n;
+            prods.push_back(MyServer::Thread::ptr(new MyServer::Thread([&q, n]() {
+                for(uint64_t j = 0; j < n; ++j) {
+                    q.push(j);
+                }
+            }, "park_" + std::to_string(i))));
+        }
+        std::atomic<bool> finished{false};
+        MyServer::Thread::ptr watchdog(new MyServer::Thread([&finished, r]() {
+            for(int i = 0; i < 3000 && !finished; ++i) {
+                usleep(10 * 1000);
+            }
+            if(!finished) {
+                MYSERVER_LOG_ERROR(g_logger) << "test_park_exit round " << r << " hang";
+                abort();
+            }
+        }, "watchdog"));
+        uint64_t v = 0;
+        for(uint64_t i = 0; i < total; ++i) {
+            q.pop(v);
+            if(i % 16 == 0) {
+                usleep(50);
+            }
+        }
+        finished = true;
+        for(auto& i : prods) {
+            i->join();
+        }
+        watchdog->join();
+        assert(q.sizeApprox() == 0);
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_park_exit rounds=" << rounds << " ok";
+}
+
+int main(int argc, char** argv) {
+    test_basic();
+    test_park_exit(20);
+    test_blocking<MyServer::MPMCQueue<uint64_t> >("MPMCQueue", 4, 4, false);
+    test_blocking<MyServer::MPMCQueue<uint64_t> >("MPMCQueue", 3, 2, true);
+    test_blocking<MyServer::MPSCQueue<uint64_t> >("MPSCQueue", 4, 1, false);
+    test_blocking<MyServer::MPSCQueue<uint64_t> >("MPSCQueue", 4, 1, true);
+    test_blocking<MyServer::SPSCQueue<uint64_t> >("SPSCQueue", 1, 1, false);
+    test_blocking<MyServer::SPSCQueue<uint64_t> >("SPSCQueue", 1, 1, true);
+    return 0;
+}
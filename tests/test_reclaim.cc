@@ -0,0 +1,252 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+#include <unistd.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+static const uint32_t LIVE = 0x11223344;
+static const uint32_t DEAD = 0xdeaddead;
+static std::atomic<int64_t> s_live{0};
+
+//析构后改写magic,释放过早时读者能看到DEAD
+struct Node {
+    Node(uint64_t v)
+        :value(v) {
+        ++s_live;
+    }
+    ~Node() {
+        magic = DEAD;
+        --s_live;
+    }
+    volatile uint32_t magic = LIVE;
+    uint64_t value;
+    Node* next = nullptr;
+};
+
+//Treiber栈,弹出的节点延迟释放
+template<class Reclaim>
+class Stack;
+
+template<>
+class Stack<MyServer::Epoch> {
+public:
+    void push(Node* n) {
+        n->next = m_top.load(std::memory_order_relaxed);
+        while(!m_top.compare_exchange_weak(n->next, n, std::memory_order_release
+                                           ,std::memory_order_relaxed));
+    }
+    bool pop(uint64_t& v) {
+        MyServer::Epoch::Guard guard;
+        Node* n = m_top.load(std::memory_order_acquire);
+        while(n) {
+            assert(n->magic == LIVE);
+            if(m_top.compare_exchange_weak(n, n->next, std::memory_order_acquire
+                                           ,std::memory_order_acquire)) {
+                break;
+            }
+        }
+        if(!n) {
+            return false;
+        }
+        v = n->value;
+        MyServer::Epoch::Retire(n);
+        return true;
+    }
+private:
+    std::atomic<Node*> m_top{nullptr};
+};
+
+template<>
+class Stack<MyServer::HazardPointer> {
+public:
+    void push(Node* n) {
+        n->next = m_top.load(std::memory_order_relaxed);
+        while(!m_top.compare_exchange_weak(n->next, n, std::memory_order_release
+                                           ,std::memory_order_relaxed));
+    }
+    bool pop(uint64_t& v) {
+        MyServer::HazardPointer hp;
+        Node* n = nullptr;
+        while(true) {
+            n = hp.protect(m_top);
+            if(!n) {
+                return false;
+            }
+            assert(n->magic == LIVE);
+            Node* next = n->next;
+            if(m_top.compare_exchange_strong(n, next, std::memory_order_acquire
+                                             ,std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        v = n->value;
+        hp.reset();
+        MyServer::HazardPointer::Retire(n);
+        return true;
+    }
+private:
+    std::atomic<Node*> m_top{nullptr};
+};
+
+//释放所有已退出线程留下的对象
+static void drain(MyServer::Epoch*) {
+    MyServer::Epoch::Synchronize();
+}
+
+static void drain(MyServer::HazardPointer*) {
+    MyServer::HazardPointer::Scan();
+}
+
+//多个线程同时push/pop,每个值恰好弹出一次,所有节点最终都被释放
+template<class Reclaim>
+static void test_stack(const char* name, int threads) {
+    const uint64_t per_thread = 200000;
+    Stack<Reclaim> stack;
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> count{0};
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(int i = 0; i < threads; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i]() {
+            uint64_t local = 0;
+            uint64_t n = 0;
+            uint64_t v = 0;
+            for(uint64_t j = 1; j <= per_thread; ++j) {
+                stack.push(new Node(i * per_thread + j));
+                if(j % 3 && stack.pop(v)) {
+                    local += v;
+                    ++n;
+                }
+            }
+            while(stack.pop(v)) {
+                local += v;
+                ++n;
+            }
+            sum += local;
+            count += n;
+        }, "stack_" + std::to_string(i))));
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    uint64_t total = per_thread * threads;
+    assert(count == total);
+    assert(sum == total * (total + 1) / 2);
+    //退出线程留下的对象由这里释放
+    drain((Reclaim*)nullptr);
+    assert(s_live == 0);
+    MYSERVER_LOG_INFO(g_logger) << name << " threads=" << threads << " ok";
+}
+
+//读者持有旧快照时写者不断替换,读者看到的快照始终完整
+struct Snapshot {
+    Snapshot(uint64_t v)
+        :a(v), b(~v) {
+        ++s_live;
+    }
+    ~Snapshot() {
+        a = b = 0;
+        --s_live;
+    }
+    volatile uint64_t a;
+    volatile uint64_t b;
+};
+
+void test_snapshot() {
+    std::atomic<Snapshot*> cur{new Snapshot(0)};
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(int i = 0; i < 4; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&, i]() {
+            uint64_t n = 0;
+            while(!stop.load(std::memory_order_relaxed)) {
+                if(i % 2) {
+                    MyServer::Epoch::Guard guard;
+                    Snapshot* s = cur.load(std::memory_order_acquire);
+                    assert((s->a ^ s->b) == ~0ull);
+                } else {
+                    MyServer::HazardPointer hp;
+                    Snapshot* s = hp.protect(cur);
+                    assert((s->a ^ s->b) == ~0ull);
+                }
+                ++n;
+            }
+            reads += n;
+        }, "reader_" + std::to_string(i))));
+    }
+    //偶数次用Epoch回收,奇数次用风险指针回收,两种读者各自只能保护自己那一半,
+    //所以这里每个快照同时经过两种回收:先等Epoch,再交给风险指针
+    for(uint64_t v = 1; v <= 20000; ++v) {
+        Snapshot* old = cur.exchange(new Snapshot(v), std::memory_order_acq_rel);
+        MyServer::Epoch::Retire(old, [](void* p) {
+            MyServer::HazardPointer::Retire((Snapshot*)p);
+        });
+    }
+    stop = true;
+    for(auto& i : thrs) {
+        i->join();
+    }
+    MyServer::Epoch::Synchronize();
+    MyServer::HazardPointer::Scan();
+    delete cur.load();
+    assert(s_live == 0);
+    MYSERVER_LOG_INFO(g_logger) << "test_snapshot ok reads=" << reads;
+}
+
+//有线程停在临界区里时,它进入之后Retire的对象不会被释放
+void test_guard_blocks() {
+    std::atomic<int> state{0};
+    MyServer::Thread::ptr reader(new MyServer::Thread([&state]() {
+        MyServer::Epoch::Guard guard;
+        {
+            //嵌套的临界区离开时不退出外层
+            MyServer::Epoch::Guard inner;
+        }
+        state = 1;
+        while(state != 2) {
+            usleep(100);
+        }
+    }, "holder"));
+    while(state != 1) {
+        usleep(100);
+    }
+    uint64_t e = MyServer::Epoch::GetEpoch();
+    Node* n = new Node(1);
+    MyServer::Epoch::Retire(n);
+    for(int i = 0; i < 100; ++i) {
+        MyServer::Epoch::TryAdvance();
+        //触发一次回收
+        for(int j = 0; j < 64; ++j) {
+            MyServer::Epoch::Retire(new Node(0));
+        }
+    }
+    //读者停在e,纪元最多推进到e+1
+    assert(MyServer::Epoch::GetEpoch() <= e + 1);
+    assert(n->magic == LIVE);
+    state = 2;
+    reader->join();
+    MyServer::Epoch::Synchronize();
+    assert(MyServer::Epoch::GetPendingCount() == 0);
+    assert(s_live == 0);
+
+    //风险指针保护的对象扫描时不释放
+    std::atomic<Node*> src{new Node(2)};
+    MyServer::HazardPointer hp;
+    Node* p = hp.protect(src);
+    src.store(nullptr);
+    MyServer::HazardPointer::Retire(p);
+    MyServer::HazardPointer::Scan();
+    assert(p->magic == LIVE && MyServer::HazardPointer::GetPendingCount() == 1);
+    hp.reset();
+    MyServer::HazardPointer::Scan();
+    assert(s_live == 0 && MyServer::HazardPointer::GetPendingCount() == 0);
+    MYSERVER_LOG_INFO(g_logger) << "test_guard_blocks ok";
+}
+
+int main(int argc, char** argv) {
+    test_guard_blocks();
+    test_stack<MyServer::Epoch>("Epoch", 4);
+    test_stack<MyServer::HazardPointer>("HazardPointer", 4);
+    test_snapshot();
+    return 0;
+}
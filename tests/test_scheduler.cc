@@ -0,0 +1,66 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/scheduler.h"
+#include <assert.h>
+#include <unistd.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+void test_schedule() {
+    MyServer::Scheduler sc(4, "test");
+    sc.start();
+
+    std::atomic<int> count{0};
+    for(int i = 0; i < 10000; ++i) {
+        sc.schedule([&count]() {
+            ++count;
+        });
+    }
+
+    //worker内部继续提交任务,由其它worker窃取
+    std::atomic<int> nested{0};
+    sc.schedule([&sc, &nested]() {
+        for(int i = 0; i < 1000; ++i) {
+            sc.schedule([&nested]() {
+                ++nested;
+            });
+        }
+    });
+
+    //指定worker执行
+    std::atomic<int> pinned_ok{0};
+    for(int i = 0; i < 100; ++i) {
+        int target = i % sc.getThreadCount();
+        sc.schedule([target, &pinned_ok]() {
+            if(MyServer::Scheduler::GetWorkerIndex() == target) {
+                ++pinned_ok;
+            }
+        }, target);
+    }
+
+    sc.stop();
+    MYSERVER_LOG_INFO(g_logger) << "count=" << count << " nested=" << nested << " pinned_ok=" << pinned_ok;
+    assert(count == 10000);
+    assert(nested == 1000);
+    assert(pinned_ok == 100);
+}
+
+void test_idle_wakeup() {
+    MyServer::Scheduler sc(2, "idle");
+    sc.start();
+    //等worker全部阻塞后再提交
+    usleep(10 * 1000);
+    assert(sc.hasIdleThreads());
+    MyServer::Semaphore sem;
+    sc.schedule([&sem]() {
+        sem.notify();
+    });
+    sem.wait();
+    sc.stop();
+    MYSERVER_LOG_INFO(g_logger) << "test_idle_wakeup ok";
+}
+
+int main(int argc, char** argv) {
+    test_schedule();
+    test_idle_wakeup();
+    return 0;
+}
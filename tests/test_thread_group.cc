@@ -0,0 +1,174 @@
+#include "../MyServer/MyServer.h"
+#include <assert.h>
+#include <sched.h>
+#include <unistd.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+void test_parse() {
+    std::vector<int> cpus;
+    assert(MyServer::ParseCpuList("0-3, 8,10-11", cpus));
+    assert((cpus == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    cpus.clear();
+    assert(MyServer::ParseCpuList("", cpus) && cpus.empty());
+    assert(!MyServer::ParseCpuList("3-1", cpus));
+    assert(!MyServer::ParseCpuList("a", cpus));
+    assert(!MyServer::ParseCpuList("1-", cpus));
+    MYSERVER_LOG_INFO(g_logger) << "test_parse ok";
+}
+
+//当前线程允许运行的CPU
+static std::vector<int> current_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    std::vector<int> cpus;
+    for(int i = 0; i < CPU_SETSIZE; ++i) {
+        if(CPU_ISSET(i, &set)) {
+            cpus.push_back(i);
+        }
+    }
+    return cpus;
+}
+
+//每个线程绑定到各自的CPU上
+void test_pin() {
+    std::vector<int> all = current_cpus();
+    MyServer::ThreadOptions opts;
+    opts.cpus = all;
+    opts.stackSize = 256 * 1024;
+    //实时策略没有权限时会退回默认策略,线程照常运行
+    opts.policy = SCHED_FIFO;
+    opts.priority = 1;
+    MyServer::ThreadGroup group("pin", opts, all.size() * 2);
+    std::vector<std::vector<int> > got(group.size());
+    std::vector<int> ran_on(group.size(), -1);
+    group.start([&got, &ran_on](size_t i) {
+        got[i] = current_cpus();
+        ran_on[i] = sched_getcpu();
+        assert(MyServer::Thread::GetName() == "pin_" + std::to_string(i));
+    });
+    group.join();
+    for(size_t i = 0; i < group.size(); ++i) {
+        int cpu = all[i % all.size()];
+        assert(got[i] == std::vector<int>{cpu});
+        assert(ran_on[i] == cpu);
+    }
+
+    //不绑定单个CPU时共享整个列表
+    MyServer::ThreadGroup shared("shared", opts, 2, false);
+    shared.start([all](size_t) {
+        assert(current_cpus() == all);
+    });
+    shared.join();
+    MYSERVER_LOG_INFO(g_logger) << "test_pin ok cpus=" << all.size();
+}
+
+//从配置创建
+void test_config() {
+    YAML::Node root = YAML::Load(
+        "threads:\n"
+        "    worker:\n"
+        "        cpus: [0-0]\n"
+        "        count: 3\n"
+        "        stack_size: 131072\n"
+        "        numa_node: 0\n"
+        "    io:\n"
+        "        cpus: \"0\"\n");
+    MyServer::Config::LoadFromYaml(root);
+
+    auto worker = MyServer::ThreadGroup::Create("worker");
+    assert(worker->size() == 3);
+    assert(worker->getOptions(2).cpus == std::vector<int>{0});
+    assert(worker->getOptions(1).stackSize == 131072);
+    assert(worker->getOptions(1).numaNode == 0);
+    std::atomic<int> n{0};
+    worker->start([&n](size_t) {
+        assert(sched_getcpu() == 0);
+        ++n;
+    });
+    worker->join();
+    assert(n == 3);
+
+    auto io = MyServer::ThreadGroup::Create("io");
+    assert(io->size() == 1);
+    //没有配置的组使用默认参数
+    auto def = MyServer::ThreadGroup::Create("none");
+    assert(def->size() >= 1 && def->getOptions(0).cpus.empty());
+    MYSERVER_LOG_INFO(g_logger) << "test_config ok";
+}
+
+//门闩计数到0前wait不返回,reset后可以复用
+void test_latch() {
+    MyServer::Latch latch(3);
+    assert(!latch.tryWait());
+    std::atomic<int> passed{0};
+    std::vector<MyServer::Thread::ptr> thrs;
+    for(int i = 0; i < 4; ++i) {
+        thrs.push_back(MyServer::Thread::ptr(new MyServer::Thread([&latch, &passed]() {
+            latch.wait();
+            ++passed;
+        }, "latch_" + std::to_string(i))));
+    }
+    latch.countDown();
+    latch.countDown();
+    usleep(10000);
+    assert(passed == 0);
+    latch.countDown();
+    for(auto& i : thrs) {
+        i->join();
+    }
+    assert(passed == 4 && latch.tryWait());
+    latch.reset(2);
+    latch.countDown(2);
+    latch.wait();
+    MYSERVER_LOG_INFO(g_logger) << "test_latch ok";
+}
+
+//批量创建返回时每个线程都已设置好id
+void test_batch() {
+    std::atomic<int> n{0};
+    auto thrs = MyServer::Thread::CreateBatch(16, [&n](size_t i) {
+        assert(MyServer::Thread::GetName() == "batch_" + std::to_string(i));
+        ++n;
+    }, "batch");
+    assert(thrs.size() == 16);
+    for(auto& i : thrs) {
+        assert(i->getId() > 0);
+    }
+    for(auto& i : thrs) {
+        i->join();
+    }
+    assert(n == 16);
+
+    //预先创建,start只是放行,join之后可以再来一次
+    MyServer::ThreadGroup group("pre", MyServer::ThreadOptions(), 8, false);
+    for(int round = 0; round < 2; ++round) {
+        group.prepare();
+        for(size_t i = 0; i < group.size(); ++i) {
+            assert(group.getThread(i)->getId() > 0);
+        }
+        usleep(1000);
+        assert(n == 16 + 8 * round);
+        group.start([&n](size_t) {
+            ++n;
+        });
+        group.join();
+        assert(n == 16 + 8 * (round + 1));
+    }
+    //prepare之后没有start,析构时回收线程
+    {
+        MyServer::ThreadGroup unused("unused", MyServer::ThreadOptions(), 4, false);
+        unused.prepare();
+    }
+    MYSERVER_LOG_INFO(g_logger) << "test_batch ok";
+}
+
+int main(int argc, char** argv) {
+    test_parse();
+    test_pin();
+    test_config();
+    test_latch();
+    test_batch();
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "../MyServer/MyServer.h"
+#include "../MyServer/iomanager.h"
+#include <assert.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+static MyServer::Logger::ptr g_logger = MYSERVER_LOG_ROOT();
+
+//手动推进的定时器管理,只检查时间轮本身
+class TestTimerManager : public MyServer::TimerManager {
+public:
+    int front = 0;
+protected:
+    void onTimerInsertedAtFront() override {
+        ++front;
+    }
+};
+
+void test_wheel() {
+    TestTimerManager tm;
+    assert(tm.getNextTimer() == ~0ull);
+    //都在第0层(256ms)以内,getNextTimer返回的就是真正的到期时间
+    MyServer::Timer::ptr t1 = tm.addTimer(200, []() {});
+    assert(tm.front == 1);
+    uint64_t next = tm.getNextTimer();
+    assert(next <= 200);
+    //更晚的定时器不需要唤醒
+    MyServer::Timer::ptr t2 = tm.addTimer(100000, []() {});
+    assert(tm.front == 1);
+    MyServer::Timer::ptr t3 = tm.addTimer(50, []() {});
+    assert(tm.front == 2);
+    assert(tm.getNextTimer() <= 50);
+    assert(tm.getTimerCount() == 3);
+
+    assert(t3->cancel());
+    assert(!t3->cancel());
+    assert(tm.getTimerCount() == 2);
+    assert(t1->cancel());
+    //高层的槽返回cascade的时间,不会晚于真正的到期时间
+    next = tm.getNextTimer();
+    assert(next <= 100000 && next > 0);
+    assert(t2->reset(10, true));
+    assert(tm.getNextTimer() <= 10);
+    usleep(20 * 1000);
+    std::vector<std::function<void()> > cbs;
+    tm.listExpiredCb(cbs);
+    assert(cbs.size() == 1);
+    assert(!tm.hasTimer());
+    assert(!t2->cancel());
+}
+
+//随机的到期时间,每个定时器都不能早于到期时间触发,也不能漏掉
+void test_order() {
+    TestTimerManager tm;
+    const int count = 2000;
+    std::vector<uint64_t> fired(count, 0);
+    std::vector<uint64_t> due(count);
+    for(int i = 0; i < count; ++i) {
+        uint64_t ms = rand() % 1500;
+        due[i] = MyServer::GetCurrentMS() + ms;
+        tm.addTimer(ms, [&fired, i]() {
+            fired[i] = MyServer::GetCurrentMS();
+        });
+    }
+    while(tm.hasTimer()) {
+        uint64_t next = tm.getNextTimer();
+        usleep(std::min(next, (uint64_t)5) * 1000);
+        std::vector<std::function<void()> > cbs;
+        tm.listExpiredCb(cbs);
+        for(auto& cb : cbs) {
+            cb();
+        }
+    }
+    for(int i = 0; i < count; ++i) {
+        assert(fired[i] >= due[i]);
+        assert(fired[i] < due[i] + 50);
+    }
+}
+
+void test_iomanager() {
+    MyServer::IOManager iom(2, "timer");
+    MyServer::Semaphore sem;
+
+    uint64_t begin = MyServer::GetCurrentMS();
+    iom.addTimer(50, [&sem]() {
+        sem.notify();
+    });
+    sem.wait();
+    uint64_t used = MyServer::GetCurrentMS() - begin;
+    MYSERVER_LOG_INFO(g_logger) << "timer 50ms fired after " << used << "ms";
+    assert(used >= 50 && used < 200);
+
+    //循环定时器
+    std::atomic<int> count{0};
+    MyServer::Timer::ptr timer = iom.addTimer(10, [&count, &sem]() {
+        if(++count == 5) {
+            sem.notify();
+        }
+    }, true);
+    sem.wait();
+    timer->cancel();
+
+    //条件定时器,条件对象销毁后不再触发,循环的也随之移除
+    std::atomic<int> cond_count{0};
+    std::shared_ptr<int> cond(new int(0));
+    iom.addConditionTimer(10, [&cond_count]() {
+        ++cond_count;
+    }, cond, true);
+    usleep(50 * 1000);
+    cond.reset();
+    usleep(30 * 1000);
+    int last = cond_count;
+    assert(last > 0);
+    usleep(50 * 1000);
+    assert(cond_count == last);
+    assert(!iom.hasTimer());
+
+    //refresh推迟到期
+    std::atomic<bool> fired{false};
+    MyServer::Timer::ptr t = iom.addTimer(100, [&fired]() {
+        fired = true;
+    });
+    for(int i = 0; i < 5; ++i) {
+        usleep(50 * 1000);
+        t->refresh();
+    }
+    assert(!fired);
+    t->cancel();
+    MYSERVER_LOG_INFO(g_logger) << "test_iomanager ok";
+}
+
+int main(int argc, char** argv) {
+    test_wheel();
+    test_order();
+    test_iomanager();
+    MYSERVER_LOG_INFO(g_logger) << "test_timer end";
+    return 0;
+}
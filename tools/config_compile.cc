@@ -0,0 +1,43 @@
+#include "../MyServer/config_snapshot.h"
+#include <iostream>
+#include <string.h>
+
+//将YAML配置编译成二进制快照,配合Config::LoadFromFile(yaml, snapshot)使用
+//只有已注册的ConfigVar会保存二进制值: 框架自身的参数随库注册,
+//业务参数用-s指定的schema文件注册(格式见ConfigSnapshot::RegisterSchema),
+//业务进程也可以注册自己的参数后直接调用ConfigSnapshot::Compile
+//用法: config_compile [-s schema_file] <yaml_file> <snapshot_file>
+int main(int argc, char** argv) {
+    const char* schema = nullptr;
+    int argi = 1;
+    if(argc == 5 && strcmp(argv[1], "-s") == 0) {
+        schema = argv[2];
+        argi = 3;
+    } else if(argc != 3) {
+        std::cout << "usage: " << argv[0] << " [-s schema_file] <yaml_file> <snapshot_file>" << std::endl;
+        return 1;
+    }
+    const char* yaml_file = argv[argi];
+    const char* snapshot_file = argv[argi + 1];
+    if(schema) {
+        int n = MyServer::ConfigSnapshot::RegisterSchema(schema);
+        if(n < 0) {
+            std::cout << "load schema " << schema << " fail" << std::endl;
+            return 1;
+        }
+        std::cout << schema << ": registered=" << n << std::endl;
+    }
+    if(!MyServer::ConfigSnapshot::Compile(yaml_file, snapshot_file)) {
+        std::cout << "compile " << yaml_file << " fail" << std::endl;
+        return 1;
+    }
+    MyServer::ConfigSnapshot snapshot;
+    if(!snapshot.open(snapshot_file)) {
+        std::cout << "open " << snapshot_file << " fail" << std::endl;
+        return 1;
+    }
+    std::cout << snapshot_file << ": entries=" << snapshot.size()
+              << " binary=" << snapshot.getBinaryCount()
+              << " source_hash=" << std::hex << snapshot.getSourceHash() << std::endl;
+    return 0;
+}